@@ -0,0 +1,133 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the cost of carrying large, move-expensive values through futures.
+
+#include <benchmark/benchmark.h>
+#include "var_future/future.h"
+
+#include <array>
+
+namespace {
+
+// A payload that is expensive to move, and keeps track of how often it is.
+struct Heavy {
+  static std::size_t moves;
+
+  Heavy() = default;
+  Heavy(const Heavy&) = default;
+  Heavy(Heavy&& rhs) : data(rhs.data) { ++moves; }
+  Heavy& operator=(const Heavy&) = default;
+  Heavy& operator=(Heavy&& rhs) {
+    data = rhs.data;
+    ++moves;
+    return *this;
+  }
+
+  std::array<char, 1024> data = {};
+};
+
+std::size_t Heavy::moves = 0;
+
+void report_moves(benchmark::State& state, std::size_t fields) {
+  state.counters["moves_per_field"] = benchmark::Counter(
+      static_cast<double>(Heavy::moves) /
+      static_cast<double>(state.iterations() * fields));
+}
+}  // namespace
+
+// The handler is attached before the value is produced (the common case).
+static void BM_heavy_fields_then(benchmark::State& state) {
+  Heavy::moves = 0;
+  for (auto _ : state) {
+    aom::Promise<Heavy, Heavy, Heavy, Heavy, Heavy> p;
+    std::size_t total = 0;
+
+    auto f = p.get_future().then(
+        [&](const Heavy& a, const Heavy& b, const Heavy& c, const Heavy& d,
+            const Heavy& e) {
+          total += a.data[0] + b.data[0] + c.data[0] + d.data[0] + e.data[0];
+        });
+
+    p.set_value(Heavy{}, Heavy{}, Heavy{}, Heavy{}, Heavy{});
+    benchmark::DoNotOptimize(total);
+  }
+  report_moves(state, 5);
+}
+
+// The value is produced before the handler is attached, going through the
+// finished_ buffer of the storage.
+static void BM_heavy_fields_prefilled(benchmark::State& state) {
+  Heavy::moves = 0;
+  for (auto _ : state) {
+    aom::Promise<Heavy, Heavy, Heavy, Heavy, Heavy> p;
+    auto f = p.get_future();
+    std::size_t total = 0;
+
+    p.set_value(Heavy{}, Heavy{}, Heavy{}, Heavy{}, Heavy{});
+    auto r = f.then([&](const Heavy& a, const Heavy& b, const Heavy& c,
+                        const Heavy& d, const Heavy& e) {
+      total += a.data[0] + b.data[0] + c.data[0] + d.data[0] + e.data[0];
+    });
+    benchmark::DoNotOptimize(total);
+  }
+  report_moves(state, 5);
+}
+
+static void BM_heavy_fields_finally(benchmark::State& state) {
+  Heavy::moves = 0;
+  for (auto _ : state) {
+    aom::Promise<Heavy, void, Heavy, Heavy> p;
+    std::size_t total = 0;
+
+    p.get_future().finally([&](aom::expected<Heavy> a, aom::expected<void>,
+                               aom::expected<Heavy> c, aom::expected<Heavy> d) {
+      total += a->data[0] + c->data[0] + d->data[0];
+    });
+
+    p.set_value(Heavy{}, Heavy{}, Heavy{});
+    benchmark::DoNotOptimize(total);
+  }
+  report_moves(state, 3);
+}
+
+// Same as BM_heavy_fields_prefilled, but the values are constructed within
+// the storage, and read from there by reference.
+static void BM_heavy_fields_emplaced(benchmark::State& state) {
+  Heavy::moves = 0;
+  for (auto _ : state) {
+    aom::Promise<Heavy, Heavy, Heavy, Heavy, Heavy> p;
+    auto f = p.get_future();
+    std::size_t total = 0;
+
+    p.emplace<0>();
+    p.emplace<1>();
+    p.emplace<2>();
+    p.emplace<3>();
+    p.emplace<4>();
+    auto r = f.then([&](const Heavy& a, const Heavy& b, const Heavy& c,
+                        const Heavy& d, const Heavy& e) {
+      total += a.data[0] + b.data[0] + c.data[0] + d.data[0] + e.data[0];
+    });
+    benchmark::DoNotOptimize(total);
+  }
+  report_moves(state, 5);
+}
+
+BENCHMARK(BM_heavy_fields_then);
+BENCHMARK(BM_heavy_fields_prefilled);
+BENCHMARK(BM_heavy_fields_emplaced);
+BENCHMARK(BM_heavy_fields_finally);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,89 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_ASYNC_SCOPE_INCLUDED_H
+#define AOM_VARIADIC_ASYNC_SCOPE_INCLUDED_H
+
+/// \file
+/// Tracking of detached futures.
+
+#include "var_future/config.h"
+
+#include "var_future/future.h"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace aom {
+
+/**
+ * @brief Keeps track of futures whose results are not needed, so that one can
+ *        wait for all of them to be finished.
+ *
+ * Spawned futures are not stored: they are counted, and detached with a
+ * finally() that decrements the count. Their values and errors are discarded.
+ *
+ * The scope must outlive every future spawned into it, which is typically
+ * ensured by waiting on on_empty() before destroying it.
+ */
+class Async_scope {
+ public:
+  Async_scope() = default;
+  ~Async_scope();
+
+  /**
+   * @brief Adopts a future.
+   *
+   * @post fut will be \b uninitialized
+   */
+  template <typename Alloc, typename... Ts>
+  void spawn(Basic_future<Alloc, Ts...> fut);
+
+  /**
+   * @brief Posts callback to queue, and adopts the resulting future.
+   */
+  template <typename QueueT, typename CbT>
+  void spawn(QueueT& queue, CbT&& callback);
+
+  /**
+   * @brief Returns a future that is fullfilled once no spawned future is
+   *        pending anymore.
+   *
+   * The future is ready right away if the scope is currently empty.
+   */
+  Future<void> on_empty();
+
+  /**
+   * @brief The number of spawned futures that are not finished yet.
+   */
+  std::size_t size() const { return pending_.load(); }
+
+ private:
+  void release();
+
+  std::atomic<std::size_t> pending_ = 0;
+
+  std::mutex waiters_mtx_;
+  std::vector<Promise<void>> waiters_;
+
+  Async_scope(const Async_scope&) = delete;
+  Async_scope& operator=(const Async_scope&) = delete;
+};
+}  // namespace aom
+
+#include "var_future/impl/async_scope.h"
+
+#endif
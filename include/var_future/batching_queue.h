@@ -0,0 +1,126 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_BATCHING_QUEUE_INCLUDED_H
+#define AOM_VARIADIC_BATCHING_QUEUE_INCLUDED_H
+
+/// \file
+/// Queue adapter that coalesces pushes.
+
+#include "var_future/config.h"
+
+#include "var_future/impl/utils.h"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace aom {
+
+/**
+ * @brief Queue adapter that forwards tasks to another queue in batches.
+ *
+ * Tasks pushed by a thread while it is running a task obtained from this
+ * adapter, or while it holds a Batch, are buffered. They are forwarded to the
+ * underlying queue once max_batch tasks are buffered, or when the current task
+ * (or Batch) ends. Other pushes are forwarded immediately.
+ *
+ * A batch is forwarded with a single push_bulk() call if the underlying queue
+ * has one. Otherwise, it is forwarded as a single task that runs every task
+ * of the batch in sequence. Either way, the forwarded tasks are copyable, even
+ * if the buffered ones are move-only.
+ *
+ * A task must not block on work it pushed through this adapter: that work
+ * only reaches the underlying queue once the task returns, so waiting for it
+ * deadlocks. The same goes for a thread holding a Batch, unless it invokes
+ * flush() first.
+ *
+ * The adapter must outlive every task pushed through it.
+ *
+ * @tparam QueueT The underlying queue type.
+ */
+template <typename QueueT>
+class Batching_queue {
+ public:
+  using task_type = detail::Unique_function<void()>;
+
+  /**
+   * @brief Buffers pushes made by the current thread for its lifetime.
+   */
+  class Batch {
+   public:
+    explicit Batch(Batching_queue& queue);
+    ~Batch();
+
+    /**
+     * @brief Forwards the tasks buffered so far.
+     *
+     * Propagates the underlying queue's exceptions. Since the destructor
+     * cannot, it invokes std::terminate() if its own flush fails.
+     */
+    void flush();
+
+   private:
+    friend class Batching_queue;
+
+    Batching_queue& queue_;
+    Batch* prev_;
+    std::vector<task_type> tasks_;
+
+    Batch(const Batch&) = delete;
+    Batch& operator=(const Batch&) = delete;
+  };
+
+  /**
+   * @param dst The queue tasks are forwarded to. It must outlive this.
+   * @param max_batch The number of buffered tasks that triggers a flush.
+   */
+  explicit Batching_queue(QueueT& dst, std::size_t max_batch = 64);
+
+  template <typename F>
+  void push(F&& f);
+
+  template <typename ItT>
+  void push_bulk(ItT first, ItT last);
+
+ private:
+  Batch* current_batch() const;
+
+  // Runs the buffered tasks [first, last) of a batch.
+  struct Forwarded_tasks {
+    void operator()() const;
+
+    std::shared_ptr<std::vector<task_type>> tasks;
+    std::size_t first;
+    std::size_t last;
+  };
+
+  template <typename F>
+  auto wrap(F&& f);
+
+  void forward(std::vector<task_type> tasks);
+
+  QueueT& dst_;
+  std::size_t max_batch_;
+
+  static inline thread_local Batch* current_ = nullptr;
+
+  Batching_queue(const Batching_queue&) = delete;
+  Batching_queue& operator=(const Batching_queue&) = delete;
+};
+}  // namespace aom
+
+#include "var_future/impl/queues/batching_queue.h"
+
+#endif
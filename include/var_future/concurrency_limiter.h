@@ -0,0 +1,145 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_CONCURRENCY_LIMITER_INCLUDED_H
+#define AOM_VARIADIC_CONCURRENCY_LIMITER_INCLUDED_H
+
+/// \file
+/// Queue adapter that bounds the number of tasks in flight.
+
+#include "var_future/config.h"
+
+#include "var_future/future.h"
+#include "var_future/impl/mpsc_queue.h"
+#include "var_future/impl/utils.h"
+
+#include <atomic>
+#include <cstddef>
+
+namespace aom {
+
+/**
+ * @brief Queue adapter that lets at most max_concurrency tasks be in flight in
+ *        the underlying queue at any given time.
+ *
+ * Tasks beyond that limit wait in a lock-free queue, and are forwarded in
+ * submission order as slots are released.
+ *
+ * Tasks pushed with push() hold their slot while they run. Operations started
+ * with async() hold theirs until the returned future is finished, including
+ * when the callback returns a future itself.
+ *
+ * If the underlying queue throws while a task is forwarded, that task is
+ * dropped and the exception propagates out of the push() or submit() call that
+ * was forwarding it. Tasks forwarded as a slot is released are dropped
+ * silently.
+ *
+ * The limiter must outlive every task submitted to it.
+ *
+ * @tparam QueueT The underlying queue type.
+ */
+template <typename QueueT>
+class Concurrency_limiter {
+ public:
+  /**
+   * @brief Ownership of one of the limiter's slots.
+   */
+  class Slot {
+   public:
+    Slot(Slot&& rhs) : owner_(rhs.owner_) { rhs.owner_ = nullptr; }
+    Slot& operator=(Slot&& rhs);
+    ~Slot();
+
+    /**
+     * @brief Gives the slot back early.
+     */
+    void release();
+
+   private:
+    friend class Concurrency_limiter;
+
+    explicit Slot(Concurrency_limiter* owner) : owner_(owner) {}
+
+    Concurrency_limiter* owner_;
+
+    Slot(const Slot&) = delete;
+    Slot& operator=(const Slot&) = delete;
+  };
+
+  using task_type = detail::Unique_function<void(Slot)>;
+
+  /**
+   * @param dst The queue tasks are forwarded to. It must outlive this.
+   * @param max_concurrency The number of slots.
+   */
+  Concurrency_limiter(QueueT& dst, std::size_t max_concurrency);
+  ~Concurrency_limiter();
+
+  template <typename F>
+  void push(F&& f);
+
+  /**
+   * @brief Forwards task once a slot is available, handing it the slot.
+   */
+  void submit(task_type task);
+
+  /**
+   * @brief The number of tasks that either hold a slot or are waiting for one.
+   */
+  std::size_t size() const { return count_.load(); }
+
+ private:
+  struct Node : public detail::Mpsc_node {
+    explicit Node(task_type t) : task(std::move(t)) {}
+
+    task_type task;
+  };
+
+  void release_slot();
+
+  // Forwards one pending task to dst_. Only one thread forwards at a time.
+  void dispatch();
+
+  QueueT& dst_;
+  std::size_t max_concurrency_;
+
+  // Tasks that have been submitted, and whose slot has not been released.
+  std::atomic<std::size_t> count_ = 0;
+  std::atomic<std::size_t> dispatching_ = 0;
+
+  // Consumed by whichever thread is dispatching.
+  detail::Intrusive_mpsc_queue pending_;
+
+  Concurrency_limiter(const Concurrency_limiter&) = delete;
+  Concurrency_limiter& operator=(const Concurrency_limiter&) = delete;
+};
+
+/**
+ * @brief Posts a callback to the limiter, and returns a future to its result.
+ *
+ * The callback's slot is held until the returned future is finished.
+ */
+template <typename QueueT, typename CbT>
+auto async(Concurrency_limiter<QueueT>& q, CbT&& callback);
+
+/**
+ * @brief async() on a Concurrency_limiter, with a custom allocator.
+ */
+template <typename QueueT, typename Alloc, typename CbT>
+auto async(Concurrency_limiter<QueueT>& q, const Alloc& alloc, CbT&& callback);
+}  // namespace aom
+
+#include "var_future/impl/queues/concurrency_limiter.h"
+
+#endif
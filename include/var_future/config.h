@@ -22,8 +22,45 @@
 #define AOM_VARFUT_VERSION_MINOR 3
 #define AOM_VARFUT_VERSION_PATCH 2
 
+// ************************** Inline execution **************************//
+
+// Maximum number of continuations that may run nested within each other on
+// the same stack when executed immediately. Past that, they are deferred
+// until the outermost one returns.
+#ifndef AOM_VARFUT_MAX_INLINE_DEPTH
+#define AOM_VARFUT_MAX_INLINE_DEPTH 64
+#endif
+
+// ****************************** Coroutines ****************************//
+
+// Futures can be co_await'ed when this is 1. It defaults to wether the
+// compiler and standard library support coroutines.
+#ifndef AOM_VARFUT_HAS_COROUTINES
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define AOM_VARFUT_HAS_COROUTINES 1
+#endif
+#endif
+#endif
+
+#ifndef AOM_VARFUT_HAS_COROUTINES
+#define AOM_VARFUT_HAS_COROUTINES 0
+#endif
+
+// How many values a Stream_generator may push ahead of its consumer's demand
+// before it suspends.
+#ifndef AOM_VARFUT_STREAM_GENERATOR_CAPACITY
+#define AOM_VARFUT_STREAM_GENERATOR_CAPACITY 64
+#endif
+
 // **************************** std::expected ***************************//
 
+// aom::expected relies on expected-lite's own implementation, which it would
+// otherwise skip in C++20 wherever an <expected> header exists.
+#ifndef nsel_CONFIG_SELECT_EXPECTED
+#define nsel_CONFIG_SELECT_EXPECTED 1  // nsel_EXPECTED_NONSTD
+#endif
+
 // Change this if you want to use some other expected type.
 #include "nonstd/expected.hpp"
 
@@ -0,0 +1,101 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_FRAME_QUEUE_INCLUDED_H
+#define AOM_VARIADIC_FRAME_QUEUE_INCLUDED_H
+
+/// \file
+/// Work queue drained on a time budget.
+
+#include "var_future/config.h"
+#include "var_future/impl/utils.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace aom {
+
+/**
+ * @brief Queue that accumulates tasks until a thread drains it, typically once
+ *        per frame of a game loop.
+ *
+ * push() is thread-safe, but only one thread may drain the queue at a time.
+ */
+class Frame_queue {
+ public:
+  using task_type = detail::Unique_function<void()>;
+  using clock_type = std::chrono::steady_clock;
+
+  template <typename F>
+  void push(F&& f);
+
+  /**
+   * @brief Executes tasks until either the queue is empty, or budget has been
+   *        spent.
+   *
+   * Tasks pushed while running, including continuations of the tasks being
+   * run, are executed as well if the budget allows it. The remaining tasks are
+   * carried over to the next call, ahead of tasks pushed later.
+   *
+   * At least one task is executed if the queue is not empty, so that the
+   * queue always makes progress.
+   *
+   * @return the number of tasks that were executed.
+   */
+  std::size_t run_for(clock_type::duration budget);
+
+  /**
+   * @brief Executes every task, including the ones pushed while running.
+   *
+   * @return the number of tasks that were executed.
+   */
+  std::size_t run_all();
+
+  /**
+   * @brief true while the calling thread is draining the queue.
+   *
+   * This lets continuations that are completed by the queue's own tasks run
+   * inline instead of waiting for the next frame.
+   */
+  bool running_in_this_thread() const;
+
+  /**
+   * @brief The number of tasks waiting to be executed.
+   */
+  std::size_t size() const;
+
+ private:
+  template <typename PredT>
+  std::size_t run_while(PredT&& keep_going);
+
+  // Tasks carried over from a previous run. Only touched by the draining
+  // thread.
+  std::deque<task_type> carried_;
+
+  mutable std::mutex mtx_;
+  std::vector<task_type> pushed_;
+
+  std::atomic<std::size_t> size_ = 0;
+  std::atomic<std::thread::id> runner_{};
+};
+}  // namespace aom
+
+#include "var_future/impl/queues/frame_queue.h"
+
+#endif
@@ -21,7 +21,10 @@
 #include "var_future/config.h"
 #include "var_future/impl/storage_decl.h"
 
+#include <cstddef>
 #include <memory>
+#include <memory_resource>
+#include <optional>
 #include <string>
 
 namespace aom {
@@ -185,6 +188,27 @@ class Basic_future {
    */
   value_type get();
 
+  /**
+   * @brief Wether the future has been finished, and its result can be
+   *        retrieved without blocking.
+   *
+   * This does not consume the future, and can be polled repeatedly.
+   *
+   * @pre the future must be \b ready
+   */
+  bool is_ready() const;
+
+  /**
+   * @brief Retrieves the result without blocking, if it is available.
+   *
+   * @return std::nullopt if the future is not finished yet, in which case the
+   *         future is left untouched. Otherwise, the value or the first error.
+   *
+   * @pre the future must be \b ready
+   * @post the future will be \b uninitialized if a result was returned.
+   */
+  std::optional<expected<value_type>> try_get();
+
   /**
    * @brief Obtain a std::future bound to this future.
    *
@@ -263,6 +287,33 @@ class Basic_promise {
   template <typename... Us>
   void set_value(Us&&... values);
 
+  /**
+   * @brief Fullfills the promise by constructing its value directly within
+   *        the future's storage.
+   *
+   * Only available for promises with a single field.
+   *
+   * @tparam Args
+   * @param args The arguments forwarded to the value's constructor
+   */
+  template <typename... Args>
+  void emplace_value(Args&&... args);
+
+  /**
+   * @brief Constructs a single field directly within the future's storage.
+   *
+   * The promise is fullfilled once every field has been emplaced. If the
+   * promise is failed or destroyed before then, only the fields that were
+   * not emplaced are failed. If set_value() or finish() is invoked instead,
+   * the fields emplaced so far are destroyed and replaced.
+   *
+   * @tparam I The index of the field
+   * @tparam Args
+   * @param args The arguments forwarded to the field's constructor
+   */
+  template <std::size_t I, typename... Args>
+  void emplace(Args&&... args);
+
   /**
    * @brief Finishes the promise
    *
@@ -299,6 +350,26 @@ class Basic_promise {
 
 template <typename... Ts>
 using Promise = Basic_promise<std::allocator<void>, Ts...>;
+
+namespace pmr {
+/**
+ * @brief Future whose internal state comes from a std::pmr::memory_resource.
+ *
+ * Futures created by then(), then_expect() and join() share the memory
+ * resource of their source. Combined with a
+ * std::pmr::monotonic_buffer_resource, this lets every future of a request be
+ * released at once when the request ends.
+ *
+ * @pre The memory resource must outlive every future and promise using it.
+ */
+template <typename... Ts>
+using Future = Basic_future<std::pmr::polymorphic_allocator<std::byte>, Ts...>;
+
+template <typename... Ts>
+using Promise =
+    Basic_promise<std::pmr::polymorphic_allocator<std::byte>, Ts...>;
+}  // namespace pmr
+
 /**
  * @brief Ties a set of Future<> into a single Future<> that is finished once
  *        all child futures are finished.
@@ -326,6 +397,60 @@ auto join(FutTs&&... futures);
 template <typename QueueT, typename CbT>
 auto async(QueueT& q, CbT&& callback);
 
+/**
+ * @brief Posts a callback into to queue, and return a future that will be
+ *        finished upon executaiton of the callback.
+ *
+ * @tparam QueueT
+ * @tparam Alloc
+ * @tparam CbT
+ * @param q
+ * @param alloc The allocator used to create the future's internal state
+ * @param callback
+ * @return auto
+ */
+template <typename QueueT, typename Alloc, typename CbT>
+auto async(QueueT& q, const Alloc& alloc, CbT&& callback);
+
+/**
+ * @brief Posts `callback(i)` into the queue for every i in [0, n), and
+ *        returns a future to the vector of all results.
+ *
+ * All the results are written in place into a single buffer, so the cost per
+ * task is limited to the queue's own overhead. If any invocation throws, the
+ * future is failed with the first exception that was caught.
+ *
+ * @tparam QueueT
+ * @tparam CbT
+ * @param q
+ * @param n The number of tasks to launch
+ * @param callback
+ * @return Future<std::vector<T>>, or Future<void> if callback returns void.
+ */
+template <typename QueueT, typename CbT>
+auto async_bulk(QueueT& q, std::size_t n, CbT&& callback);
+
+/**
+ * @brief async_bulk() with a custom allocator.
+ *
+ * The results are stored in a vector that also uses alloc, rebound to their
+ * type. Every result is assigned to its own slot of that vector, so they must
+ * be default constructible.
+ *
+ * @tparam QueueT
+ * @tparam Alloc
+ * @tparam CbT
+ * @param q
+ * @param alloc The allocator used to create the shared state and the results
+ * @param n The number of tasks to launch
+ * @param callback
+ * @return Basic_future<Alloc, std::vector<T, A>> where A is Alloc rebound to
+ *         T, or Basic_future<Alloc, void> if callback returns void.
+ */
+template <typename QueueT, typename Alloc, typename CbT>
+auto async_bulk(QueueT& q, const Alloc& alloc, std::size_t n,
+                CbT&& callback);
+
 /**
  * @brief Create a higher-order Future from a `future<tuple>`
  *
@@ -356,6 +481,7 @@ inline std::string varfut_lib_version_string();
 }  // namespace aom
 
 #include "var_future/impl/async.h"
+#include "var_future/impl/awaitable.h"
 #include "var_future/impl/future.h"
 #include "var_future/impl/join.h"
 #include "var_future/impl/promise.h"
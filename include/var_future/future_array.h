@@ -0,0 +1,244 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_FUTURE_ARRAY_INCLUDED_H
+#define AOM_VARIADIC_FUTURE_ARRAY_INCLUDED_H
+
+/// \file
+/// Arrays of homogeneous futures sharing a single contiguous block.
+
+#include "var_future/config.h"
+
+#include "var_future/future.h"
+
+#include "var_future/impl/array/array_block.h"
+
+namespace aom {
+
+template <typename Alloc, typename T>
+class Basic_array_promise;
+
+/**
+ * @brief The values produced by a Basic_array_promise.
+ *
+ * The values are stored contiguously, so they can be processed as a single
+ * span. Elements that were failed hold a value-initialized T.
+ *
+ * @tparam Alloc The rebindable allocator to use.
+ * @tparam T The type of the elements.
+ */
+template <typename Alloc, typename T>
+class Basic_array_result {
+ public:
+  using value_type = T;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  Basic_array_result(const Basic_array_result&);
+  Basic_array_result(Basic_array_result&&);
+  Basic_array_result& operator=(const Basic_array_result&);
+  Basic_array_result& operator=(Basic_array_result&&);
+  ~Basic_array_result();
+
+  /**
+   * @brief The number of elements.
+   */
+  std::size_t size() const;
+
+  /**
+   * @brief Pointer to the first of size() contiguous elements.
+   */
+  T* data();
+  const T* data() const;
+
+  T* begin();
+  T* end();
+  const T* begin() const;
+  const T* end() const;
+
+  T& operator[](std::size_t i);
+  const T& operator[](std::size_t i) const;
+
+  /**
+   * @brief Wether the i'th element was failed instead of fullfilled.
+   */
+  bool is_failed(std::size_t i) const;
+
+  /**
+   * @brief The failure of the i'th element, or nullptr if it was fullfilled.
+   */
+  std::exception_ptr error(std::size_t i) const;
+
+  /**
+   * @brief The number of failed elements.
+   */
+  std::size_t error_count() const;
+
+ private:
+  using block_type = detail::Array_block<Alloc, T>;
+
+  template <typename SubAlloc, typename U>
+  friend class detail::Array_block;
+
+  explicit Basic_array_result(block_type* block);
+
+  block_type* block_ = nullptr;
+};
+
+template <typename T>
+using Array_result = Basic_array_result<std::allocator<void>, T>;
+
+/**
+ * @brief A future to N homogeneous values.
+ *
+ * @tparam T
+ */
+template <typename T>
+using Future_array = Future<Array_result<T>>;
+
+/**
+ * @brief Lightweight handle used to produce a single element of a
+ *        Basic_array_promise.
+ *
+ * If it is destroyed before being assigned, its element is failed with
+ * Unfullfilled_promise.
+ */
+template <typename Alloc, typename T>
+class Basic_array_element_promise {
+ public:
+  Basic_array_element_promise(Basic_array_element_promise&&);
+  Basic_array_element_promise& operator=(Basic_array_element_promise&&);
+  ~Basic_array_element_promise();
+
+  /**
+   * @brief Fullfills the element.
+   */
+  template <typename... Us>
+  void set_value(Us&&... values);
+
+  /**
+   * @brief Fails the element.
+   */
+  void set_exception(std::exception_ptr error);
+
+  /**
+   * @brief returns wether the handle still refers to an unassigned element
+   */
+  operator bool() const;
+
+ private:
+  using block_type = detail::Array_block<Alloc, T>;
+
+  template <typename SubAlloc, typename U>
+  friend class Basic_array_promise;
+
+  Basic_array_element_promise(block_type* block, std::size_t index);
+
+  block_type* block_ = nullptr;
+  std::size_t index_ = 0;
+
+  Basic_array_element_promise(const Basic_array_element_promise&) = delete;
+  Basic_array_element_promise& operator=(const Basic_array_element_promise&) =
+      delete;
+};
+
+template <typename T>
+using Array_element_promise =
+    Basic_array_element_promise<std::allocator<void>, T>;
+
+/**
+ * @brief N promises whose values land in a single contiguous block.
+ *
+ * The values, an error bitmap and a completion counter are all allocated at
+ * once. The future is fullfilled with a Basic_array_result once every element
+ * has been either fullfilled or failed. Failing individual elements does not
+ * fail the future itself.
+ *
+ * set_value() and set_exception() may be invoked concurrently for distinct
+ * elements, but each element may only be assigned once.
+ *
+ * @tparam Alloc The rebindable allocator to use.
+ * @tparam T The type of the elements.
+ */
+template <typename Alloc, typename T>
+class Basic_array_promise {
+ public:
+  using result_type = Basic_array_result<Alloc, T>;
+  using future_type = Basic_future<Alloc, result_type>;
+  using element_type = Basic_array_element_promise<Alloc, T>;
+
+  /**
+   * @brief Creates n promises.
+   *
+   * @param n The number of elements
+   * @param alloc The allocator used to create the shared state
+   */
+  explicit Basic_array_promise(std::size_t n, const Alloc& alloc = Alloc());
+  Basic_array_promise(Basic_array_promise&&);
+  Basic_array_promise& operator=(Basic_array_promise&&);
+
+  /**
+   * @brief Once this and every element_type obtained from it are destroyed,
+   *        elements that are still unassigned are failed with
+   *        Unfullfilled_promise.
+   */
+  ~Basic_array_promise();
+
+  /**
+   * @brief Get the future object
+   */
+  future_type get_future();
+
+  /**
+   * @brief The number of elements.
+   */
+  std::size_t size() const;
+
+  /**
+   * @brief Fullfills the i'th element.
+   */
+  template <typename... Us>
+  void set_value(std::size_t i, Us&&... values);
+
+  /**
+   * @brief Fails the i'th element.
+   */
+  void set_exception(std::size_t i, std::exception_ptr error);
+
+  /**
+   * @brief Obtains a handle that can be used to assign the i'th element
+   *        independently from this.
+   */
+  element_type element(std::size_t i);
+
+ private:
+  using block_type = detail::Array_block<Alloc, T>;
+
+  using storage_type = typename future_type::storage_type;
+
+  block_type* block_ = nullptr;
+  detail::Storage_ptr<storage_type> storage_;
+
+  Basic_array_promise(const Basic_array_promise&) = delete;
+  Basic_array_promise& operator=(const Basic_array_promise&) = delete;
+};
+
+template <typename T>
+using Array_promise = Basic_array_promise<std::allocator<void>, T>;
+}  // namespace aom
+
+#include "var_future/impl/array/array_promise.h"
+#include "var_future/impl/array/array_result.h"
+
+#endif
@@ -0,0 +1,147 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_FUTURE_CACHE_INCLUDED_H
+#define AOM_VARIADIC_FUTURE_CACHE_INCLUDED_H
+
+/// \file
+/// Keyed cache of asynchronously loaded values.
+
+#include "var_future/config.h"
+
+#include "var_future/future.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace aom {
+
+/**
+ * @brief Deduplicates and caches asynchronous loads by key.
+ *
+ * Concurrent requests for a key that is being loaded share that single load
+ * (single flight). Values are stored once, as a std::shared_ptr<const T>, and
+ * every requester receives a pointer to that same value.
+ *
+ * Failed loads are not cached: the error is delivered to every waiter, and the
+ * next request starts a new load.
+ *
+ * The keys are spread over independently locked shards. Eviction (TTL and
+ * LRU) is applied per shard, and never affects loads that are in flight.
+ *
+ * @tparam K The key type.
+ * @tparam T The value type.
+ * @tparam Hash The hash function used to pick shards and buckets.
+ */
+template <typename K, typename T, typename Hash = std::hash<K>>
+class Future_cache {
+ public:
+  using key_type = K;
+  using value_ptr = std::shared_ptr<const T>;
+  using future_type = Future<value_ptr>;
+  using clock_type = std::chrono::steady_clock;
+
+  struct Options {
+    /// Number of independently locked shards.
+    std::size_t shards = 16;
+
+    /// Maximum number of completed values to keep, 0 for no limit. The least
+    /// recently used values are evicted first.
+    std::size_t max_entries = 0;
+
+    /// How long a completed value stays valid, 0 for forever.
+    clock_type::duration ttl = clock_type::duration::zero();
+  };
+
+  Future_cache();
+  explicit Future_cache(Options options);
+
+  /**
+   * @brief Gets the value associated with key, loading it if necessary.
+   *
+   * @param key
+   * @param loader Callable<Future<T>(const K&)> or Callable<T(const K&)>,
+   *               only invoked if no valid value or load exists for key.
+   * @return A future to the shared value.
+   */
+  template <typename LoaderT>
+  future_type get(const K& key, LoaderT&& loader);
+
+  /**
+   * @brief Forgets the value associated with key.
+   *
+   * A load in flight still completes its waiters, but its result is not
+   * cached.
+   */
+  void erase(const K& key);
+
+  /**
+   * @brief Forgets every value.
+   */
+  void clear();
+
+  /**
+   * @brief The number of entries, including loads in flight.
+   */
+  std::size_t size() const;
+
+ private:
+  struct Entry {
+    std::uint64_t load_id = 0;
+    value_ptr value;
+    clock_type::time_point expires;
+    std::vector<Promise<value_ptr>> waiters;
+    typename std::list<K>::iterator lru_pos;
+  };
+
+  // Shared with in-flight loads, which may complete after the cache is gone.
+  struct Shard {
+    std::mutex mtx;
+    std::unordered_map<K, Entry, Hash> entries;
+
+    // Completed entries, most recently used first.
+    std::list<K> lru;
+    std::uint64_t next_load_id = 0;
+
+    // Waiters of loads that were erased while in flight, by load id.
+    std::unordered_map<std::uint64_t, std::vector<Promise<value_ptr>>> orphans;
+  };
+
+  const std::shared_ptr<Shard>& shard_for(const K& key) const;
+
+  static void complete(Shard& shard, const K& key, std::uint64_t load_id,
+                       expected<T> result, clock_type::duration ttl,
+                       std::size_t max_entries);
+
+  // Keeps the waiters of an in-flight load whose entry is being removed.
+  static void orphan(Shard& shard, Entry& entry);
+
+  static void evict(Shard& shard, std::size_t max_entries);
+
+  Options options_;
+  std::size_t max_per_shard_ = 0;
+  std::vector<std::shared_ptr<Shard>> shards_;
+};
+}  // namespace aom
+
+#include "var_future/impl/future_cache.h"
+
+#endif
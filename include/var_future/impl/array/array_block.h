@@ -0,0 +1,277 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_IMPL_ARRAY_BLOCK_INCLUDED_H
+#define AOM_VARIADIC_IMPL_ARRAY_BLOCK_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include "var_future/impl/storage_decl.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace aom {
+
+template <typename Alloc, typename T>
+class Basic_array_result;
+
+namespace detail {
+
+// Holds the shared state of a Basic_array_promise.
+//
+// Everything lives in a single allocation, laid out as:
+// [Array_block][T * n][done bits][failed bits]
+//
+// Failures are expected to be rare, so their exception_ptr are kept on the
+// side instead of reserving room for one per element.
+template <typename Alloc, typename T>
+class Array_block : public Alloc {
+ public:
+  using result_type = Basic_array_result<Alloc, T>;
+  using storage_type = Future_storage<Alloc, result_type>;
+
+  // Creates a block that is referenced by, and produced by, the caller. dst
+  // is fullfilled once every element is assigned.
+  static Array_block* create(std::size_t n, const Alloc& alloc,
+                             Storage_ptr<storage_type> dst);
+
+  std::size_t size() const { return size_; }
+
+  T* values() {
+    return reinterpret_cast<T*>(reinterpret_cast<char*>(this) +
+                                values_offset());
+  }
+
+  bool is_failed(std::size_t i) const { return test(failed_bits(), i); }
+  std::exception_ptr error(std::size_t i) const;
+  std::size_t error_count() const { return errors_.size(); }
+
+  template <typename... Us>
+  void set_value(std::size_t i, Us&&... vals);
+  void set_exception(std::size_t i, std::exception_ptr e);
+
+  void add_ref() { ref_count_.fetch_add(1, std::memory_order_relaxed); }
+  void release();
+
+  // Once every producer is gone, unassigned elements are failed.
+  void add_producer() { producers_.fetch_add(1, std::memory_order_relaxed); }
+  void release_producer();
+
+  Alloc& allocator() { return *static_cast<Alloc*>(this); }
+
+ private:
+  using word_type = std::atomic<std::uint64_t>;
+  using unit_type = std::max_align_t;
+  using error_type = std::pair<std::size_t, std::exception_ptr>;
+  using error_alloc_type =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<error_type>;
+
+  static_assert(alignof(T) <= alignof(unit_type),
+                "over-aligned types are not supported");
+  static_assert(std::is_default_constructible_v<T>,
+                "Array elements must be default constructible");
+
+  static constexpr std::size_t word_bits = 64;
+
+  Array_block(std::size_t n, const Alloc& alloc, Storage_ptr<storage_type> dst);
+  ~Array_block();
+
+  static constexpr std::size_t align_up(std::size_t v, std::size_t a) {
+    return (v + a - 1) / a * a;
+  }
+
+  static std::size_t word_count(std::size_t n) {
+    return (n + word_bits - 1) / word_bits;
+  }
+
+  static constexpr std::size_t values_offset() {
+    return align_up(sizeof(Array_block), alignof(T));
+  }
+
+  static std::size_t bits_offset(std::size_t n) {
+    return align_up(values_offset() + n * sizeof(T), alignof(word_type));
+  }
+
+  static std::size_t unit_count(std::size_t n) {
+    std::size_t bytes = bits_offset(n) + 2 * word_count(n) * sizeof(word_type);
+    return (bytes + sizeof(unit_type) - 1) / sizeof(unit_type);
+  }
+
+  word_type* done_bits() const {
+    return reinterpret_cast<word_type*>(
+        reinterpret_cast<char*>(const_cast<Array_block*>(this)) +
+        bits_offset(size_));
+  }
+
+  word_type* failed_bits() const { return done_bits() + word_count(size_); }
+
+  static bool test(const word_type* bits, std::size_t i) {
+    auto bit = std::uint64_t(1) << (i % word_bits);
+    return (bits[i / word_bits].load(std::memory_order_relaxed) & bit) != 0;
+  }
+
+  static void set(word_type* bits, std::size_t i) {
+    auto bit = std::uint64_t(1) << (i % word_bits);
+    auto prev = bits[i / word_bits].fetch_or(bit, std::memory_order_relaxed);
+    (void)prev;
+    assert((prev & bit) == 0);
+  }
+
+  void element_done(std::size_t i);
+  void complete();
+
+  std::size_t size_;
+  std::atomic<std::size_t> remaining_;
+  std::atomic<std::size_t> ref_count_ = 1;
+  std::atomic<std::size_t> producers_ = 1;
+
+  std::mutex errors_mtx_;
+  std::vector<error_type, error_alloc_type> errors_;
+
+  Storage_ptr<storage_type> dst_;
+};
+
+template <typename Alloc, typename T>
+Array_block<Alloc, T>* Array_block<Alloc, T>::create(
+    std::size_t n, const Alloc& alloc, Storage_ptr<storage_type> dst) {
+  using unit_alloc =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<unit_type>;
+
+  unit_alloc real_alloc(alloc);
+  auto count = unit_count(n);
+  unit_type* raw = real_alloc.allocate(count);
+
+  Array_block* result = nullptr;
+  try {
+    result = new (raw) Array_block(n, alloc, std::move(dst));
+  } catch (...) {
+    real_alloc.deallocate(raw, count);
+    throw;
+  }
+
+  if (n == 0) {
+    result->complete();
+  }
+  return result;
+}
+
+template <typename Alloc, typename T>
+Array_block<Alloc, T>::Array_block(std::size_t n, const Alloc& alloc,
+                                   Storage_ptr<storage_type> dst)
+    : Alloc(alloc),
+      size_(n),
+      remaining_(n),
+      errors_(error_alloc_type(alloc)),
+      dst_(std::move(dst)) {
+  auto bits = done_bits();
+  for (std::size_t i = 0; i < 2 * word_count(n); ++i) {
+    new (&bits[i]) word_type(0);
+  }
+
+  std::uninitialized_value_construct_n(values(), n);
+}
+
+template <typename Alloc, typename T>
+Array_block<Alloc, T>::~Array_block() {
+  std::destroy_n(values(), size_);
+}
+
+template <typename Alloc, typename T>
+void Array_block<Alloc, T>::release() {
+  if (ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    using unit_alloc =
+        typename std::allocator_traits<Alloc>::template rebind_alloc<unit_type>;
+
+    unit_alloc real_alloc(allocator());
+    auto count = unit_count(size_);
+    this->~Array_block();
+    real_alloc.deallocate(reinterpret_cast<unit_type*>(this), count);
+  }
+}
+
+template <typename Alloc, typename T>
+void Array_block<Alloc, T>::release_producer() {
+  if (producers_.fetch_sub(1, std::memory_order_acq_rel) == 1 &&
+      remaining_.load() != 0) {
+    auto err = std::make_exception_ptr(Unfullfilled_promise{});
+    for (std::size_t i = 0; i < size_; ++i) {
+      if (!test(done_bits(), i)) {
+        set_exception(i, err);
+      }
+    }
+  }
+}
+
+template <typename Alloc, typename T>
+template <typename... Us>
+void Array_block<Alloc, T>::set_value(std::size_t i, Us&&... vals) {
+  assert(i < size_);
+  values()[i] = T(std::forward<Us>(vals)...);
+  element_done(i);
+}
+
+template <typename Alloc, typename T>
+void Array_block<Alloc, T>::set_exception(std::size_t i, std::exception_ptr e) {
+  assert(i < size_);
+  {
+    std::lock_guard l(errors_mtx_);
+    errors_.emplace_back(i, std::move(e));
+  }
+  set(failed_bits(), i);
+  element_done(i);
+}
+
+template <typename Alloc, typename T>
+std::exception_ptr Array_block<Alloc, T>::error(std::size_t i) const {
+  if (!is_failed(i)) {
+    return nullptr;
+  }
+
+  // errors_ is sorted by complete()
+  auto found = std::lower_bound(
+      errors_.begin(), errors_.end(), i,
+      [](const error_type& e, std::size_t id) { return e.first < id; });
+  assert(found != errors_.end() && found->first == i);
+  return found->second;
+}
+
+template <typename Alloc, typename T>
+void Array_block<Alloc, T>::element_done(std::size_t i) {
+  set(done_bits(), i);
+  if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    complete();
+  }
+}
+
+template <typename Alloc, typename T>
+void Array_block<Alloc, T>::complete() {
+  std::sort(errors_.begin(), errors_.end(),
+            [](const error_type& lhs, const error_type& rhs) {
+              return lhs.first < rhs.first;
+            });
+
+  // The result refers to this, so dst_ must not outlive the delivery.
+  auto dst = std::move(dst_);
+  dst->fullfill(std::make_tuple(result_type(this)));
+}
+
+}  // namespace detail
+}  // namespace aom
+#endif
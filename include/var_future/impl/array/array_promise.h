@@ -0,0 +1,155 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_IMPL_ARRAY_PROMISE_INCLUDED_H
+#define AOM_VARIADIC_IMPL_ARRAY_PROMISE_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include "var_future/impl/array/array_block.h"
+
+namespace aom {
+
+template <typename Alloc, typename T>
+Basic_array_promise<Alloc, T>::Basic_array_promise(std::size_t n,
+                                                   const Alloc& alloc) {
+  storage_.allocate(alloc);
+  block_ = block_type::create(n, alloc, storage_);
+}
+
+template <typename Alloc, typename T>
+Basic_array_promise<Alloc, T>::Basic_array_promise(Basic_array_promise&& rhs)
+    : block_(rhs.block_), storage_(std::move(rhs.storage_)) {
+  rhs.block_ = nullptr;
+}
+
+template <typename Alloc, typename T>
+Basic_array_promise<Alloc, T>& Basic_array_promise<Alloc, T>::operator=(
+    Basic_array_promise&& rhs) {
+  if (block_) {
+    block_->release_producer();
+    block_->release();
+  }
+
+  block_ = rhs.block_;
+  storage_ = std::move(rhs.storage_);
+  rhs.block_ = nullptr;
+  return *this;
+}
+
+template <typename Alloc, typename T>
+Basic_array_promise<Alloc, T>::~Basic_array_promise() {
+  if (block_) {
+    block_->release_producer();
+    block_->release();
+  }
+}
+
+template <typename Alloc, typename T>
+typename Basic_array_promise<Alloc, T>::future_type
+Basic_array_promise<Alloc, T>::get_future() {
+  assert(storage_);
+  return future_type{std::move(storage_)};
+}
+
+template <typename Alloc, typename T>
+std::size_t Basic_array_promise<Alloc, T>::size() const {
+  assert(block_);
+  return block_->size();
+}
+
+template <typename Alloc, typename T>
+template <typename... Us>
+void Basic_array_promise<Alloc, T>::set_value(std::size_t i, Us&&... vals) {
+  assert(block_);
+  block_->set_value(i, std::forward<Us>(vals)...);
+}
+
+template <typename Alloc, typename T>
+void Basic_array_promise<Alloc, T>::set_exception(std::size_t i,
+                                                  std::exception_ptr e) {
+  assert(block_);
+  block_->set_exception(i, std::move(e));
+}
+
+template <typename Alloc, typename T>
+typename Basic_array_promise<Alloc, T>::element_type
+Basic_array_promise<Alloc, T>::element(std::size_t i) {
+  assert(block_ && i < block_->size());
+  return element_type(block_, i);
+}
+
+template <typename Alloc, typename T>
+Basic_array_element_promise<Alloc, T>::Basic_array_element_promise(
+    block_type* block, std::size_t index)
+    : block_(block), index_(index) {
+  block_->add_ref();
+  block_->add_producer();
+}
+
+template <typename Alloc, typename T>
+Basic_array_element_promise<Alloc, T>::Basic_array_element_promise(
+    Basic_array_element_promise&& rhs)
+    : block_(rhs.block_), index_(rhs.index_) {
+  rhs.block_ = nullptr;
+}
+
+template <typename Alloc, typename T>
+Basic_array_element_promise<Alloc, T>& Basic_array_element_promise<
+    Alloc, T>::operator=(Basic_array_element_promise&& rhs) {
+  if (block_) {
+    set_exception(std::make_exception_ptr(Unfullfilled_promise{}));
+  }
+
+  block_ = rhs.block_;
+  index_ = rhs.index_;
+  rhs.block_ = nullptr;
+  return *this;
+}
+
+template <typename Alloc, typename T>
+Basic_array_element_promise<Alloc, T>::~Basic_array_element_promise() {
+  if (block_) {
+    set_exception(std::make_exception_ptr(Unfullfilled_promise{}));
+  }
+}
+
+template <typename Alloc, typename T>
+template <typename... Us>
+void Basic_array_element_promise<Alloc, T>::set_value(Us&&... vals) {
+  assert(block_);
+  block_->set_value(index_, std::forward<Us>(vals)...);
+
+  block_->release_producer();
+  block_->release();
+  block_ = nullptr;
+}
+
+template <typename Alloc, typename T>
+void Basic_array_element_promise<Alloc, T>::set_exception(
+    std::exception_ptr e) {
+  assert(block_);
+  block_->set_exception(index_, std::move(e));
+
+  block_->release_producer();
+  block_->release();
+  block_ = nullptr;
+}
+
+template <typename Alloc, typename T>
+Basic_array_element_promise<Alloc, T>::operator bool() const {
+  return block_ != nullptr;
+}
+}  // namespace aom
+#endif
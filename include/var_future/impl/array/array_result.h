@@ -0,0 +1,142 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_IMPL_ARRAY_RESULT_INCLUDED_H
+#define AOM_VARIADIC_IMPL_ARRAY_RESULT_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include "var_future/impl/array/array_block.h"
+
+namespace aom {
+
+template <typename Alloc, typename T>
+Basic_array_result<Alloc, T>::Basic_array_result(block_type* block)
+    : block_(block) {
+  block_->add_ref();
+}
+
+template <typename Alloc, typename T>
+Basic_array_result<Alloc, T>::Basic_array_result(
+    const Basic_array_result& rhs)
+    : block_(rhs.block_) {
+  if (block_) {
+    block_->add_ref();
+  }
+}
+
+template <typename Alloc, typename T>
+Basic_array_result<Alloc, T>::Basic_array_result(Basic_array_result&& rhs)
+    : block_(rhs.block_) {
+  rhs.block_ = nullptr;
+}
+
+template <typename Alloc, typename T>
+Basic_array_result<Alloc, T>& Basic_array_result<Alloc, T>::operator=(
+    const Basic_array_result& rhs) {
+  if (rhs.block_) {
+    rhs.block_->add_ref();
+  }
+  if (block_) {
+    block_->release();
+  }
+  block_ = rhs.block_;
+  return *this;
+}
+
+template <typename Alloc, typename T>
+Basic_array_result<Alloc, T>& Basic_array_result<Alloc, T>::operator=(
+    Basic_array_result&& rhs) {
+  if (this != &rhs) {
+    if (block_) {
+      block_->release();
+    }
+    block_ = rhs.block_;
+    rhs.block_ = nullptr;
+  }
+  return *this;
+}
+
+template <typename Alloc, typename T>
+Basic_array_result<Alloc, T>::~Basic_array_result() {
+  if (block_) {
+    block_->release();
+  }
+}
+
+template <typename Alloc, typename T>
+std::size_t Basic_array_result<Alloc, T>::size() const {
+  return block_ ? block_->size() : 0;
+}
+
+template <typename Alloc, typename T>
+T* Basic_array_result<Alloc, T>::data() {
+  return block_ ? block_->values() : nullptr;
+}
+
+template <typename Alloc, typename T>
+const T* Basic_array_result<Alloc, T>::data() const {
+  return block_ ? block_->values() : nullptr;
+}
+
+template <typename Alloc, typename T>
+T* Basic_array_result<Alloc, T>::begin() {
+  return data();
+}
+
+template <typename Alloc, typename T>
+T* Basic_array_result<Alloc, T>::end() {
+  return data() + size();
+}
+
+template <typename Alloc, typename T>
+const T* Basic_array_result<Alloc, T>::begin() const {
+  return data();
+}
+
+template <typename Alloc, typename T>
+const T* Basic_array_result<Alloc, T>::end() const {
+  return data() + size();
+}
+
+template <typename Alloc, typename T>
+T& Basic_array_result<Alloc, T>::operator[](std::size_t i) {
+  assert(i < size());
+  return data()[i];
+}
+
+template <typename Alloc, typename T>
+const T& Basic_array_result<Alloc, T>::operator[](std::size_t i) const {
+  assert(i < size());
+  return data()[i];
+}
+
+template <typename Alloc, typename T>
+bool Basic_array_result<Alloc, T>::is_failed(std::size_t i) const {
+  assert(i < size());
+  return block_->is_failed(i);
+}
+
+template <typename Alloc, typename T>
+std::exception_ptr Basic_array_result<Alloc, T>::error(std::size_t i) const {
+  assert(i < size());
+  return block_->error(i);
+}
+
+template <typename Alloc, typename T>
+std::size_t Basic_array_result<Alloc, T>::error_count() const {
+  return block_ ? block_->error_count() : 0;
+}
+}  // namespace aom
+#endif
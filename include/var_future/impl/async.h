@@ -17,23 +17,190 @@
 
 #include "var_future/config.h"
 
+#include "var_future/impl/storage_decl.h"
+#include "var_future/impl/utils.h"
+
+#include <memory>
+#include <vector>
+
 namespace aom {
-template <typename QueueT, typename CbT>
-auto async(QueueT& q, CbT&& cb) {
+
+namespace detail {
+
+// The results of async_bulk() come from the same allocator as the rest of its
+// state.
+template <typename Alloc, typename T>
+struct Bulk_result {
+  using alloc_type =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+  using type = std::vector<T, alloc_type>;
+};
+
+template <typename Alloc>
+struct Bulk_result<Alloc, void> {
+  using type = void;
+};
+
+// Shared by all the tasks of a async_bulk() call. The results of every task
+// land in a single buffer.
+template <typename Alloc, typename T>
+struct Bulk_landing {
+  static constexpr bool is_void = std::is_same_v<void, T>;
+
+  // Tasks write to their own slot concurrently.
+  static_assert(!std::is_same_v<bool, T>,
+                "std::vector<bool> cannot be written to concurrently");
+
+  static_assert(is_void || std::is_default_constructible_v<T>,
+                "async_bulk() results must be default constructible");
+
+  using value_type = typename Bulk_result<Alloc, T>::type;
+  using storage_type = Future_storage<Alloc, value_type>;
+  using values_type = std::conditional_t<is_void, std::tuple<>, value_type>;
+
+  static values_type make_values(std::size_t n, const Alloc& alloc) {
+    if constexpr (is_void) {
+      return {};
+    } else {
+      using vector_alloc = typename value_type::allocator_type;
+      return values_type(n, vector_alloc(alloc));
+    }
+  }
+
+  Bulk_landing(std::size_t n, const Alloc& alloc, Storage_ptr<storage_type> dst)
+      : values_(make_values(n, alloc)), remaining_(n), dst_(std::move(dst)) {}
+
+  template <typename CbT>
+  void run(CbT& cb, std::size_t i) {
+    try {
+      if constexpr (is_void) {
+        cb(i);
+      } else {
+        values_[i] = cb(i);
+      }
+    } catch (...) {
+      record_error(std::current_exception());
+    }
+  }
+
+  // The first error wins.
+  void record_error(std::exception_ptr e) {
+    if (!failed_.exchange(true)) {
+      error_ = std::move(e);
+    }
+  }
+
+  // Accounts for count tasks being over, and returns true if they were the
+  // last ones, in which case dst_ has been finished.
+  bool finish(std::size_t count) {
+    if (remaining_.fetch_sub(count, std::memory_order_acq_rel) != count) {
+      return false;
+    }
+
+    if (error_) {
+      dst_->fail(std::move(error_));
+    } else if constexpr (is_void) {
+      dst_->fullfill(std::tuple<>{});
+    } else {
+      dst_->fullfill(std::make_tuple(std::move(values_)));
+    }
+    return true;
+  }
+
+  values_type values_;
+  std::atomic<std::size_t> remaining_;
+  std::atomic<bool> failed_ = false;
+  std::exception_ptr error_;
+  Storage_ptr<storage_type> dst_;
+};
+
+// Owns itself, and is released by whoever finishes its last task.
+template <typename Alloc, typename CbT>
+struct Bulk_landing_with_cb
+    : public Bulk_landing<Alloc, decltype(std::declval<CbT&>()(std::size_t()))> {
+  using parent_type =
+      Bulk_landing<Alloc, decltype(std::declval<CbT&>()(std::size_t()))>;
+  using self_alloc = typename std::allocator_traits<
+      Alloc>::template rebind_alloc<Bulk_landing_with_cb>;
+
+  Bulk_landing_with_cb(std::size_t n, const Alloc& alloc,
+                       Storage_ptr<typename parent_type::storage_type> dst,
+                       CbT cb)
+      : parent_type(n, alloc, std::move(dst)), cb_(std::move(cb)) {}
+
+  template <typename... ArgTs>
+  static Bulk_landing_with_cb* create(const Alloc& alloc, ArgTs&&... args) {
+    self_alloc real_alloc(alloc);
+    auto ptr = real_alloc.allocate(1);
+    try {
+      return new (ptr) Bulk_landing_with_cb(std::forward<ArgTs>(args)...);
+    } catch (...) {
+      real_alloc.deallocate(ptr, 1);
+      throw;
+    }
+  }
+
+  void run(std::size_t i) {
+    parent_type::run(cb_, i);
+    finish(1);
+  }
+
+  // Fails the result on behalf of count tasks that will never run.
+  void abandon(std::size_t count, std::exception_ptr e) {
+    this->record_error(std::move(e));
+    finish(count);
+  }
+
+ private:
+  void finish(std::size_t count) {
+    struct Release {
+      ~Release() {
+        if (self) {
+          self_alloc real_alloc(self->dst_->allocator());
+          self->~Bulk_landing_with_cb();
+          real_alloc.deallocate(self, 1);
+        }
+      }
+      Bulk_landing_with_cb* self;
+    } release{nullptr};
+
+    if (parent_type::finish(count)) {
+      release.self = this;
+    }
+  }
+
+  CbT cb_;
+};
+
+// A single task of a async_bulk() call. Small enough to fit in the inline
+// buffer of most type-erased queues.
+template <typename LandingT>
+struct Bulk_task {
+  void operator()() const { landing_->run(index_); }
+
+  LandingT* landing_;
+  std::size_t index_;
+};
+}  // namespace detail
+
+template <typename QueueT, typename Alloc, typename CbT>
+auto async(QueueT& q, const Alloc& alloc, CbT&& cb) {
   using cb_result_type = decltype(cb());
 
   using dst_storage_type =
-      detail::Storage_for_cb_result_t<std::allocator<void>, cb_result_type>;
+      detail::Storage_for_cb_result_t<Alloc, cb_result_type>;
   using result_fut_t = typename dst_storage_type::future_type;
 
   detail::Storage_ptr<dst_storage_type> res;
-  res.allocate(std::allocator<void>());
+  res.allocate(alloc);
 
   detail::enqueue(&q, [cb = std::move(cb), res] {
     try {
       if constexpr (std::is_same_v<void, cb_result_type>) {
         cb();
-        res->fullfill();
+        res->fullfill(std::tuple<>{});
+      } else if constexpr (detail::is_expected_v<cb_result_type>) {
+        res->finish(cb());
       } else {
         res->fullfill(cb());
       }
@@ -44,5 +211,63 @@ auto async(QueueT& q, CbT&& cb) {
 
   return result_fut_t{res};
 }
+
+template <typename QueueT, typename CbT>
+auto async(QueueT& q, CbT&& cb) {
+  return async(q, std::allocator<void>(), std::forward<CbT>(cb));
+}
+
+template <typename QueueT, typename Alloc, typename CbT>
+auto async_bulk(QueueT& q, const Alloc& alloc, std::size_t n, CbT&& cb) {
+  using landing_type = detail::Bulk_landing_with_cb<Alloc, std::decay_t<CbT>>;
+  using storage_type = typename landing_type::storage_type;
+  using result_fut_t = typename storage_type::future_type;
+
+  static_assert(!is_future_v<typename landing_type::value_type>,
+                "async_bulk() callbacks cannot return futures");
+
+  detail::Storage_ptr<storage_type> res;
+  res.allocate(alloc);
+
+  if (n == 0) {
+    res->fullfill(landing_type::make_values(0, alloc));
+    return result_fut_t{std::move(res)};
+  }
+
+  auto landing = landing_type::create(alloc, n, alloc, res,
+                                      std::forward<CbT>(cb));
+
+  // Tasks that were not enqueued will never run, the landing has to account
+  // for them itself. A throwing push_bulk() is assumed to enqueue nothing.
+  std::size_t enqueued = 0;
+  try {
+    if constexpr (detail::has_push_bulk_v<QueueT>) {
+      using task_type = detail::Bulk_task<landing_type>;
+      using task_alloc = typename std::allocator_traits<
+          Alloc>::template rebind_alloc<task_type>;
+
+      std::vector<task_type, task_alloc> tasks{task_alloc(alloc)};
+      tasks.reserve(n);
+      for (std::size_t i = 0; i < n; ++i) {
+        tasks.push_back(task_type{landing, i});
+      }
+      detail::enqueue_bulk(&q, tasks.begin(), tasks.end());
+      enqueued = n;
+    } else {
+      for (; enqueued < n; ++enqueued) {
+        detail::enqueue(&q, detail::Bulk_task<landing_type>{landing, enqueued});
+      }
+    }
+  } catch (...) {
+    landing->abandon(n - enqueued, std::current_exception());
+  }
+
+  return result_fut_t{std::move(res)};
+}
+
+template <typename QueueT, typename CbT>
+auto async_bulk(QueueT& q, std::size_t n, CbT&& cb) {
+  return async_bulk(q, std::allocator<void>(), n, std::forward<CbT>(cb));
+}
 }  // namespace aom
 #endif
@@ -0,0 +1,79 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_IMPL_ASYNC_SCOPE_INCLUDED_H
+#define AOM_VARIADIC_IMPL_ASYNC_SCOPE_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include <cassert>
+#include <utility>
+
+namespace aom {
+
+inline Async_scope::~Async_scope() { assert(pending_ == 0); }
+
+template <typename Alloc, typename... Ts>
+void Async_scope::spawn(Basic_future<Alloc, Ts...> fut) {
+  pending_.fetch_add(1, std::memory_order_relaxed);
+
+  // finally() attaches its callback directly to fut's storage, no result
+  // storage is created.
+  fut.finally([this](auto&&...) { release(); });
+}
+
+template <typename QueueT, typename CbT>
+void Async_scope::spawn(QueueT& queue, CbT&& callback) {
+  spawn(async(queue, std::forward<CbT>(callback)));
+}
+
+inline Future<void> Async_scope::on_empty() {
+  std::lock_guard l(waiters_mtx_);
+  if (pending_.load() == 0) {
+    Promise<void> prom;
+    prom.set_value();
+    return prom.get_future();
+  }
+
+  waiters_.emplace_back();
+  return waiters_.back().get_future();
+}
+
+inline void Async_scope::release() {
+  auto prev = pending_.load(std::memory_order_relaxed);
+  while (prev > 1) {
+    if (pending_.compare_exchange_weak(prev, prev - 1,
+                                       std::memory_order_acq_rel)) {
+      return;
+    }
+  }
+
+  // Emptying the scope happens under the lock, so that on_empty() can not
+  // observe it, and let the scope be destroyed, while this is still using it.
+  std::vector<Promise<void>> waiters;
+  {
+    std::lock_guard l(waiters_mtx_);
+    if (pending_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+      return;
+    }
+    waiters = std::move(waiters_);
+    waiters_.clear();
+  }
+
+  for (auto& w : waiters) {
+    w.set_value();
+  }
+}
+}  // namespace aom
+#endif
@@ -0,0 +1,101 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_IMPL_AWAITABLE_INCLUDED_H
+#define AOM_VARIADIC_IMPL_AWAITABLE_INCLUDED_H
+
+#include "var_future/config.h"
+
+#if AOM_VARFUT_HAS_COROUTINES
+
+#include "var_future/impl/utils.h"
+
+#include <atomic>
+#include <coroutine>
+#include <optional>
+#include <tuple>
+
+namespace aom {
+
+namespace detail {
+
+// Suspends the awaiting coroutine until the future is finished, and resumes
+// it from wherever that happens.
+template <typename Alloc, typename... Ts>
+class Future_awaiter {
+ public:
+  using value_type = typename Basic_future<Alloc, Ts...>::value_type;
+
+  explicit Future_awaiter(Basic_future<Alloc, Ts...>&& f)
+      : fut_(std::move(f)) {}
+
+  bool await_ready() const { return fut_.is_ready(); }
+
+  bool await_suspend(std::coroutine_handle<> h) {
+    handle_ = h;
+    fut_.finally([this](expected<Ts>... vals) {
+      result_.emplace(std::move(vals)...);
+
+      // Whoever gets there second resumes the coroutine.
+      if (resumable_.exchange(true)) {
+        handle_.resume();
+      }
+    });
+
+    return !resumable_.exchange(true);
+  }
+
+  value_type await_resume() {
+    if (!result_) {
+      // await_ready() returned true.
+      return fut_.get();
+    }
+
+    auto err = std::apply(get_first_error<Ts...>, *result_);
+    if (err) {
+      std::rethrow_exception(*err);
+    }
+
+    if constexpr (!std::is_same_v<value_type, void>) {
+      auto values = finish_to_fullfill<Ts...>(std::move(*result_));
+      if constexpr (std::tuple_size_v<decltype(values)> == 1) {
+        return std::move(std::get<0>(values));
+      } else {
+        return values;
+      }
+    }
+  }
+
+ private:
+  Basic_future<Alloc, Ts...> fut_;
+  std::coroutine_handle<> handle_;
+  std::optional<finish_type_t<Ts...>> result_;
+  std::atomic<bool> resumable_ = false;
+};
+}  // namespace detail
+
+/**
+ * @brief Suspends the calling coroutine until f is finished.
+ *
+ * @return The value of f, as returned by Basic_future::get().
+ */
+template <typename Alloc, typename... Ts>
+detail::Future_awaiter<Alloc, Ts...> operator co_await(
+    Basic_future<Alloc, Ts...>&& f) {
+  return detail::Future_awaiter<Alloc, Ts...>(std::move(f));
+}
+}  // namespace aom
+
+#endif
+#endif
@@ -178,6 +178,40 @@ Basic_future<Alloc, Ts...>::get() {
   return std_future().get();
 }
 
+template <typename Alloc, typename... Ts>
+bool Basic_future<Alloc, Ts...>::is_ready() const {
+  assert(storage_);
+  return storage_->is_finished();
+}
+
+template <typename Alloc, typename... Ts>
+std::optional<expected<typename Basic_future<Alloc, Ts...>::value_type>>
+Basic_future<Alloc, Ts...>::try_get() {
+  assert(storage_);
+  if (!storage_->is_finished()) {
+    return std::nullopt;
+  }
+
+  auto storage = std::move(storage_);
+  auto& finished = storage->finished();
+
+  auto err = std::apply(detail::get_first_error<Ts...>, finished);
+  if (err) {
+    return expected<value_type>(unexpected{*err});
+  }
+
+  if constexpr (std::is_same_v<void, value_type>) {
+    return expected<void>();
+  } else {
+    auto values = detail::finish_to_fullfill<Ts...>(std::move(finished));
+    if constexpr (std::tuple_size_v<decltype(values)> == 1) {
+      return expected<value_type>(std::move(std::get<0>(values)));
+    } else {
+      return expected<value_type>(std::move(values));
+    }
+  }
+}
+
 template <typename Alloc, typename... Ts>
 Alloc& Basic_future<Alloc, Ts...>::allocator() {
   assert(storage_);
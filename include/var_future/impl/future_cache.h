@@ -0,0 +1,232 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_IMPL_FUTURE_CACHE_INCLUDED_H
+#define AOM_VARIADIC_IMPL_FUTURE_CACHE_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include <cassert>
+#include <optional>
+#include <utility>
+
+namespace aom {
+
+template <typename K, typename T, typename Hash>
+Future_cache<K, T, Hash>::Future_cache() : Future_cache(Options()) {}
+
+template <typename K, typename T, typename Hash>
+Future_cache<K, T, Hash>::Future_cache(Options options)
+    : options_(std::move(options)) {
+  assert(options_.shards > 0);
+
+  if (options_.max_entries != 0) {
+    max_per_shard_ =
+        (options_.max_entries + options_.shards - 1) / options_.shards;
+  }
+
+  shards_.reserve(options_.shards);
+  for (std::size_t i = 0; i < options_.shards; ++i) {
+    shards_.push_back(std::make_shared<Shard>());
+  }
+}
+
+template <typename K, typename T, typename Hash>
+const std::shared_ptr<typename Future_cache<K, T, Hash>::Shard>&
+Future_cache<K, T, Hash>::shard_for(const K& key) const {
+  return shards_[Hash()(key) % shards_.size()];
+}
+
+template <typename K, typename T, typename Hash>
+template <typename LoaderT>
+typename Future_cache<K, T, Hash>::future_type Future_cache<K, T, Hash>::get(
+    const K& key, LoaderT&& loader) {
+  auto shard = shard_for(key);
+  auto ttl = options_.ttl;
+  auto max_entries = max_per_shard_;
+
+  Promise<value_ptr> prom;
+  auto result = prom.get_future();
+
+  std::uint64_t load_id = 0;
+  {
+    std::lock_guard l(shard->mtx);
+
+    auto found = shard->entries.find(key);
+    if (found != shard->entries.end()) {
+      auto& entry = found->second;
+
+      if (!entry.value) {
+        // Single flight: wait on the load that is already going.
+        entry.waiters.push_back(std::move(prom));
+        return result;
+      }
+
+      if (ttl == clock_type::duration::zero() ||
+          clock_type::now() < entry.expires) {
+        shard->lru.splice(shard->lru.begin(), shard->lru, entry.lru_pos);
+        prom.set_value(entry.value);
+        return result;
+      }
+
+      shard->lru.erase(entry.lru_pos);
+      shard->entries.erase(found);
+    }
+
+    load_id = ++shard->next_load_id;
+    auto& entry = shard->entries[key];
+    entry.load_id = load_id;
+    entry.waiters.push_back(std::move(prom));
+  }
+
+  // The load is started outside of the lock, since it may complete
+  // synchronously.
+  auto on_done = [shard, key, load_id, ttl, max_entries](expected<T> v) {
+    complete(*shard, key, load_id, std::move(v), ttl, max_entries);
+  };
+
+  // Only the loader's failures are caught, so that on_done is invoked exactly
+  // once, even if the continuations of the waiters throw.
+  using load_result_type = std::decay_t<decltype(loader(key))>;
+  if constexpr (is_future_v<load_result_type>) {
+    std::optional<load_result_type> load;
+    try {
+      load.emplace(loader(key));
+    } catch (...) {
+      on_done(expected<T>(unexpected{std::current_exception()}));
+      return result;
+    }
+    load->finally(std::move(on_done));
+  } else {
+    std::optional<expected<T>> loaded;
+    try {
+      loaded.emplace(loader(key));
+    } catch (...) {
+      loaded.emplace(unexpected{std::current_exception()});
+    }
+    on_done(std::move(*loaded));
+  }
+
+  return result;
+}
+
+template <typename K, typename T, typename Hash>
+void Future_cache<K, T, Hash>::complete(Shard& shard, const K& key,
+                                        std::uint64_t load_id,
+                                        expected<T> result,
+                                        clock_type::duration ttl,
+                                        std::size_t max_entries) {
+  // The value is stored once, and shared by every waiter.
+  value_ptr value;
+  if (result.has_value()) {
+    value = std::make_shared<const T>(std::move(*result));
+  }
+
+  std::vector<Promise<value_ptr>> waiters;
+  {
+    std::lock_guard l(shard.mtx);
+
+    auto found = shard.entries.find(key);
+    if (found != shard.entries.end() && found->second.load_id == load_id) {
+      auto& entry = found->second;
+      waiters = std::move(entry.waiters);
+      entry.waiters.clear();
+
+      if (value) {
+        entry.value = value;
+        entry.expires = clock_type::now() + ttl;
+        shard.lru.push_front(key);
+        entry.lru_pos = shard.lru.begin();
+        evict(shard, max_entries);
+      } else {
+        shard.entries.erase(found);
+      }
+    } else {
+      auto orphaned = shard.orphans.find(load_id);
+      assert(orphaned != shard.orphans.end());
+      waiters = std::move(orphaned->second);
+      shard.orphans.erase(orphaned);
+    }
+  }
+
+  for (auto& w : waiters) {
+    if (value) {
+      w.set_value(value);
+    } else {
+      w.set_exception(result.error());
+    }
+  }
+}
+
+template <typename K, typename T, typename Hash>
+void Future_cache<K, T, Hash>::evict(Shard& shard, std::size_t max_entries) {
+  if (max_entries == 0) {
+    return;
+  }
+
+  while (shard.lru.size() > max_entries) {
+    shard.entries.erase(shard.lru.back());
+    shard.lru.pop_back();
+  }
+}
+
+template <typename K, typename T, typename Hash>
+void Future_cache<K, T, Hash>::orphan(Shard& shard, Entry& entry) {
+  assert(!entry.value);
+  shard.orphans.emplace(entry.load_id, std::move(entry.waiters));
+}
+
+template <typename K, typename T, typename Hash>
+void Future_cache<K, T, Hash>::erase(const K& key) {
+  auto& shard = *shard_for(key);
+  std::lock_guard l(shard.mtx);
+
+  auto found = shard.entries.find(key);
+  if (found == shard.entries.end()) {
+    return;
+  }
+
+  if (found->second.value) {
+    shard.lru.erase(found->second.lru_pos);
+  } else {
+    orphan(shard, found->second);
+  }
+  shard.entries.erase(found);
+}
+
+template <typename K, typename T, typename Hash>
+void Future_cache<K, T, Hash>::clear() {
+  for (auto& shard : shards_) {
+    std::lock_guard l(shard->mtx);
+    for (auto& kv : shard->entries) {
+      if (!kv.second.value) {
+        orphan(*shard, kv.second);
+      }
+    }
+    shard->entries.clear();
+    shard->lru.clear();
+  }
+}
+
+template <typename K, typename T, typename Hash>
+std::size_t Future_cache<K, T, Hash>::size() const {
+  std::size_t result = 0;
+  for (auto& shard : shards_) {
+    std::lock_guard l(shard->mtx);
+    result += shard->entries.size();
+  }
+  return result;
+}
+}  // namespace aom
+#endif
@@ -70,7 +70,7 @@ auto join(FirstT&& first, FutTs&&... futs) {
                       std::decay_t<FirstT>, std::decay_t<FutTs>...>;
   using fut_type = typename landing_type::storage_type::future_type;
 
-  auto landing = std::make_shared<landing_type>();
+  auto landing = std::allocate_shared<landing_type>(first.allocator());
   landing->dst_.allocate(first.allocator());
 
   detail::bind_landing<0>(landing, std::forward<FirstT>(first),
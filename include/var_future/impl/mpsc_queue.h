@@ -0,0 +1,169 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef AOM_VARIADIC_IMPL_MPSC_QUEUE_INCLUDED_H
+#define AOM_VARIADIC_IMPL_MPSC_QUEUE_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <utility>
+
+namespace aom {
+
+namespace detail {
+
+// Link of an Intrusive_mpsc_queue, to be derived from by the queued type.
+struct Mpsc_node {
+  std::atomic<Mpsc_node*> next = nullptr;
+};
+
+// Vyukov's unbounded lock-free queue of nodes owned by the caller, with any
+// number of producers, and a single consumer at a time.
+//
+// push() is wait-free. A node is visible to the consumer as soon as the push()
+// that produced it returns, with one caveat: a push() that is still in
+// progress can briefly hide the nodes that were pushed after it started.
+class Intrusive_mpsc_queue {
+ public:
+  Intrusive_mpsc_queue() : head_(&stub_), tail_(&stub_) {}
+
+  void push(Mpsc_node* n) {
+    n->next.store(nullptr, std::memory_order_relaxed);
+    Mpsc_node* prev = head_.exchange(n, std::memory_order_acq_rel);
+    prev->next.store(n, std::memory_order_release);
+  }
+
+  // Consumer only. Hands the oldest node back to the caller, or returns
+  // nullptr if there is none to be seen.
+  Mpsc_node* try_pop() {
+    Mpsc_node* tail = tail_;
+    Mpsc_node* next = tail->next.load(std::memory_order_acquire);
+
+    if (tail == &stub_) {
+      if (!next) {
+        return nullptr;
+      }
+      tail_ = next;
+      tail = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+
+    if (next) {
+      tail_ = next;
+      return tail;
+    }
+
+    if (tail != head_.load(std::memory_order_acquire)) {
+      // A producer is in the middle of linking a node after tail.
+      return nullptr;
+    }
+
+    // tail is the last node, the stub takes its place so it can be handed out.
+    push(&stub_);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next) {
+      tail_ = next;
+      return tail;
+    }
+    return nullptr;
+  }
+
+  // Consumer only. Waits for a node that is known to have been pushed.
+  Mpsc_node* pop() {
+    while (true) {
+      if (auto n = try_pop()) {
+        return n;
+      }
+      std::this_thread::yield();
+    }
+  }
+
+ private:
+  Mpsc_node stub_;
+  std::atomic<Mpsc_node*> head_;
+  Mpsc_node* tail_;
+
+  Intrusive_mpsc_queue(const Intrusive_mpsc_queue&) = delete;
+  Intrusive_mpsc_queue& operator=(const Intrusive_mpsc_queue&) = delete;
+};
+
+// Intrusive_mpsc_queue of values, each in a node of its own, allocated
+// through Alloc.
+template <typename T, typename Alloc = std::allocator<T>>
+class Mpsc_queue {
+ public:
+  Mpsc_queue() = default;
+  explicit Mpsc_queue(const Alloc& alloc) : alloc_(alloc) {}
+
+  ~Mpsc_queue() {
+    while (try_pop()) {
+    }
+  }
+
+  template <typename... Args>
+  void push(Args&&... args) {
+    Node* n = node_traits::allocate(alloc_, 1);
+    try {
+      node_traits::construct(alloc_, n, std::forward<Args>(args)...);
+    } catch (...) {
+      node_traits::deallocate(alloc_, n, 1);
+      throw;
+    }
+    nodes_.push(n);
+  }
+
+  // Consumer only.
+  std::optional<T> try_pop() {
+    return take(static_cast<Node*>(nodes_.try_pop()));
+  }
+
+  // Consumer only. Waits for a value that is known to have been pushed.
+  T pop() { return std::move(*take(static_cast<Node*>(nodes_.pop()))); }
+
+ private:
+  struct Node : public Mpsc_node {
+    template <typename... Args>
+    explicit Node(Args&&... args) : value(std::forward<Args>(args)...) {}
+
+    T value;
+  };
+
+  using node_alloc =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<Node>;
+  using node_traits = std::allocator_traits<node_alloc>;
+
+  std::optional<T> take(Node* n) {
+    if (!n) {
+      return std::nullopt;
+    }
+    std::optional<T> result(std::move(n->value));
+    node_traits::destroy(alloc_, n);
+    node_traits::deallocate(alloc_, n, 1);
+    return result;
+  }
+
+  node_alloc alloc_;
+  Intrusive_mpsc_queue nodes_;
+
+  Mpsc_queue(const Mpsc_queue&) = delete;
+  Mpsc_queue& operator=(const Mpsc_queue&) = delete;
+};
+}  // namespace detail
+}  // namespace aom
+#endif
@@ -61,6 +61,25 @@ void Basic_promise<Alloc, Ts...>::set_value(Us&&... vals) {
   if (future_created_) storage_.reset();
 }
 
+template <typename Alloc, typename... Ts>
+template <typename... Args>
+void Basic_promise<Alloc, Ts...>::emplace_value(Args&&... args) {
+  static_assert(sizeof...(Ts) == 1,
+                "emplace_value() needs a single field, use emplace<I>()");
+  emplace<0>(std::forward<Args>(args)...);
+}
+
+template <typename Alloc, typename... Ts>
+template <std::size_t I, typename... Args>
+void Basic_promise<Alloc, Ts...>::emplace(Args&&... args) {
+  assert(storage_ && !value_assigned_);
+
+  if (storage_->template emplace<I>(std::forward<Args>(args)...)) {
+    value_assigned_ = true;
+    if (future_created_) storage_.reset();
+  }
+}
+
 template <typename Alloc, typename... Ts>
 void Basic_promise<Alloc, Ts...>::set_exception(fail_type e) {
   assert(storage_ && !value_assigned_);
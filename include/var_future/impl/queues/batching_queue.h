@@ -0,0 +1,146 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_IMPL_QUEUES_BATCHING_QUEUE_INCLUDED_H
+#define AOM_VARIADIC_IMPL_QUEUES_BATCHING_QUEUE_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include <cassert>
+#include <exception>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace aom {
+
+template <typename QueueT>
+Batching_queue<QueueT>::Batch::Batch(Batching_queue& queue)
+    : queue_(queue), prev_(current_) {
+  current_ = this;
+}
+
+template <typename QueueT>
+Batching_queue<QueueT>::Batch::~Batch() {
+  assert(current_ == this);
+  current_ = prev_;
+
+  // Dropping the tasks would leave their futures pending forever, and the
+  // destructor has nobody to report the failure to.
+  try {
+    flush();
+  } catch (...) {
+    std::terminate();
+  }
+}
+
+template <typename QueueT>
+void Batching_queue<QueueT>::Batch::flush() {
+  if (!tasks_.empty()) {
+    queue_.forward(std::move(tasks_));
+    tasks_.clear();
+  }
+}
+
+template <typename QueueT>
+Batching_queue<QueueT>::Batching_queue(QueueT& dst, std::size_t max_batch)
+    : dst_(dst), max_batch_(max_batch) {
+  assert(max_batch_ > 0);
+}
+
+template <typename QueueT>
+typename Batching_queue<QueueT>::Batch* Batching_queue<QueueT>::current_batch()
+    const {
+  // Batches of other adapters of the same type are not ours.
+  for (auto b = current_; b; b = b->prev_) {
+    if (&b->queue_ == this) {
+      return b;
+    }
+  }
+  return nullptr;
+}
+
+template <typename QueueT>
+template <typename F>
+auto Batching_queue<QueueT>::wrap(F&& f) {
+  // Every task runs within a batch, so that whatever it pushes is coalesced.
+  return [this, f = std::forward<F>(f)]() mutable {
+    Batch batch(*this);
+    f();
+  };
+}
+
+template <typename QueueT>
+template <typename F>
+void Batching_queue<QueueT>::push(F&& f) {
+  auto batch = current_batch();
+  if (!batch) {
+    detail::enqueue(&dst_, wrap(std::forward<F>(f)));
+    return;
+  }
+
+  batch->tasks_.emplace_back(wrap(std::forward<F>(f)));
+  if (batch->tasks_.size() >= max_batch_) {
+    batch->flush();
+  }
+}
+
+template <typename QueueT>
+template <typename ItT>
+void Batching_queue<QueueT>::push_bulk(ItT first, ItT last) {
+  Batch batch(*this);
+  for (; first != last; ++first) {
+    push(*first);
+  }
+}
+
+template <typename QueueT>
+void Batching_queue<QueueT>::Forwarded_tasks::operator()() const {
+  // Every task owns the completion of some future, so they all run even if
+  // one of them throws. The first exception wins.
+  std::exception_ptr error;
+  for (auto i = first; i != last; ++i) {
+    try {
+      (*tasks)[i]();
+    } catch (...) {
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+template <typename QueueT>
+void Batching_queue<QueueT>::forward(std::vector<task_type> tasks) {
+  // The buffered tasks may be move-only, but the underlying queue may require
+  // copyable ones, so they are only referred to by what is forwarded.
+  auto count = tasks.size();
+  auto shared = std::make_shared<std::vector<task_type>>(std::move(tasks));
+
+  if constexpr (detail::has_push_bulk_v<QueueT>) {
+    std::vector<Forwarded_tasks> forwarded;
+    forwarded.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      forwarded.push_back(Forwarded_tasks{shared, i, i + 1});
+    }
+    detail::enqueue_bulk(&dst_, forwarded.begin(), forwarded.end());
+  } else {
+    detail::enqueue(&dst_, Forwarded_tasks{std::move(shared), 0, count});
+  }
+}
+}  // namespace aom
+#endif
@@ -0,0 +1,181 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_IMPL_QUEUES_CONCURRENCY_LIMITER_INCLUDED_H
+#define AOM_VARIADIC_IMPL_QUEUES_CONCURRENCY_LIMITER_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include <cassert>
+#include <exception>
+#include <utility>
+
+namespace aom {
+
+template <typename QueueT>
+typename Concurrency_limiter<QueueT>::Slot&
+Concurrency_limiter<QueueT>::Slot::operator=(Slot&& rhs) {
+  if (this != &rhs) {
+    release();
+    owner_ = rhs.owner_;
+    rhs.owner_ = nullptr;
+  }
+  return *this;
+}
+
+template <typename QueueT>
+Concurrency_limiter<QueueT>::Slot::~Slot() {
+  release();
+}
+
+template <typename QueueT>
+void Concurrency_limiter<QueueT>::Slot::release() {
+  if (owner_) {
+    auto owner = owner_;
+    owner_ = nullptr;
+    owner->release_slot();
+  }
+}
+
+template <typename QueueT>
+Concurrency_limiter<QueueT>::Concurrency_limiter(QueueT& dst,
+                                                 std::size_t max_concurrency)
+    : dst_(dst), max_concurrency_(max_concurrency) {
+  assert(max_concurrency_ > 0);
+}
+
+template <typename QueueT>
+Concurrency_limiter<QueueT>::~Concurrency_limiter() {
+  assert(count_ == 0);
+}
+
+template <typename QueueT>
+template <typename F>
+void Concurrency_limiter<QueueT>::push(F&& f) {
+  submit([f = std::forward<F>(f)](Slot) mutable { f(); });
+}
+
+template <typename QueueT>
+void Concurrency_limiter<QueueT>::submit(task_type task) {
+  // The node must be reachable before it is counted.
+  pending_.push(new Node(std::move(task)));
+
+  if (count_.fetch_add(1, std::memory_order_acq_rel) < max_concurrency_) {
+    dispatch();
+  }
+}
+
+template <typename QueueT>
+void Concurrency_limiter<QueueT>::release_slot() {
+  if (count_.fetch_sub(1, std::memory_order_acq_rel) > max_concurrency_) {
+    try {
+      dispatch();
+    } catch (...) {
+      // There is no submitter to report to, the task has been dropped.
+    }
+  }
+}
+
+template <typename QueueT>
+void Concurrency_limiter<QueueT>::dispatch() {
+  if (dispatching_.fetch_add(1, std::memory_order_acq_rel) != 0) {
+    // Whoever is already dispatching will take care of it.
+    return;
+  }
+
+  // A task that dst_ refuses is dropped, and its slot goes to the next one.
+  // The first such error is rethrown once nothing is left to dispatch.
+  std::exception_ptr error;
+  do {
+    // The count guarantees that a node was pushed, but its producer may still
+    // be in the process of linking it.
+    auto node = static_cast<Node*>(pending_.pop());
+    try {
+      detail::enqueue(&dst_, [this, node] {
+        auto task = std::move(node->task);
+        delete node;
+        task(Slot(this));
+      });
+    } catch (...) {
+      delete node;
+      if (!error) {
+        error = std::current_exception();
+      }
+      // Hands the slot to a waiting task, if any, which this loop dispatches.
+      release_slot();
+    }
+  } while (dispatching_.fetch_sub(1, std::memory_order_acq_rel) != 1);
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+template <typename QueueT, typename Alloc, typename CbT>
+auto async(Concurrency_limiter<QueueT>& q, const Alloc& alloc, CbT&& cb) {
+  using cb_result_type = decltype(cb());
+  using slot_type = typename Concurrency_limiter<QueueT>::Slot;
+
+  using dst_storage_type =
+      detail::Storage_for_cb_result_t<Alloc, cb_result_type>;
+  using result_fut_t = typename dst_storage_type::future_type;
+
+  detail::Storage_ptr<dst_storage_type> res;
+  res.allocate(alloc);
+
+  // The slot is released before res is finished, so that the limiter is
+  // idle by the time the last of its futures is observed as finished.
+  q.submit([cb = std::forward<CbT>(cb), res](slot_type slot) mutable {
+    if constexpr (is_future_v<cb_result_type>) {
+      try {
+        cb().finally([res, slot = std::move(slot)](auto&&... v) mutable {
+          slot.release();
+          res->finish(std::make_tuple(std::move(v)...));
+        });
+      } catch (...) {
+        slot.release();
+        res->fail(std::current_exception());
+      }
+    } else {
+      using result_type =
+          std::conditional_t<detail::is_expected_v<cb_result_type>,
+                             cb_result_type, expected<cb_result_type>>;
+
+      result_type result = [&]() -> result_type {
+        try {
+          if constexpr (std::is_same_v<void, cb_result_type>) {
+            cb();
+            return result_type();
+          } else {
+            return cb();
+          }
+        } catch (...) {
+          return result_type(unexpected{std::current_exception()});
+        }
+      }();
+
+      slot.release();
+      res->finish(std::make_tuple(std::move(result)));
+    }
+  });
+
+  return result_fut_t{res};
+}
+
+template <typename QueueT, typename CbT>
+auto async(Concurrency_limiter<QueueT>& q, CbT&& cb) {
+  return async(q, std::allocator<void>(), std::forward<CbT>(cb));
+}
+}  // namespace aom
+#endif
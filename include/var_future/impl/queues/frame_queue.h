@@ -0,0 +1,87 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_IMPL_QUEUES_FRAME_QUEUE_INCLUDED_H
+#define AOM_VARIADIC_IMPL_QUEUES_FRAME_QUEUE_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include <cassert>
+#include <iterator>
+#include <utility>
+
+namespace aom {
+
+template <typename F>
+void Frame_queue::push(F&& f) {
+  // Counted under the lock, so that the runner never pops a task before it
+  // is counted.
+  std::lock_guard l(mtx_);
+  pushed_.emplace_back(std::forward<F>(f));
+  ++size_;
+}
+
+template <typename PredT>
+std::size_t Frame_queue::run_while(PredT&& keep_going) {
+  assert(runner_.load() == std::thread::id());
+  runner_ = std::this_thread::get_id();
+
+  struct Runner_reset {
+    ~Runner_reset() { self->runner_ = std::thread::id(); }
+    Frame_queue* self;
+  } reset{this};
+
+  std::size_t count = 0;
+  std::vector<task_type> incoming;
+  do {
+    if (carried_.empty()) {
+      {
+        std::lock_guard l(mtx_);
+        std::swap(incoming, pushed_);
+      }
+      carried_.insert(carried_.end(), std::make_move_iterator(incoming.begin()),
+                      std::make_move_iterator(incoming.end()));
+      incoming.clear();
+
+      if (carried_.empty()) {
+        break;
+      }
+    }
+
+    auto task = std::move(carried_.front());
+    carried_.pop_front();
+    --size_;
+    task();
+    ++count;
+  } while (keep_going());
+
+  return count;
+}
+
+inline std::size_t Frame_queue::run_for(clock_type::duration budget) {
+  auto deadline = clock_type::now() + budget;
+  return run_while([&] { return clock_type::now() < deadline; });
+}
+
+inline std::size_t Frame_queue::run_all() {
+  return run_while([] { return true; });
+}
+
+inline bool Frame_queue::running_in_this_thread() const {
+  return runner_.load() == std::this_thread::get_id();
+}
+
+inline std::size_t Frame_queue::size() const { return size_.load(); }
+}  // namespace aom
+#endif
@@ -0,0 +1,138 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_IMPL_QUEUES_PRIORITY_QUEUE_INCLUDED_H
+#define AOM_VARIADIC_IMPL_QUEUES_PRIORITY_QUEUE_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include <cassert>
+#include <utility>
+
+namespace aom {
+
+template <typename F>
+void Priority_queue::Level::push(F&& f) {
+  owner_->push_at(priority_, task_type(std::forward<F>(f)));
+}
+
+inline Priority_queue::Priority_queue(std::size_t levels,
+                                      std::size_t aging_threshold)
+    : levels_(levels), aging_threshold_(aging_threshold) {
+  assert(levels > 0);
+
+  // Views are individually allocated so that references to them stay valid.
+  views_.reserve(levels);
+  for (std::size_t i = 0; i < levels; ++i) {
+    views_.emplace_back(new Level(this, i));
+  }
+}
+
+inline Priority_queue::Level& Priority_queue::with_priority(std::size_t p) {
+  assert(p < levels());
+  return *views_[p];
+}
+
+template <typename F>
+void Priority_queue::push(F&& f) {
+  push_at(levels() / 2, task_type(std::forward<F>(f)));
+}
+
+inline void Priority_queue::push_at(std::size_t p, task_type task) {
+  {
+    std::lock_guard l(mtx_);
+    levels_[p].tasks.push_back(std::move(task));
+    ++size_;
+  }
+  cv_.notify_one();
+}
+
+inline Priority_queue::task_type Priority_queue::pop_next() {
+  assert(size_ > 0);
+
+  std::size_t chosen = levels_.size();
+  for (std::size_t i = 0; i < levels_.size(); ++i) {
+    auto& lvl = levels_[i];
+    if (lvl.tasks.empty()) {
+      continue;
+    }
+
+    if (chosen == levels_.size()) {
+      chosen = i;
+    } else if (lvl.skipped >= aging_threshold_) {
+      // This level has waited long enough, it goes first. The lowest such
+      // level is the one that has been starved for the longest.
+      chosen = i;
+    }
+  }
+
+  for (std::size_t i = 0; i < levels_.size(); ++i) {
+    auto& lvl = levels_[i];
+    if (i == chosen) {
+      lvl.skipped = 0;
+    } else if (!lvl.tasks.empty()) {
+      ++lvl.skipped;
+    }
+  }
+
+  auto& lvl = levels_[chosen];
+  auto result = std::move(lvl.tasks.front());
+  lvl.tasks.pop_front();
+  --size_;
+  return result;
+}
+
+inline bool Priority_queue::try_run_one() {
+  task_type task;
+  {
+    std::lock_guard l(mtx_);
+    if (size_ == 0) {
+      return false;
+    }
+    task = pop_next();
+  }
+
+  task();
+  return true;
+}
+
+inline bool Priority_queue::run_one() {
+  task_type task;
+  {
+    std::unique_lock l(mtx_);
+    cv_.wait(l, [this] { return size_ != 0 || stopped_; });
+    if (size_ == 0) {
+      return false;
+    }
+    task = pop_next();
+  }
+
+  task();
+  return true;
+}
+
+inline void Priority_queue::stop() {
+  {
+    std::lock_guard l(mtx_);
+    stopped_ = true;
+  }
+  cv_.notify_all();
+}
+
+inline std::size_t Priority_queue::size() const {
+  std::lock_guard l(mtx_);
+  return size_;
+}
+}  // namespace aom
+#endif
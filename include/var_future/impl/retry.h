@@ -0,0 +1,161 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_IMPL_RETRY_INCLUDED_H
+#define AOM_VARIADIC_IMPL_RETRY_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <optional>
+#include <random>
+#include <utility>
+
+namespace aom {
+
+inline Retry_policy::duration Retry_policy::delay(std::size_t attempt,
+                                                  double r) const {
+  double base = std::chrono::duration<double>(initial_delay).count() *
+                std::pow(multiplier, double(attempt - 1));
+  base = std::min(base, std::chrono::duration<double>(max_delay).count());
+
+  auto jittered = base * (1.0 - std::clamp(jitter, 0.0, 1.0) * r);
+  return std::chrono::duration_cast<duration>(
+      std::chrono::duration<double>(jittered));
+}
+
+namespace detail {
+
+inline double retry_random() {
+  static thread_local std::minstd_rand rng(std::random_device{}());
+  return std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+}
+
+template <typename QueueT, typename TimerT, typename Alloc, typename FactoryT,
+          typename FutT>
+class Retry_state;
+
+// Lives for as long as the operation is being attempted. It is shared by the
+// pending attempt's callback and, between attempts, by the timer task.
+template <typename QueueT, typename TimerT, typename Alloc, typename FactoryT,
+          typename FutAlloc, typename... Ts>
+class Retry_state<QueueT, TimerT, Alloc, FactoryT,
+                  Basic_future<FutAlloc, Ts...>>
+    : public std::enable_shared_from_this<Retry_state<
+          QueueT, TimerT, Alloc, FactoryT, Basic_future<FutAlloc, Ts...>>> {
+ public:
+  using storage_type = Future_storage<Alloc, Ts...>;
+  using future_type = Basic_future<Alloc, Ts...>;
+  using finish_type = finish_type_t<Ts...>;
+
+  Retry_state(QueueT& queue, TimerT& timer, Retry_policy policy,
+              FactoryT factory, Storage_ptr<storage_type> dst)
+      : queue_(queue),
+        timer_(timer),
+        policy_(std::move(policy)),
+        factory_(std::move(factory)),
+        dst_(std::move(dst)) {}
+
+  void schedule_attempt() {
+    enqueue(&queue_, [self = this->shared_from_this()] { self->attempt(); });
+  }
+
+ private:
+  void attempt() {
+    ++attempts_;
+
+    // Only the factory's failures are caught, the callback below handles its
+    // own, even when it runs inline.
+    std::optional<Basic_future<FutAlloc, Ts...>> fut;
+    try {
+      fut.emplace(factory_());
+    } catch (...) {
+      attempt_done(fail_to_expect<Ts...>(std::current_exception()));
+      return;
+    }
+
+    fut->finally([self = this->shared_from_this()](auto&&... v) {
+      self->attempt_done(finish_type(std::move(v)...));
+    });
+  }
+
+  void attempt_done(finish_type&& result) {
+    auto err = std::apply(get_first_error<Ts...>, result);
+
+    if (err && attempts_ < policy_.max_attempts) {
+      try {
+        if (!policy_.retry_if || policy_.retry_if(*err)) {
+          auto delay = policy_.delay(attempts_, retry_random());
+          timer_.schedule(delay, [self = this->shared_from_this()] {
+            // This runs on the timer's thread, which has no use for the
+            // queue's failures.
+            try {
+              self->schedule_attempt();
+            } catch (...) {
+              self->dst_->fail(std::current_exception());
+            }
+          });
+          return;
+        }
+      } catch (...) {
+        dst_->fail(std::current_exception());
+        return;
+      }
+    }
+
+    dst_->finish(std::move(result));
+  }
+
+  QueueT& queue_;
+  TimerT& timer_;
+  Retry_policy policy_;
+  FactoryT factory_;
+  Storage_ptr<storage_type> dst_;
+  std::size_t attempts_ = 0;
+};
+}  // namespace detail
+
+template <typename QueueT, typename TimerT, typename Alloc, typename FactoryT>
+auto retry(QueueT& queue, TimerT& timer, Retry_policy policy,
+           const Alloc& alloc, FactoryT&& factory) {
+  using fut_type = std::decay_t<decltype(factory())>;
+  static_assert(is_future_v<fut_type>, "the factory must return a future");
+
+  using state_type = detail::Retry_state<QueueT, TimerT, Alloc,
+                                         std::decay_t<FactoryT>, fut_type>;
+  using storage_type = typename state_type::storage_type;
+
+  detail::Storage_ptr<storage_type> dst;
+  dst.allocate(alloc);
+
+  typename state_type::future_type result(dst);
+
+  auto state = std::allocate_shared<state_type>(
+      alloc, queue, timer, std::move(policy), std::forward<FactoryT>(factory),
+      std::move(dst));
+  state->schedule_attempt();
+
+  return result;
+}
+
+template <typename QueueT, typename TimerT, typename FactoryT>
+auto retry(QueueT& queue, TimerT& timer, Retry_policy policy,
+           FactoryT&& factory) {
+  return retry(queue, timer, std::move(policy), std::allocator<void>(),
+               std::forward<FactoryT>(factory));
+}
+}  // namespace aom
+#endif
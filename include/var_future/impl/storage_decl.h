@@ -46,11 +46,11 @@ class Future_handler_iface {
   virtual ~Future_handler_iface() {}
 
   // The future has been completed
-  virtual void fullfill(fullfill_type) = 0;
+  virtual void fullfill(fullfill_type&&) = 0;
 
   // The future has been potentially completed.
   // There may be 0 or all errors.
-  virtual void finish(finish_type) = 0;
+  virtual void finish(finish_type&&) = 0;
 
   // The future has been failed.
   // virtual void fail(fail_type) = 0;
@@ -81,6 +81,8 @@ class Future_handler_base<QueueT, std::enable_if_t<has_static_push_v<QueueT>>,
 
 constexpr std::uint8_t Future_storage_state_ready_bit = 1;
 constexpr std::uint8_t Future_storage_state_finished_bit = 2;
+// finished_ has been constructed by emplace(), but is not published yet.
+constexpr std::uint8_t Future_storage_state_emplacing_bit = 4;
 
 // Holds the shared state associated with a Future<>.
 template <typename Alloc, typename... Ts>
@@ -116,14 +118,45 @@ class Future_storage : public Alloc {
 
   void fail(fail_type&& e);
 
+  // Constructs the I'th field directly within the storage. Returns true once
+  // every field has been emplaced, at which point the storage is finished.
+  template <std::size_t I, typename... Args>
+  bool emplace(Args&&... args);
+
   template <typename Handler_t, typename QueueT, typename... Args_t>
   void set_handler(QueueT* queue, Args_t&&... args);
 
+  // Wether the result is available in finished(). Only meaningful while no
+  // handler has been set.
+  bool is_finished() const {
+    return (state_.load(std::memory_order_acquire) &
+            Future_storage_state_finished_bit) != 0;
+  }
+
+  finish_type& finished() {
+    assert(is_finished());
+    return finished_;
+  }
+
+  // Returns the storage to the state it was created in, so that it can back
+  // a new future. Only valid while the caller holds the only reference to it.
+  void recycle();
+
   Alloc& allocator() { return *static_cast<Alloc*>(this); }
 
   const Alloc& allocator() const { return *static_cast<Alloc*>(this); }
 
  private:
+  // Hands finished_ over to the handler, or leaves it for set_handler().
+  void publish_finished();
+
+  // Destroys the fields emplaced so far, if any, since fullfill() and finish()
+  // replace them.
+  void discard_emplaced();
+
+  // Destroys the handler and the result, if present.
+  void destroy_contents();
+
   struct Callback_data {
     Future_handler_iface<Ts...>* callback_ = nullptr;
   };
@@ -199,6 +232,11 @@ struct Storage_ptr {
 
   operator bool() const { return ptr_ != nullptr; }
 
+  // Wether this is the only reference to the storage.
+  bool unique() const {
+    return ptr_ && ptr_->ref_count_.load(std::memory_order_acquire) == 1;
+  }
+
   ~Storage_ptr() { clear(); }
 
   T& operator*() const { return *ptr_; }
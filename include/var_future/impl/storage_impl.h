@@ -32,21 +32,15 @@ Future_storage<Alloc, Ts...>::Future_storage(const Alloc& alloc)
 
 template <typename Alloc, typename... Ts>
 void Future_storage<Alloc, Ts...>::fullfill(fullfill_type&& v) {
+  discard_emplaced();
   auto prev_state = state_.load();
 
   if (prev_state & Future_storage_state_ready_bit) {
     cb_data_.callback_->fullfill(std::move(v));
   } else {
     // This is expected to be fairly rare...
-    new (&finished_)
-        finish_type(fullfill_to_finish<0, 0, finish_type>(std::move(v)));
-    prev_state = state_.fetch_or(Future_storage_state_finished_bit);
-
-    // Handle the case where a handler was added just in time.
-    // This should be extremely rare.
-    if (prev_state & Future_storage_state_ready_bit) {
-      cb_data_.callback_->finish(std::move(finished_));
-    }
+    new (&finished_) finish_type(fullfill_to_finish<Ts...>(std::move(v)));
+    publish_finished();
   }
 }
 
@@ -69,6 +63,7 @@ void Future_storage<Alloc, Ts...>::fullfill(
 
 template <typename Alloc, typename... Ts>
 void Future_storage<Alloc, Ts...>::finish(finish_type&& f) {
+  discard_emplaced();
   auto prev_state = state_.load();
 
   if (prev_state & Future_storage_state_ready_bit) {
@@ -78,13 +73,7 @@ void Future_storage<Alloc, Ts...>::finish(finish_type&& f) {
   } else {
     // This is expected to be fairly rare...
     new (&finished_) finish_type(std::move(f));
-    prev_state = state_.fetch_or(Future_storage_state_finished_bit);
-
-    // Handle the case where a handler was added just in time.
-    // This should be extremely rare.
-    if (prev_state & Future_storage_state_ready_bit) {
-      cb_data_.callback_->finish(std::move(finished_));
-    }
+    publish_finished();
   }
 }
 
@@ -100,20 +89,74 @@ template <typename Alloc, typename... Ts>
 void Future_storage<Alloc, Ts...>::fail(fail_type&& e) {
   auto prev_state = state_.load();
 
-  if (prev_state & Future_storage_state_ready_bit) {
-    cb_data_.callback_->finish(
-        fail_to_expect<0, std::tuple<expected<Ts>...>>(e));
+  if (prev_state & Future_storage_state_emplacing_bit) {
+    // Only the fields that were not emplaced yet are failed.
+    auto fail_unset = [&e](auto& field) {
+      using field_type = std::decay_t<decltype(field)>;
+      if (!field.has_value() && !field.error()) {
+        field.~field_type();
+        new (&field) field_type(unexpected{e});
+      }
+    };
+    std::apply([&](auto&... fields) { (fail_unset(fields), ...); }, finished_);
+    publish_finished();
+  } else if (prev_state & Future_storage_state_ready_bit) {
+    cb_data_.callback_->finish(fail_to_expect<Ts...>(e));
   } else {
     // This is expected to be fairly rare...
-    new (&finished_) finish_type(fail_to_expect<0, finish_type>(e));
-    prev_state = state_.fetch_or(Future_storage_state_finished_bit);
-
-    // Handle the case where a handler was added just in time.
-    // This should be extremely rare.
-    if (prev_state & Future_storage_state_ready_bit) {
-      cb_data_.callback_->finish(
-          fail_to_expect<0, std::tuple<expected<Ts>...>>(e));
-    }
+    new (&finished_) finish_type(fail_to_expect<Ts...>(e));
+    publish_finished();
+  }
+}
+
+template <typename Alloc, typename... Ts>
+template <std::size_t I, typename... Args>
+bool Future_storage<Alloc, Ts...>::emplace(Args&&... args) {
+  using field_type = std::tuple_element_t<I, finish_type>;
+
+  if ((state_.load() & Future_storage_state_emplacing_bit) == 0) {
+    // Fields that have not been emplaced yet hold a null error.
+    new (&finished_) finish_type(fail_to_expect<Ts...>(fail_type()));
+    state_.fetch_or(Future_storage_state_emplacing_bit);
+  }
+
+  auto& field = std::get<I>(finished_);
+  assert(!field.has_value() && !field.error());
+
+  field.~field_type();
+  try {
+    new (&field) field_type(std::in_place, std::forward<Args>(args)...);
+  } catch (...) {
+    new (&field) field_type(unexpected{fail_type()});
+    throw;
+  }
+
+  bool done = std::apply(
+      [](const auto&... fields) { return (fields.has_value() && ...); },
+      finished_);
+  if (done) {
+    publish_finished();
+  }
+  return done;
+}
+
+template <typename Alloc, typename... Ts>
+void Future_storage<Alloc, Ts...>::discard_emplaced() {
+  if (state_.load() & Future_storage_state_emplacing_bit) {
+    finished_.~finish_type();
+    state_.fetch_and(
+        static_cast<std::uint8_t>(~Future_storage_state_emplacing_bit));
+  }
+}
+
+template <typename Alloc, typename... Ts>
+void Future_storage<Alloc, Ts...>::publish_finished() {
+  auto prev_state = state_.fetch_or(Future_storage_state_finished_bit);
+
+  // Handle the case where a handler was added just in time.
+  // This should be extremely rare.
+  if (prev_state & Future_storage_state_ready_bit) {
+    cb_data_.callback_->finish(std::move(finished_));
   }
 }
 
@@ -145,6 +188,20 @@ void Future_storage<Alloc, Ts...>::set_handler(QueueT* queue,
 
 template <typename Alloc, typename... Ts>
 Future_storage<Alloc, Ts...>::~Future_storage() {
+  destroy_contents();
+}
+
+template <typename Alloc, typename... Ts>
+void Future_storage<Alloc, Ts...>::recycle() {
+  assert(ref_count_.load() == 1);
+
+  destroy_contents();
+  cb_data_.callback_ = nullptr;
+  state_.store(0, std::memory_order_relaxed);
+}
+
+template <typename Alloc, typename... Ts>
+void Future_storage<Alloc, Ts...>::destroy_contents() {
   auto state = state_.load();
 
   if (state & Future_storage_state_ready_bit) {
@@ -159,7 +216,8 @@ Future_storage<Alloc, Ts...>::~Future_storage() {
     real_alloc.deallocate(cb_data_.callback_, 1);
   }
 
-  if (state & Future_storage_state_finished_bit) {
+  if (state & (Future_storage_state_finished_bit |
+               Future_storage_state_emplacing_bit)) {
     finished_.~finish_type();
   }
 }
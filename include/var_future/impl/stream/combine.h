@@ -0,0 +1,312 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef AOM_VARIADIC_IMPL_STREAM_COMBINE_INCLUDED_H
+#define AOM_VARIADIC_IMPL_STREAM_COMBINE_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include "var_future/impl/mpsc_queue.h"
+#include "var_future/impl/utils.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <utility>
+
+namespace aom {
+
+namespace detail {
+
+// Lets a single thread at a time act on behalf of many producers.
+//
+// Producers record their work where the drainer will find it, and then call
+// add(). Whoever gets true drains until finish() returns 0.
+class Drain_counter {
+ public:
+  bool add() { return work_.fetch_add(1, std::memory_order_acq_rel) == 0; }
+
+  // Releases the n units of work that were just processed, and returns how
+  // many were added in the meantime.
+  std::size_t finish(std::size_t n) {
+    return work_.fetch_sub(n, std::memory_order_acq_rel) - n;
+  }
+
+ private:
+  std::atomic<std::size_t> work_ = 0;
+};
+
+// Shared by the sources of a merge(). Every source event goes through a single
+// lock-free queue, which keeps each source's own events in order.
+template <typename Alloc, typename... Ts>
+class Merge_state {
+ public:
+  using dst_type = Basic_stream_promise<Alloc, Ts...>;
+
+  Merge_state(std::size_t sources, dst_type dst, const Alloc& alloc)
+      : events_(alloc), remaining_(sources), dst_(std::move(dst)) {}
+
+  template <typename... Us>
+  void on_value(Us&&... vals) {
+    if (closed_.load(std::memory_order_relaxed)) {
+      return;
+    }
+    post(Event{std::tuple<Ts...>(std::forward<Us>(vals)...), nullptr});
+  }
+
+  void on_end(const expected<void>& r) {
+    post(Event{std::nullopt, r.has_value() ? nullptr : r.error()});
+  }
+
+ private:
+  // A value, or the end of a source.
+  struct Event {
+    std::optional<std::tuple<Ts...>> value;
+    std::exception_ptr error;
+  };
+
+  void post(Event e) {
+    events_.push(std::move(e));
+    if (!drain_.add()) {
+      return;
+    }
+
+    std::size_t n = 1;
+    while (n != 0) {
+      for (std::size_t i = 0; i < n; ++i) {
+        process(events_.pop());
+      }
+      n = drain_.finish(n);
+    }
+  }
+
+  void process(Event e) {
+    if (!dst_) {
+      return;
+    }
+
+    if (e.value) {
+      std::apply([&](auto&... v) { dst_.push(std::move(v)...); }, *e.value);
+    } else if (e.error) {
+      closed_ = true;
+      dst_.set_exception(std::move(e.error));
+    } else if (--remaining_ == 0) {
+      closed_ = true;
+      dst_.complete();
+    }
+  }
+
+  Mpsc_queue<Event, Alloc> events_;
+  Drain_counter drain_;
+  std::atomic<bool> closed_ = false;
+
+  // Drainer only
+  std::size_t remaining_;
+  dst_type dst_;
+};
+
+// Shared by the sources of a zip(). Each source has its own lock-free queue,
+// which only that source pushes to.
+template <typename Alloc, typename DstT, typename... SrcTs>
+class Zip_state;
+
+template <typename Alloc, typename... OutTs, typename... SrcTs>
+class Zip_state<Alloc, std::tuple<OutTs...>, SrcTs...> {
+ public:
+  using dst_type = Basic_stream_promise<Alloc, OutTs...>;
+  static constexpr std::size_t source_count = sizeof...(SrcTs);
+
+  Zip_state(dst_type dst, const Alloc& alloc)
+      : queues_(alloc_for<SrcTs>(alloc)...), dst_(std::move(dst)) {}
+
+  template <std::size_t I, typename... Us>
+  void on_value(Us&&... vals) {
+    if (closed_.load(std::memory_order_relaxed)) {
+      return;
+    }
+
+    std::get<I>(queues_).push(std::forward<Us>(vals)...);
+    available_[I].fetch_add(1, std::memory_order_release);
+    notify();
+  }
+
+  template <std::size_t I>
+  void on_end(const expected<void>& r) {
+    if (!r.has_value() && !error_claimed_.exchange(true)) {
+      error_ = r.error();
+      failed_.store(true, std::memory_order_release);
+    }
+
+    ended_[I].store(true, std::memory_order_release);
+    notify();
+  }
+
+ private:
+  // One copy of alloc per source queue.
+  template <typename T>
+  static const Alloc& alloc_for(const Alloc& alloc) {
+    return alloc;
+  }
+
+  void notify() {
+    if (!drain_.add()) {
+      return;
+    }
+
+    std::size_t n = 1;
+    while (n != 0) {
+      process(std::index_sequence_for<SrcTs...>());
+      n = drain_.finish(n);
+    }
+  }
+
+  template <std::size_t... Is>
+  void process(std::index_sequence<Is...>) {
+    if (!dst_) {
+      return;
+    }
+
+    if (failed_.load(std::memory_order_acquire)) {
+      closed_ = true;
+      dst_.set_exception(error_);
+      return;
+    }
+
+    while (((available_[Is].load(std::memory_order_acquire) != 0) && ...)) {
+      auto values = std::tuple_cat(std::get<Is>(queues_).pop()...);
+      (available_[Is].fetch_sub(1, std::memory_order_relaxed), ...);
+
+      std::apply([&](auto&... v) { dst_.push(std::move(v)...); }, values);
+    }
+
+    // A source that is over, and whose values were all paired, ends the zip.
+    for (std::size_t i = 0; i < source_count; ++i) {
+      if (ended_[i].load(std::memory_order_acquire) &&
+          available_[i].load(std::memory_order_acquire) == 0) {
+        closed_ = true;
+        dst_.complete();
+        return;
+      }
+    }
+  }
+
+  std::tuple<Mpsc_queue<SrcTs, Alloc>...> queues_;
+  std::array<std::atomic<std::size_t>, source_count> available_ = {};
+  std::array<std::atomic<bool>, source_count> ended_ = {};
+
+  std::atomic<bool> error_claimed_ = false;
+  std::atomic<bool> failed_ = false;
+  std::exception_ptr error_;
+
+  Drain_counter drain_;
+  std::atomic<bool> closed_ = false;
+
+  // Drainer only
+  dst_type dst_;
+};
+
+// Builds Basic_stream_future<Alloc, Ts...> out of std::tuple<Ts...>
+template <typename Alloc, typename TupleT>
+struct Stream_future_for;
+
+template <typename Alloc, typename... Ts>
+struct Stream_future_for<Alloc, std::tuple<Ts...>> {
+  using type = Basic_stream_future<Alloc, Ts...>;
+};
+
+// The source's values only need the raw state pointer: the completion
+// callback holds a reference until after the source's last value.
+template <typename StateT, typename SrcT, typename OnValueT, typename OnEndT>
+void attach_stream_source(const std::shared_ptr<StateT>& state, SrcT& src,
+                          OnValueT on_value, OnEndT on_end) {
+  src.for_each(std::move(on_value))
+      .finally([state, on_end](const expected<void>& r) { on_end(*state, r); });
+}
+
+template <typename StateT, typename SrcsT, std::size_t... Is>
+void attach_zip_sources(const std::shared_ptr<StateT>& state, SrcsT& srcs,
+                        std::index_sequence<Is...>) {
+  StateT* raw = state.get();
+  (attach_stream_source(
+       state, std::get<Is>(srcs),
+       [raw](auto&&... v) {
+         raw->template on_value<Is>(std::forward<decltype(v)>(v)...);
+       },
+       [](StateT& s, const expected<void>& r) { s.template on_end<Is>(r); }),
+   ...);
+}
+}  // namespace detail
+
+template <typename Alloc, typename... Ts, typename... RestT>
+Basic_stream_future<Alloc, Ts...> merge(Basic_stream_future<Alloc, Ts...> first,
+                                        RestT... rest) {
+  static_assert(
+      std::conjunction_v<
+          std::is_same<Basic_stream_future<Alloc, Ts...>, RestT>...>,
+      "merge() requires streams of the same type");
+
+  using state_type = detail::Merge_state<Alloc, Ts...>;
+
+  Alloc alloc = first.allocator();
+  Basic_stream_promise<Alloc, Ts...> dst;
+  auto result = dst.get_future(alloc);
+
+  auto state = std::allocate_shared<state_type>(alloc, 1 + sizeof...(RestT),
+                                                std::move(dst), alloc);
+
+  auto attach = [&](auto& src) {
+    state_type* raw = state.get();
+    detail::attach_stream_source(
+        state, src,
+        [raw](auto&&... v) {
+          raw->on_value(std::forward<decltype(v)>(v)...);
+        },
+        [](state_type& s, const expected<void>& r) { s.on_end(r); });
+  };
+
+  attach(first);
+  (attach(rest), ...);
+
+  return result;
+}
+
+template <typename Alloc, typename... Ts, typename... RestT>
+auto zip(Basic_stream_future<Alloc, Ts...> first, RestT... rest) {
+  using out_tuple = decltype(std::tuple_cat(
+      std::declval<std::tuple<Ts...>>(),
+      std::declval<typename RestT::fullfill_type>()...));
+  using state_type =
+      detail::Zip_state<Alloc, out_tuple, std::tuple<Ts...>,
+                        typename RestT::fullfill_type...>;
+  using result_type =
+      typename detail::Stream_future_for<Alloc, out_tuple>::type;
+
+  Alloc alloc = first.allocator();
+  typename state_type::dst_type dst;
+  result_type result = dst.get_future(alloc);
+
+  auto state = std::allocate_shared<state_type>(alloc, std::move(dst), alloc);
+
+  auto srcs = std::forward_as_tuple(first, rest...);
+  detail::attach_zip_sources(state, srcs,
+                             std::make_index_sequence<1 + sizeof...(RestT)>());
+
+  return result;
+}
+}  // namespace aom
+#endif
@@ -26,7 +26,7 @@ namespace detail {
 
 // handling for Future::finally()
 template <typename Alloc, typename CbT, typename QueueT, typename... Ts>
-class Future_stream_foreach_handler
+class Future_stream_foreach_handler final
     : public Stream_handler_base<QueueT, void, Ts...> {
   using parent_type = Stream_handler_base<QueueT, void, Ts...>;
   using fail_type = typename parent_type::fail_type;
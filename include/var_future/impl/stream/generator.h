@@ -0,0 +1,206 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_IMPL_STREAM_GENERATOR_INCLUDED_H
+#define AOM_VARIADIC_IMPL_STREAM_GENERATOR_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <new>
+#include <optional>
+#include <tuple>
+
+namespace aom {
+
+namespace detail {
+
+// Suspends a generator until its consumer asks for values, if needed.
+template <typename Alloc>
+class Stream_yield_awaiter {
+ public:
+  Stream_yield_awaiter() = default;
+  explicit Stream_yield_awaiter(Basic_future<Alloc, void> demanded)
+      : demanded_(std::move(demanded)) {}
+
+  bool await_ready() const { return !demanded_ || demanded_->is_ready(); }
+
+  bool await_suspend(std::coroutine_handle<> h) {
+    handle_ = h;
+    demanded_->finally([this](expected<void>) {
+      // Whoever gets there second resumes the coroutine.
+      if (resumable_.exchange(true)) {
+        handle_.resume();
+      }
+    });
+
+    return !resumable_.exchange(true);
+  }
+
+  void await_resume() {}
+
+ private:
+  std::optional<Basic_future<Alloc, void>> demanded_;
+  std::coroutine_handle<> handle_;
+  std::atomic<bool> resumable_ = false;
+};
+
+template <typename Alloc, typename... Ts>
+class Stream_generator_promise {
+ public:
+  using generator_type = Basic_stream_generator<Alloc, Ts...>;
+
+  Stream_generator_promise() : Stream_generator_promise(Alloc()) {}
+
+  template <typename... Args>
+  Stream_generator_promise(std::allocator_arg_t, const Alloc& alloc,
+                           const Args&...)
+      : Stream_generator_promise(alloc) {}
+
+  // Member coroutines
+  template <typename This, typename... Args>
+  Stream_generator_promise(const This&, std::allocator_arg_t,
+                           const Alloc& alloc, const Args&...)
+      : Stream_generator_promise(alloc) {}
+
+  static void* operator new(std::size_t size) {
+    return allocate_frame(size, Alloc());
+  }
+
+  template <typename... Args>
+  static void* operator new(std::size_t size, std::allocator_arg_t,
+                            const Alloc& alloc, const Args&...) {
+    return allocate_frame(size, alloc);
+  }
+
+  template <typename This, typename... Args>
+  static void* operator new(std::size_t size, const This&,
+                            std::allocator_arg_t, const Alloc& alloc,
+                            const Args&...) {
+    return allocate_frame(size, alloc);
+  }
+
+  static void operator delete(void* ptr, std::size_t size);
+
+  generator_type get_return_object() {
+    return generator_type(std::move(future_));
+  }
+
+  std::suspend_never initial_suspend() noexcept { return {}; }
+  std::suspend_never final_suspend() noexcept { return {}; }
+
+  template <typename U>
+  Stream_yield_awaiter<Alloc> yield_value(U&& value);
+
+  void return_void() { stream_.complete(); }
+
+  void unhandled_exception() {
+    stream_.set_exception(std::current_exception());
+  }
+
+ private:
+  using unit_type = std::max_align_t;
+  using unit_alloc =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<unit_type>;
+
+  static_assert(alignof(Alloc) <= alignof(unit_type),
+                "over-aligned allocators are not supported");
+
+  explicit Stream_generator_promise(const Alloc& alloc)
+      : future_(stream_.get_future(alloc)) {}
+
+  // The allocator is stored right after the frame, so that it can be
+  // retrieved by operator delete.
+  static std::size_t alloc_offset(std::size_t size) {
+    return (size + alignof(Alloc) - 1) / alignof(Alloc) * alignof(Alloc);
+  }
+
+  static std::size_t unit_count(std::size_t size) {
+    return (alloc_offset(size) + sizeof(Alloc) + sizeof(unit_type) - 1) /
+           sizeof(unit_type);
+  }
+
+  static void* allocate_frame(std::size_t size, const Alloc& alloc);
+
+  Basic_stream_promise<Alloc, Ts...> stream_;
+  Basic_stream_future<Alloc, Ts...> future_;
+
+  // How many values were pushed while nobody was waiting for them.
+  std::size_t ahead_ = 0;
+};
+
+template <typename Alloc, typename... Ts>
+void* Stream_generator_promise<Alloc, Ts...>::allocate_frame(
+    std::size_t size, const Alloc& alloc) {
+  unit_alloc real_alloc(alloc);
+  unit_type* ptr = real_alloc.allocate(unit_count(size));
+  new (reinterpret_cast<char*>(ptr) + alloc_offset(size)) Alloc(alloc);
+  return ptr;
+}
+
+template <typename Alloc, typename... Ts>
+void Stream_generator_promise<Alloc, Ts...>::operator delete(void* ptr,
+                                                           std::size_t size) {
+  auto stored = std::launder(reinterpret_cast<Alloc*>(
+      reinterpret_cast<char*>(ptr) + alloc_offset(size)));
+  unit_alloc real_alloc(*stored);
+  stored->~Alloc();
+
+  real_alloc.deallocate(static_cast<unit_type*>(ptr), unit_count(size));
+}
+
+template <typename Alloc, typename... Ts>
+template <typename U>
+Stream_yield_awaiter<Alloc> Stream_generator_promise<Alloc, Ts...>::yield_value(
+    U&& value) {
+  bool wanted = stream_.demand() != 0;
+
+  if constexpr (sizeof...(Ts) == 1) {
+    stream_.push(std::forward<U>(value));
+  } else {
+    std::apply(
+        [&](auto&&... v) { stream_.push(std::forward<decltype(v)>(v)...); },
+        std::forward<U>(value));
+  }
+
+  // Once demand is seen, whatever was pushed ahead of it has been consumed.
+  if (wanted) {
+    ahead_ = 0;
+    return Stream_yield_awaiter<Alloc>();
+  }
+
+  if (++ahead_ < AOM_VARFUT_STREAM_GENERATOR_CAPACITY) {
+    return Stream_yield_awaiter<Alloc>();
+  }
+
+  ahead_ = 0;
+  return Stream_yield_awaiter<Alloc>(stream_.when_demanded());
+}
+}  // namespace detail
+
+template <typename Alloc, typename... Ts>
+Basic_stream_generator<Alloc, Ts...>::Basic_stream_generator(future_type f)
+    : future_(std::move(f)) {}
+
+template <typename Alloc, typename... Ts>
+typename Basic_stream_generator<Alloc, Ts...>::future_type
+Basic_stream_generator<Alloc, Ts...>::get_future() {
+  return std::move(future_);
+}
+}  // namespace aom
+#endif
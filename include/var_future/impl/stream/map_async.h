@@ -0,0 +1,332 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef AOM_VARIADIC_IMPL_STREAM_MAP_ASYNC_INCLUDED_H
+#define AOM_VARIADIC_IMPL_STREAM_MAP_ASYNC_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include "var_future/impl/stream/stages.h"
+#include "var_future/impl/stream/stream_storage_decl.h"
+#include "var_future/impl/utils.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace aom {
+
+namespace detail {
+
+// Shared by a map_async() handler and the tasks it launches.
+//
+// Whichever thread changes the state while nobody else is draining it becomes
+// the drainer: it emits the results that are ready, launches the inputs that
+// fit within the limit, and finishes the destination, all outside of the lock.
+// Everyone else just records their change and leaves.
+template <typename Alloc, typename CbT, typename QueueT, typename InT,
+          typename R>
+class Map_async_state
+    : public std::enable_shared_from_this<
+          Map_async_state<Alloc, CbT, QueueT, InT, R>> {
+ public:
+  using dst_type = Basic_stream_promise<Alloc, R>;
+
+  Map_async_state(QueueT* queue, CbT cb, std::size_t max_in_flight,
+                  Stream_order order, dst_type dst)
+      : queue_(queue),
+        cb_(std::move(cb)),
+        max_in_flight_(max_in_flight),
+        order_(order),
+        dst_(std::move(dst)) {
+    assert(max_in_flight_ > 0);
+    if (order_ == Stream_order::ordered) {
+      reorder_.resize(max_in_flight_);
+    }
+  }
+
+  void on_input(InT v) {
+    std::unique_lock l(mtx_);
+    if (error_) {
+      // The destination has failed, nothing will be launched anymore.
+      return;
+    }
+    pending_.push_back(std::move(v));
+    drain(l);
+  }
+
+  void on_source_end(std::exception_ptr e) {
+    std::unique_lock l(mtx_);
+    source_done_ = true;
+    source_error_ = std::move(e);
+    drain(l);
+  }
+
+ private:
+  void launch(std::uint64_t seq, InT v) {
+    enqueue(queue_, [self = this->shared_from_this(), seq,
+                     v = std::move(v)]() mutable {
+      std::optional<R> r;
+      try {
+        r.emplace(std::apply(self->cb_, std::move(v)));
+      } catch (...) {
+        self->on_error(std::current_exception());
+        return;
+      }
+      self->on_result(seq, std::move(*r));
+    });
+  }
+
+  void on_result(std::uint64_t seq, R r) {
+    std::unique_lock l(mtx_);
+    if (order_ == Stream_order::ordered) {
+      // The slot is only released once the result is emitted, so there are
+      // never more than max_in_flight_ results waiting to be reordered.
+      reorder_[seq % max_in_flight_].emplace(std::move(r));
+    } else {
+      ready_.push_back(std::move(r));
+      --in_flight_;
+    }
+    drain(l);
+  }
+
+  void on_error(std::exception_ptr e) {
+    std::unique_lock l(mtx_);
+    if (!error_) {
+      error_ = std::move(e);
+      pending_.clear();
+    }
+    --in_flight_;
+    drain(l);
+  }
+
+  void drain(std::unique_lock<std::mutex>& l) {
+    if (draining_) {
+      return;
+    }
+    draining_ = true;
+
+    std::vector<R> out;
+    std::vector<std::pair<std::uint64_t, InT>> to_launch;
+    while (!error_) {
+      if (order_ == Stream_order::ordered) {
+        auto* slot = &reorder_[next_emit_ % max_in_flight_];
+        while (*slot) {
+          out.push_back(std::move(**slot));
+          slot->reset();
+          --in_flight_;
+          slot = &reorder_[++next_emit_ % max_in_flight_];
+        }
+      } else {
+        for (auto& r : ready_) {
+          out.push_back(std::move(r));
+        }
+        ready_.clear();
+      }
+
+      while (in_flight_ < max_in_flight_ && !pending_.empty()) {
+        to_launch.emplace_back(next_seq_++, std::move(pending_.front()));
+        pending_.pop_front();
+        ++in_flight_;
+      }
+
+      if (out.empty() && to_launch.empty()) {
+        break;
+      }
+
+      l.unlock();
+      std::size_t launched = 0;
+      std::exception_ptr failure;
+      try {
+        if (dst_) {
+          for (auto& r : out) {
+            dst_.push(std::move(r));
+          }
+        }
+        for (; launched < to_launch.size(); ++launched) {
+          auto& v = to_launch[launched];
+          // Immediate queues run the task, and record its result, right away.
+          launch(v.first, std::move(v.second));
+        }
+      } catch (...) {
+        failure = std::current_exception();
+      }
+      std::size_t not_launched = to_launch.size() - launched;
+      out.clear();
+      to_launch.clear();
+      l.lock();
+
+      if (failure) {
+        // The inputs that were not launched will never produce a result. The
+        // destination fails as soon as the loop exits.
+        in_flight_ -= not_launched;
+        if (!error_) {
+          error_ = std::move(failure);
+          pending_.clear();
+        }
+      }
+    }
+
+    draining_ = false;
+
+    bool finished =
+        error_ || (source_done_ && pending_.empty() && in_flight_ == 0);
+    if (!finished || !dst_) {
+      return;
+    }
+
+    auto dst = std::move(dst_);
+    auto error = error_ ? error_ : source_error_;
+    l.unlock();
+
+    if (error) {
+      dst.set_exception(std::move(error));
+    } else {
+      dst.complete();
+    }
+  }
+
+  QueueT* queue_;
+  CbT cb_;
+  std::size_t max_in_flight_;
+  Stream_order order_;
+
+  std::mutex mtx_;
+  dst_type dst_;
+  std::deque<InT> pending_;
+  std::size_t in_flight_ = 0;
+  std::uint64_t next_seq_ = 0;
+  std::uint64_t next_emit_ = 0;
+  std::vector<std::optional<R>> reorder_;
+  std::vector<R> ready_;
+  bool draining_ = false;
+
+  bool source_done_ = false;
+  std::exception_ptr source_error_;
+  std::exception_ptr error_;
+};
+
+// Feeds the values of a stream, once they went through the pipeline's stages,
+// to a shared state, such as a Map_async_state, through its on_input() and
+// on_source_end() members.
+template <typename Alloc, typename StateT, typename QueueT, typename StagesT,
+          typename... Ts>
+class Stream_map_async_handler final
+    : public Stream_handler_base<QueueT, void, Ts...> {
+  using parent_type = Stream_handler_base<QueueT, void, Ts...>;
+  using fail_type = typename parent_type::fail_type;
+  using input_type = Stream_stages_output_t<StagesT, std::tuple<Ts...>>;
+
+ public:
+  Stream_map_async_handler(Storage_ptr<Future_storage<Alloc, void>>,
+                           QueueT* q, std::shared_ptr<StateT> state,
+                           StagesT stages)
+      : parent_type(q),
+        state_(std::move(state)),
+        stages_(std::move(stages)) {
+    if (stream_stages_exhausted(stages_)) {
+      complete();
+    }
+  }
+
+  void push(Ts... args) override {
+    if (done_) {
+      return;
+    }
+
+    auto feed = [this](auto&&... vals) {
+      state_->on_input(input_type(std::forward<decltype(vals)>(vals)...));
+      return true;
+    };
+
+    if (!run_stream_stages(stages_, feed, std::move(args)...)) {
+      complete();
+    }
+  }
+
+  void complete() override {
+    if (done_) {
+      return;
+    }
+    done_ = true;
+
+    state_->on_source_end(nullptr);
+  }
+
+  void fail(fail_type f) override {
+    if (done_) {
+      return;
+    }
+    done_ = true;
+
+    state_->on_source_end(std::move(f));
+  }
+
+ private:
+  std::shared_ptr<StateT> state_;
+  StagesT stages_;
+  bool done_ = false;
+};
+}  // namespace detail
+
+template <typename Alloc, typename StagesT, typename... Ts>
+template <typename QueueT, typename CbT>
+auto Basic_stream_pipeline<Alloc, StagesT, Ts...>::map_async(
+    QueueT& queue, std::size_t max_in_flight, CbT&& cb, Stream_order order) {
+  assert(storage_);
+
+  using cb_type = std::decay_t<CbT>;
+  using result_type =
+      std::decay_t<decltype(std::apply(std::declval<cb_type&>(),
+                                       std::declval<output_type>()))>;
+  static_assert(!std::is_same_v<void, result_type>,
+                "map_async() callbacks must return a value");
+
+  using state_type = detail::Map_async_state<Alloc, cb_type, QueueT,
+                                             output_type, result_type>;
+  using handler_t =
+      detail::Stream_map_async_handler<Alloc, state_type, QueueT, StagesT,
+                                       Ts...>;
+
+  const Alloc& alloc = storage_->allocator();
+
+  Basic_stream_promise<Alloc, result_type> dst;
+  auto result = dst.get_future(alloc);
+
+  auto state = std::allocate_shared<state_type>(
+      alloc, &queue, std::forward<CbT>(cb), max_in_flight, order,
+      std::move(dst));
+
+  storage_->template set_handler<handler_t>(&queue, std::move(state),
+                                            std::move(stages_));
+  storage_.reset();
+
+  return result;
+}
+
+template <typename Alloc, typename... Ts>
+template <typename QueueT, typename CbT>
+auto Basic_stream_future<Alloc, Ts...>::map_async(QueueT& queue,
+                                                  std::size_t max_in_flight,
+                                                  CbT&& cb,
+                                                  Stream_order order) {
+  return as_pipeline().map_async(queue, max_in_flight, std::forward<CbT>(cb),
+                                 order);
+}
+}  // namespace aom
+#endif
@@ -0,0 +1,427 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_IMPL_STREAM_MULTICAST_INCLUDED_H
+#define AOM_VARIADIC_IMPL_STREAM_MULTICAST_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include "var_future/impl/stream/combine.h"
+#include "var_future/impl/utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace aom {
+
+namespace detail {
+
+// Shared by a Basic_multicast_stream, its source, and the delivery tasks of
+// its subscribers.
+//
+// Values are kept in a singly linked list of reference counted nodes. Each
+// node holds a reference to its successor, so holding a node keeps every
+// value that comes after it alive. The state holds the tail, and the node
+// that precedes the replay history. Every subscriber holds the last node it
+// has delivered, from which it finds the next ones without taking the lock.
+template <typename Alloc, typename... Ts>
+class Multicast_state
+    : public std::enable_shared_from_this<Multicast_state<Alloc, Ts...>> {
+ public:
+  using allocator_type = Alloc;
+  using value_type = std::tuple<Ts...>;
+
+  struct Node {
+    // Empty for the node created along with the state.
+    std::optional<std::tuple<Ts...>> values;
+    std::atomic<std::size_t> refs = 1;
+    std::atomic<Node*> next = nullptr;
+  };
+
+  class Subscriber : public std::enable_shared_from_this<Subscriber> {
+   public:
+    virtual ~Subscriber() = default;
+
+    // Ensures that the values that are available are eventually delivered.
+    virtual void signal(Multicast_state& state) = 0;
+
+    // The last delivered node, owned by the delivery task.
+    Node* cursor = nullptr;
+  };
+
+  Multicast_state(const Alloc& alloc, std::size_t history);
+  ~Multicast_state();
+
+  template <typename... Us>
+  void on_value(Us&&... vals);
+  void on_end(const expected<void>& r);
+
+  template <typename QueueT, typename CbT>
+  Basic_future<Alloc, void> subscribe(QueueT* queue, CbT&& cb);
+
+  // Stops signaling sub, which must have released its cursor.
+  void unsubscribe(Subscriber* sub);
+
+  // Valid once ended() has returned true.
+  bool ended() const { return ended_.load(std::memory_order_acquire); }
+  const std::exception_ptr& error() const { return error_; }
+
+  static void add_ref(Node* n) {
+    n->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+  void release(Node* n);
+
+ private:
+  using Node_alloc =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<Node>;
+
+  Node* create(std::optional<std::tuple<Ts...>> values);
+
+  // Signals the subscribers of signal_list_.
+  void signal_all();
+
+  // Releases the subscribers that left while signal_all() was running.
+  void end_signaling();
+
+  Alloc alloc_;
+  std::size_t history_;
+
+  std::mutex mtx_;
+  Node* tail_ = nullptr;
+  Node* before_history_ = nullptr;
+  std::size_t history_size_ = 0;
+  std::vector<std::shared_ptr<Subscriber>> subscribers_;
+
+  // Unsubscribed while the source was going through signal_list_, which may
+  // still refer to them. Destroyed by the source once it is done with it.
+  std::vector<std::shared_ptr<Subscriber>> retired_;
+  bool signaling_ = false;
+
+  std::atomic<bool> ended_ = false;
+  std::exception_ptr error_;
+
+  // Only used by the source, whose values are pushed one at a time.
+  std::vector<Subscriber*> signal_list_;
+};
+
+template <typename StateT, typename QueueT, typename CbT>
+class Multicast_subscriber final : public StateT::Subscriber {
+ public:
+  using dst_type =
+      Storage_ptr<Future_storage<typename StateT::allocator_type, void>>;
+
+  Multicast_subscriber(QueueT* queue, CbT cb, dst_type dst)
+      : queue_(queue), cb_(std::move(cb)), dst_(std::move(dst)) {}
+
+  void signal(StateT& state) override {
+    if (!drain_.add()) {
+      return;
+    }
+
+    auto self =
+        std::static_pointer_cast<Multicast_subscriber>(this->shared_from_this());
+    enqueue(queue_, [self = std::move(self), state = state.shared_from_this()] {
+      std::size_t n = 1;
+      while (n != 0) {
+        self->deliver(*state);
+        n = self->drain_.finish(n);
+      }
+    });
+  }
+
+ private:
+  void deliver(StateT& state) {
+    if (!dst_) {
+      return;
+    }
+
+    bool ended = false;
+    while (true) {
+      auto next = this->cursor->next.load(std::memory_order_acquire);
+      if (!next) {
+        // Values are all linked before the end is flagged, so one more look
+        // is needed once it has been seen.
+        if (ended) {
+          finish(state, state.error());
+          return;
+        }
+        ended = state.ended();
+        if (!ended) {
+          return;
+        }
+        continue;
+      }
+
+      bool keep_going = true;
+      try {
+        if constexpr (std::is_same_v<bool, cb_result_type>) {
+          keep_going = std::apply(cb_, std::as_const(*next->values));
+        } else {
+          std::apply(cb_, std::as_const(*next->values));
+        }
+      } catch (...) {
+        finish(state, std::current_exception());
+        return;
+      }
+
+      StateT::add_ref(next);
+      state.release(this->cursor);
+      this->cursor = next;
+
+      if (!keep_going) {
+        finish(state, nullptr);
+        return;
+      }
+    }
+  }
+
+  void finish(StateT& state, std::exception_ptr e) {
+    state.release(this->cursor);
+    this->cursor = nullptr;
+    state.unsubscribe(this);
+
+    auto dst = std::move(dst_);
+    if (e) {
+      dst->fail(std::move(e));
+    } else {
+      dst->fullfill(fullfill_type_t<void>());
+    }
+  }
+
+  using cb_result_type = decltype(std::apply(
+      std::declval<CbT&>(),
+      std::declval<const typename StateT::value_type&>()));
+
+  QueueT* queue_;
+  CbT cb_;
+  dst_type dst_;
+  Drain_counter drain_;
+};
+
+template <typename Alloc, typename... Ts>
+Multicast_state<Alloc, Ts...>::Multicast_state(const Alloc& alloc,
+                                               std::size_t history)
+    : alloc_(alloc), history_(history) {
+  tail_ = create(std::nullopt);
+  before_history_ = tail_;
+  add_ref(before_history_);
+}
+
+template <typename Alloc, typename... Ts>
+Multicast_state<Alloc, Ts...>::~Multicast_state() {
+  for (auto& sub : subscribers_) {
+    if (sub->cursor) {
+      release(sub->cursor);
+    }
+  }
+  release(before_history_);
+  release(tail_);
+}
+
+template <typename Alloc, typename... Ts>
+typename Multicast_state<Alloc, Ts...>::Node*
+Multicast_state<Alloc, Ts...>::create(
+    std::optional<std::tuple<Ts...>> values) {
+  Node_alloc real_alloc(alloc_);
+  Node* ptr = real_alloc.allocate(1);
+  try {
+    return new (ptr) Node{std::move(values)};
+  } catch (...) {
+    real_alloc.deallocate(ptr, 1);
+    throw;
+  }
+}
+
+template <typename Alloc, typename... Ts>
+void Multicast_state<Alloc, Ts...>::release(Node* n) {
+  Node_alloc real_alloc(alloc_);
+
+  // Iterative, so that releasing a long list can't overflow the stack.
+  while (n && n->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    Node* next = n->next.load(std::memory_order_relaxed);
+    n->~Node();
+    real_alloc.deallocate(n, 1);
+    n = next;
+  }
+}
+
+template <typename Alloc, typename... Ts>
+template <typename... Us>
+void Multicast_state<Alloc, Ts...>::on_value(Us&&... vals) {
+  // The initial reference belongs to the predecessor.
+  Node* n = create(std::tuple<Ts...>(std::forward<Us>(vals)...));
+
+  {
+    std::lock_guard l(mtx_);
+    add_ref(n);
+    tail_->next.store(n, std::memory_order_release);
+    release(tail_);
+    tail_ = n;
+
+    if (history_size_ < history_) {
+      ++history_size_;
+    } else {
+      Node* first = before_history_->next.load(std::memory_order_relaxed);
+      add_ref(first);
+      release(before_history_);
+      before_history_ = first;
+    }
+
+    signal_list_.assign(subscribers_.size(), nullptr);
+    for (std::size_t i = 0; i < subscribers_.size(); ++i) {
+      signal_list_[i] = subscribers_[i].get();
+    }
+    signaling_ = true;
+  }
+
+  signal_all();
+}
+
+template <typename Alloc, typename... Ts>
+void Multicast_state<Alloc, Ts...>::on_end(const expected<void>& r) {
+  {
+    std::lock_guard l(mtx_);
+    if (!r.has_value()) {
+      error_ = r.error();
+    }
+    ended_.store(true, std::memory_order_release);
+
+    signal_list_.assign(subscribers_.size(), nullptr);
+    for (std::size_t i = 0; i < subscribers_.size(); ++i) {
+      signal_list_[i] = subscribers_[i].get();
+    }
+    signaling_ = true;
+  }
+
+  signal_all();
+}
+
+template <typename Alloc, typename... Ts>
+void Multicast_state<Alloc, Ts...>::signal_all() {
+  // Subscribers that leave in the meantime are kept alive by retired_.
+  try {
+    for (auto sub : signal_list_) {
+      sub->signal(*this);
+    }
+  } catch (...) {
+    end_signaling();
+    throw;
+  }
+  end_signaling();
+}
+
+template <typename Alloc, typename... Ts>
+void Multicast_state<Alloc, Ts...>::end_signaling() {
+  std::vector<std::shared_ptr<Subscriber>> retired;
+  {
+    std::lock_guard l(mtx_);
+    signaling_ = false;
+    retired.swap(retired_);
+  }
+}
+
+template <typename Alloc, typename... Ts>
+void Multicast_state<Alloc, Ts...>::unsubscribe(Subscriber* sub) {
+  assert(!sub->cursor);
+
+  // Destroyed once the lock is released, unless the source may still be
+  // signaling it.
+  std::shared_ptr<Subscriber> removed;
+
+  std::lock_guard l(mtx_);
+  auto found = std::find_if(subscribers_.begin(), subscribers_.end(),
+                            [&](const auto& s) { return s.get() == sub; });
+  assert(found != subscribers_.end());
+
+  removed = std::move(*found);
+  *found = std::move(subscribers_.back());
+  subscribers_.pop_back();
+
+  if (signaling_) {
+    retired_.push_back(std::move(removed));
+  }
+}
+
+template <typename Alloc, typename... Ts>
+template <typename QueueT, typename CbT>
+Basic_future<Alloc, void> Multicast_state<Alloc, Ts...>::subscribe(
+    QueueT* queue, CbT&& cb) {
+  using sub_type =
+      Multicast_subscriber<Multicast_state, QueueT, std::decay_t<CbT>>;
+
+  Storage_ptr<Future_storage<Alloc, void>> dst;
+  dst.allocate(alloc_);
+  Basic_future<Alloc, void> result(dst);
+
+  auto sub = std::allocate_shared<sub_type>(alloc_, queue,
+                                            std::forward<CbT>(cb),
+                                            std::move(dst));
+  bool pending = false;
+  {
+    std::lock_guard l(mtx_);
+    sub->cursor = before_history_;
+    add_ref(sub->cursor);
+    subscribers_.push_back(sub);
+
+    // Values pushed from now on will signal the subscriber anyways.
+    pending = before_history_->next.load(std::memory_order_relaxed) ||
+              ended_.load(std::memory_order_relaxed);
+  }
+
+  if (pending) {
+    sub->signal(*this);
+  }
+  return result;
+}
+}  // namespace detail
+
+template <typename Alloc, typename... Ts>
+Basic_multicast_stream<Alloc, Ts...>::Basic_multicast_stream(
+    Basic_stream_future<Alloc, Ts...> source, std::size_t history) {
+  Alloc alloc = source.allocator();
+  state_ = std::allocate_shared<state_type>(alloc, alloc, history);
+
+  state_type* raw = state_.get();
+  detail::attach_stream_source(
+      state_, source,
+      [raw](auto&&... v) { raw->on_value(std::forward<decltype(v)>(v)...); },
+      [](state_type& s, const expected<void>& r) { s.on_end(r); });
+}
+
+template <typename Alloc, typename... Ts>
+template <typename CbT>
+Basic_future<Alloc, void> Basic_multicast_stream<Alloc, Ts...>::subscribe(
+    CbT&& cb) {
+  detail::Immediate_queue queue;
+  return subscribe(queue, std::forward<CbT>(cb));
+}
+
+template <typename Alloc, typename... Ts>
+template <typename QueueT, typename CbT>
+Basic_future<Alloc, void> Basic_multicast_stream<Alloc, Ts...>::subscribe(
+    QueueT& queue, CbT&& cb) {
+  return state_->subscribe(&queue, std::forward<CbT>(cb));
+}
+}  // namespace aom
+#endif
@@ -0,0 +1,129 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef AOM_VARIADIC_IMPL_STREAM_PIPELINE_INCLUDED_H
+#define AOM_VARIADIC_IMPL_STREAM_PIPELINE_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include "var_future/impl/stream/pipeline_handler.h"
+
+namespace aom {
+
+template <typename Alloc, typename... Ts>
+Basic_stream_pipeline<Alloc, std::tuple<>, Ts...>
+Basic_stream_future<Alloc, Ts...>::as_pipeline() {
+  assert(storage_);
+  return Basic_stream_pipeline<Alloc, std::tuple<>, Ts...>(std::move(storage_),
+                                                           std::tuple<>());
+}
+
+template <typename Alloc, typename... Ts>
+template <typename CbT>
+auto Basic_stream_future<Alloc, Ts...>::map(CbT&& cb) {
+  return as_pipeline().map(std::forward<CbT>(cb));
+}
+
+template <typename Alloc, typename... Ts>
+template <typename PredT>
+auto Basic_stream_future<Alloc, Ts...>::filter(PredT&& pred) {
+  return as_pipeline().filter(std::forward<PredT>(pred));
+}
+
+template <typename Alloc, typename... Ts>
+auto Basic_stream_future<Alloc, Ts...>::take(std::size_t n) {
+  return as_pipeline().take(n);
+}
+
+template <typename Alloc, typename... Ts>
+template <typename AccT, typename OpT>
+auto Basic_stream_future<Alloc, Ts...>::scan(AccT init, OpT&& op) {
+  return as_pipeline().scan(std::move(init), std::forward<OpT>(op));
+}
+
+template <typename Alloc, typename StagesT, typename... Ts>
+Basic_stream_pipeline<Alloc, StagesT, Ts...>::Basic_stream_pipeline(
+    detail::Storage_ptr<storage_type> s, StagesT stages)
+    : storage_(std::move(s)), stages_(std::move(stages)) {}
+
+template <typename Alloc, typename StagesT, typename... Ts>
+template <typename StageT>
+auto Basic_stream_pipeline<Alloc, StagesT, Ts...>::then_stage(StageT stage) {
+  assert(storage_);
+
+  auto stages =
+      std::tuple_cat(std::move(stages_), std::make_tuple(std::move(stage)));
+  return Basic_stream_pipeline<Alloc, decltype(stages), Ts...>(
+      std::move(storage_), std::move(stages));
+}
+
+template <typename Alloc, typename StagesT, typename... Ts>
+template <typename CbT>
+auto Basic_stream_pipeline<Alloc, StagesT, Ts...>::map(CbT&& cb) {
+  using stage_type = detail::Stream_map_stage<std::decay_t<CbT>>;
+  return then_stage(stage_type{std::forward<CbT>(cb)});
+}
+
+template <typename Alloc, typename StagesT, typename... Ts>
+template <typename PredT>
+auto Basic_stream_pipeline<Alloc, StagesT, Ts...>::filter(PredT&& pred) {
+  using stage_type = detail::Stream_filter_stage<std::decay_t<PredT>>;
+  return then_stage(stage_type{std::forward<PredT>(pred)});
+}
+
+template <typename Alloc, typename StagesT, typename... Ts>
+auto Basic_stream_pipeline<Alloc, StagesT, Ts...>::take(std::size_t n) {
+  return then_stage(detail::Stream_take_stage{n});
+}
+
+template <typename Alloc, typename StagesT, typename... Ts>
+template <typename AccT, typename OpT>
+auto Basic_stream_pipeline<Alloc, StagesT, Ts...>::scan(AccT init, OpT&& op) {
+  using stage_type = detail::Stream_scan_stage<AccT, std::decay_t<OpT>>;
+  return then_stage(stage_type{std::move(init), std::forward<OpT>(op)});
+}
+
+template <typename Alloc, typename StagesT, typename... Ts>
+template <typename CbT>
+Basic_future<Alloc, void>
+Basic_stream_pipeline<Alloc, StagesT, Ts...>::for_each(CbT&& cb) {
+  detail::Immediate_queue queue;
+  return this->for_each(queue, std::forward<CbT>(cb));
+}
+
+template <typename Alloc, typename StagesT, typename... Ts>
+template <typename QueueT, typename CbT>
+Basic_future<Alloc, void>
+Basic_stream_pipeline<Alloc, StagesT, Ts...>::for_each(QueueT& queue,
+                                                       CbT&& cb) {
+  assert(storage_);
+  static_assert(detail::is_applicable_v<CbT, output_type>,
+                "for_each should be accepting the correct arguments");
+
+  using handler_t =
+      detail::Stream_pipeline_handler<Alloc, std::decay_t<CbT>, QueueT,
+                                      StagesT, Ts...>;
+
+  // This must be done BEFORE set_handler
+  auto result_fut = storage_->get_final_future();
+
+  storage_->template set_handler<handler_t>(&queue, std::forward<CbT>(cb),
+                                            std::move(stages_));
+  storage_.reset();
+
+  return result_fut;
+}
+}  // namespace aom
+#endif
@@ -0,0 +1,103 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef AOM_VARIADIC_IMPL_STREAM_PIPELINE_HANDLER_INCLUDED_H
+#define AOM_VARIADIC_IMPL_STREAM_PIPELINE_HANDLER_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include "var_future/impl/stream/stages.h"
+#include "var_future/impl/stream/stream_storage_decl.h"
+#include "var_future/impl/utils.h"
+
+namespace aom {
+
+namespace detail {
+
+// Runs every stage of a pipeline, and then the for_each() callback, from a
+// single handler. The stages run where the values are pushed, in order, and
+// only their final output is posted to the queue.
+template <typename Alloc, typename CbT, typename QueueT, typename StagesT,
+          typename... Ts>
+class Stream_pipeline_handler final
+    : public Stream_handler_base<QueueT, void, Ts...> {
+  using parent_type = Stream_handler_base<QueueT, void, Ts...>;
+  using fail_type = typename parent_type::fail_type;
+  using output_type = Stream_stages_output_t<StagesT, std::tuple<Ts...>>;
+
+ public:
+  Stream_pipeline_handler(Storage_ptr<Future_storage<Alloc, void>> fin,
+                          QueueT* q, CbT cb, StagesT stages)
+      : parent_type(q),
+        cb_(std::move(cb)),
+        stages_(std::move(stages)),
+        finalizer_(std::move(fin)) {
+    if (stream_stages_exhausted(stages_)) {
+      complete();
+    }
+  }
+
+  void push(Ts... args) override {
+    if (done_) {
+      return;
+    }
+
+    auto post = [this](auto&&... vals) {
+      output_type out(std::forward<decltype(vals)>(vals)...);
+      enqueue(this->get_queue(), [cb = cb_, out = std::move(out)]() mutable {
+        std::apply(cb, std::move(out));
+      });
+      return true;
+    };
+
+    if (!run_stream_stages(stages_, post, std::move(args)...)) {
+      complete();
+    }
+  }
+
+  void complete() override {
+    if (done_) {
+      return;
+    }
+    done_ = true;
+
+    enqueue(this->get_queue(), [fin = std::move(finalizer_)]() {
+      fin->fullfill(fullfill_type_t<void>());
+    });
+  }
+
+  void fail(fail_type f) override {
+    if (done_) {
+      return;
+    }
+    done_ = true;
+
+    enqueue(this->get_queue(),
+            [f = std::move(f), fin = std::move(finalizer_)]() mutable {
+              fin->fail(std::move(f));
+            });
+  }
+
+ private:
+  CbT cb_;
+  StagesT stages_;
+  Storage_ptr<Future_storage<Alloc, void>> finalizer_;
+
+  // Values are pushed one at a time, so this needs no synchronization.
+  bool done_ = false;
+};
+}  // namespace detail
+}  // namespace aom
+#endif
@@ -0,0 +1,234 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_IMPL_STREAM_PULL_INCLUDED_H
+#define AOM_VARIADIC_IMPL_STREAM_PULL_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include "var_future/impl/stream/stream_storage_decl.h"
+#include "var_future/impl/utils.h"
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+
+namespace aom {
+
+namespace detail {
+
+// Hands the values of a stream out to a Basic_stream_iterator. It is owned by
+// the stream's storage, which the iterator keeps alive.
+template <typename Alloc, typename... Ts>
+class Stream_pull_handler final : public Stream_handler_iface<Ts...> {
+  using parent_type = Stream_handler_iface<Ts...>;
+  using fail_type = typename parent_type::fail_type;
+
+ public:
+  using value_type = std::optional<std::tuple<Ts...>>;
+  using dst_storage_type = Future_storage<Alloc, value_type>;
+  using src_storage_type = Stream_storage<Alloc, Ts...>;
+
+  Stream_pull_handler(Storage_ptr<Future_storage<Alloc, void>>,
+                      Immediate_queue*, src_storage_type* src)
+      : src_(src),
+        buffer_(Buffer_alloc(src->allocator())) {}
+
+  void push(Ts... args) override {
+    std::unique_lock l(mtx_);
+    if (demand_ != 0 && demand_ != unbounded_stream_demand) {
+      --demand_;
+    }
+
+    if (pending_) {
+      auto dst = std::move(pending_);
+      l.unlock();
+      dst->fullfill(std::make_tuple(
+          value_type(std::in_place, std::move(args)...)));
+    } else if (!abandoned_) {
+      buffer_.emplace_back(std::move(args)...);
+    }
+  }
+
+  void complete() override { end(nullptr); }
+
+  void fail(fail_type e) override { end(std::move(e)); }
+
+  std::size_t demand() const override { return demand_; }
+
+  // Fullfills dst with the next value, or once it is available.
+  void next(Storage_ptr<dst_storage_type> dst) {
+    std::unique_lock l(mtx_);
+    assert(!pending_);
+
+    // Values announced by request() are already part of the demand.
+    bool announced = announced_ != 0;
+    if (announced) {
+      --announced_;
+    }
+
+    if (!buffer_.empty()) {
+      value_type v(std::move(buffer_.front()));
+      buffer_.pop_front();
+      l.unlock();
+
+      dst->fullfill(std::make_tuple(std::move(v)));
+    } else if (ended_) {
+      l.unlock();
+      deliver_end(*dst);
+    } else {
+      pending_ = std::move(dst);
+      add_demand(l, announced ? 0 : 1);
+    }
+  }
+
+  void request(std::size_t n) {
+    std::unique_lock l(mtx_);
+    announced_ += n;
+    add_demand(l, n);
+  }
+
+  // The iterator is gone, so values no longer need to be kept around.
+  void abandon() {
+    std::unique_lock l(mtx_);
+    abandoned_ = true;
+    buffer_.clear();
+    add_demand(l, unbounded_stream_demand);
+  }
+
+ private:
+  using Buffer_alloc = typename std::allocator_traits<
+      Alloc>::template rebind_alloc<std::tuple<Ts...>>;
+
+  void end(std::exception_ptr e) {
+    std::unique_lock l(mtx_);
+    ended_ = true;
+    error_ = std::move(e);
+
+    if (pending_) {
+      auto dst = std::move(pending_);
+      l.unlock();
+      deliver_end(*dst);
+    }
+  }
+
+  void deliver_end(dst_storage_type& dst) {
+    if (error_) {
+      dst.fail(std::exception_ptr(error_));
+    } else {
+      dst.fullfill(std::make_tuple(value_type()));
+    }
+  }
+
+  // Releases l.
+  void add_demand(std::unique_lock<std::mutex>& l, std::size_t n) {
+    std::size_t prev = demand_;
+    if (n > unbounded_stream_demand - prev) {
+      demand_ = unbounded_stream_demand;
+    } else {
+      demand_ = prev + n;
+    }
+    l.unlock();
+
+    if (prev == 0 && n != 0) {
+      src_->notify_demand();
+    }
+  }
+
+  src_storage_type* src_;
+
+  std::mutex mtx_;
+  std::deque<std::tuple<Ts...>, Buffer_alloc> buffer_;
+  Storage_ptr<dst_storage_type> pending_;
+  std::size_t announced_ = 0;
+  bool ended_ = false;
+  bool abandoned_ = false;
+  std::exception_ptr error_;
+
+  // Written while holding mtx_, so that it can be read without it.
+  std::atomic<std::size_t> demand_ = 0;
+};
+}  // namespace detail
+
+template <typename Alloc, typename... Ts>
+Basic_stream_iterator<Alloc, Ts...>
+Basic_stream_future<Alloc, Ts...>::begin_async() {
+  assert(storage_);
+
+  using handler_t = detail::Stream_pull_handler<Alloc, Ts...>;
+
+  detail::Immediate_queue queue;
+  storage_->template set_handler<handler_t>(&queue, &*storage_);
+
+  return Basic_stream_iterator<Alloc, Ts...>(std::move(storage_));
+}
+
+template <typename Alloc, typename... Ts>
+Basic_stream_iterator<Alloc, Ts...>::Basic_stream_iterator(
+    detail::Storage_ptr<storage_type> s)
+    : storage_(std::move(s)) {}
+
+template <typename Alloc, typename... Ts>
+Basic_stream_iterator<Alloc, Ts...>& Basic_stream_iterator<Alloc, Ts...>::
+operator=(Basic_stream_iterator&& rhs) {
+  if (storage_) {
+    handler()->abandon();
+  }
+  storage_ = std::move(rhs.storage_);
+  spare_ = std::move(rhs.spare_);
+  return *this;
+}
+
+template <typename Alloc, typename... Ts>
+Basic_stream_iterator<Alloc, Ts...>::~Basic_stream_iterator() {
+  if (storage_) {
+    handler()->abandon();
+  }
+}
+
+template <typename Alloc, typename... Ts>
+typename Basic_stream_iterator<Alloc, Ts...>::handler_type*
+Basic_stream_iterator<Alloc, Ts...>::handler() const {
+  return static_cast<handler_type*>(storage_->handler());
+}
+
+template <typename Alloc, typename... Ts>
+typename Basic_stream_iterator<Alloc, Ts...>::future_type
+Basic_stream_iterator<Alloc, Ts...>::next() {
+  assert(storage_);
+
+  // Once the previous future has been consumed, nobody else refers to its
+  // storage anymore.
+  if (spare_.unique()) {
+    spare_->recycle();
+  } else {
+    spare_.allocate(storage_->allocator());
+  }
+
+  future_type result(spare_);
+  handler()->next(spare_);
+  return result;
+}
+
+template <typename Alloc, typename... Ts>
+void Basic_stream_iterator<Alloc, Ts...>::request(std::size_t n) {
+  assert(storage_);
+  handler()->request(n);
+}
+}  // namespace aom
+#endif
@@ -0,0 +1,415 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_IMPL_STREAM_REDUCE_INCLUDED_H
+#define AOM_VARIADIC_IMPL_STREAM_REDUCE_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include "var_future/impl/stream/stages.h"
+#include "var_future/impl/stream/stream_storage_decl.h"
+#include "var_future/impl/utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace aom {
+
+namespace detail {
+
+inline std::uint64_t next_reduction_id() {
+  static std::atomic<std::uint64_t> next = 1;
+  return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Shared by a reduce() handler and the tasks it posts.
+//
+// Every thread that runs a task accumulates into its own partial accumulator,
+// so op is never invoked concurrently on the same one. The partials are
+// combined once the source is over, and every posted task has run.
+template <typename Alloc, typename AccT, typename OpT, typename CombineT>
+class Reduce_state {
+ public:
+  using dst_storage_type = Future_storage<Alloc, AccT>;
+
+  Reduce_state(const Alloc& alloc, AccT init, OpT op, CombineT combine,
+               Storage_ptr<dst_storage_type> dst)
+      : alloc_(alloc),
+        init_(std::move(init)),
+        op_(std::move(op)),
+        combine_(std::move(combine)),
+        dst_(std::move(dst)) {}
+
+  ~Reduce_state() {
+    Partial_alloc real_alloc(alloc_);
+    auto p = partials_.load();
+    while (p) {
+      auto next = p->next;
+      p->~Partial();
+      real_alloc.deallocate(p, 1);
+      p = next;
+    }
+  }
+
+  // Must be called before the corresponding accumulate().
+  void add_pending() { pending_.fetch_add(1, std::memory_order_relaxed); }
+
+  // Undoes add_pending() for values that could not be posted, which fails the
+  // reduction since they are missing from it.
+  void drop_pending(std::exception_ptr e) {
+    set_error(std::move(e));
+    release();
+  }
+
+  template <typename... Us>
+  void accumulate(Us&&... vals) {
+    if (!failed_.load(std::memory_order_relaxed)) {
+      try {
+        auto& acc = local();
+        acc = std::invoke(op_, std::move(acc), std::forward<Us>(vals)...);
+      } catch (...) {
+        set_error(std::current_exception());
+      }
+    }
+    release();
+  }
+
+  void on_source_end(std::exception_ptr e) {
+    if (e) {
+      set_error(std::move(e));
+    }
+    release();
+  }
+
+ private:
+  struct Partial {
+    std::thread::id owner;
+    AccT acc;
+    Partial* next;
+  };
+
+  using Partial_alloc =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<Partial>;
+
+  AccT& local() {
+    // Remembers the last partial used by this thread, reductions being
+    // told apart by an id that is never reused.
+    thread_local struct {
+      std::uint64_t id = 0;
+      Partial* partial = nullptr;
+    } cache;
+
+    if (cache.id == id_) {
+      return cache.partial->acc;
+    }
+
+    auto me = std::this_thread::get_id();
+    auto p = partials_.load(std::memory_order_acquire);
+    while (p && p->owner != me) {
+      p = p->next;
+    }
+
+    if (!p) {
+      Partial_alloc real_alloc(alloc_);
+      auto ptr = real_alloc.allocate(1);
+      try {
+        p = new (ptr) Partial{me, init_, partials_.load()};
+      } catch (...) {
+        real_alloc.deallocate(ptr, 1);
+        throw;
+      }
+      while (!partials_.compare_exchange_weak(p->next, p,
+                                              std::memory_order_release)) {
+      }
+    }
+
+    cache.id = id_;
+    cache.partial = p;
+    return p->acc;
+  }
+
+  void set_error(std::exception_ptr e) {
+    if (!failed_.exchange(true)) {
+      error_ = std::move(e);
+    }
+  }
+
+  void release() {
+    if (pending_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+      return;
+    }
+
+    auto dst = std::move(dst_);
+    if (error_) {
+      dst->fail(std::move(error_));
+      return;
+    }
+
+    try {
+      // Partials are combined in the order they were created.
+      std::vector<Partial*> partials;
+      for (auto p = partials_.load(std::memory_order_acquire); p;
+           p = p->next) {
+        partials.push_back(p);
+      }
+
+      AccT result = std::move(init_);
+      for (auto it = partials.rbegin(); it != partials.rend(); ++it) {
+        result =
+            std::invoke(combine_, std::move(result), std::move((*it)->acc));
+      }
+      dst->fullfill(std::make_tuple(std::move(result)));
+    } catch (...) {
+      dst->fail(std::current_exception());
+    }
+  }
+
+  Alloc alloc_;
+  AccT init_;
+  OpT op_;
+  CombineT combine_;
+  Storage_ptr<dst_storage_type> dst_;
+
+  std::uint64_t id_ = next_reduction_id();
+  std::atomic<Partial*> partials_ = nullptr;
+
+  // One for each posted task, and one for the source itself.
+  std::atomic<std::size_t> pending_ = 1;
+  std::atomic<bool> failed_ = false;
+  std::exception_ptr error_;
+};
+
+template <typename Alloc, typename StateT, typename QueueT, typename StagesT,
+          typename... Ts>
+class Stream_reduce_handler final
+    : public Stream_handler_base<QueueT, void, Ts...> {
+  using parent_type = Stream_handler_base<QueueT, void, Ts...>;
+  using fail_type = typename parent_type::fail_type;
+  using output_type = Stream_stages_output_t<StagesT, std::tuple<Ts...>>;
+
+ public:
+  Stream_reduce_handler(Storage_ptr<Future_storage<Alloc, void>>,
+                        QueueT* q, std::shared_ptr<StateT> state,
+                        StagesT stages)
+      : parent_type(q),
+        state_(std::move(state)),
+        stages_(std::move(stages)) {
+    if (stream_stages_exhausted(stages_)) {
+      complete();
+    }
+  }
+
+  void push(Ts... args) override {
+    if (done_) {
+      return;
+    }
+
+    auto post = [this](auto&&... vals) {
+      // Counted ahead, since the task may run before enqueue() returns.
+      state_->add_pending();
+      try {
+        output_type out(std::forward<decltype(vals)>(vals)...);
+        enqueue(this->get_queue(),
+                [state = state_, out = std::move(out)]() mutable {
+                  std::apply(
+                      [&](auto&... v) { state->accumulate(std::move(v)...); },
+                      out);
+                });
+      } catch (...) {
+        state_->drop_pending(std::current_exception());
+        throw;
+      }
+      return true;
+    };
+
+    if (!run_stream_stages(stages_, post, std::move(args)...)) {
+      complete();
+    }
+  }
+
+  void complete() override {
+    if (done_) {
+      return;
+    }
+    done_ = true;
+
+    state_->on_source_end(nullptr);
+  }
+
+  void fail(fail_type f) override {
+    if (done_) {
+      return;
+    }
+    done_ = true;
+
+    state_->on_source_end(std::move(f));
+  }
+
+ private:
+  std::shared_ptr<StateT> state_;
+  StagesT stages_;
+  bool done_ = false;
+};
+
+// Accumulates values in chunks of geometrically increasing sizes, so that
+// nothing is moved until the final vector, whose size is then known, is
+// assembled.
+template <typename Alloc, typename StagesT, typename... Ts>
+class Stream_collect_handler final
+    : public Stream_handler_iface<Ts...> {
+  using parent_type = Stream_handler_iface<Ts...>;
+  using fail_type = typename parent_type::fail_type;
+  using output_type = Stream_stages_output_t<StagesT, std::tuple<Ts...>>;
+
+ public:
+  using element_type = Stream_element_t<output_type>;
+  using dst_storage_type = Future_storage<Alloc, std::vector<element_type>>;
+
+  static constexpr std::size_t first_chunk_size = 16;
+
+  Stream_collect_handler(Storage_ptr<Future_storage<Alloc, void>>,
+                         Immediate_queue*, Storage_ptr<dst_storage_type> dst,
+                         StagesT stages)
+      : stages_(std::move(stages)), dst_(std::move(dst)) {
+    if (stream_stages_exhausted(stages_)) {
+      complete();
+    }
+  }
+
+  void push(Ts... args) override {
+    if (done_) {
+      return;
+    }
+
+    auto store = [this](auto&&... vals) {
+      if (chunks_.empty() ||
+          chunks_.back().size() == chunks_.back().capacity()) {
+        chunks_.emplace_back();
+        chunks_.back().reserve(std::max(first_chunk_size, size_));
+      }
+      chunks_.back().emplace_back(std::forward<decltype(vals)>(vals)...);
+      ++size_;
+      return true;
+    };
+
+    if (!run_stream_stages(stages_, store, std::move(args)...)) {
+      complete();
+    }
+  }
+
+  void complete() override {
+    if (done_) {
+      return;
+    }
+    done_ = true;
+
+    try {
+      std::vector<element_type> result;
+      result.reserve(size_);
+      for (auto& chunk : chunks_) {
+        std::move(chunk.begin(), chunk.end(), std::back_inserter(result));
+      }
+      chunks_.clear();
+      dst_->fullfill(std::make_tuple(std::move(result)));
+    } catch (...) {
+      dst_->fail(std::current_exception());
+    }
+  }
+
+  void fail(fail_type f) override {
+    if (done_) {
+      return;
+    }
+    done_ = true;
+
+    chunks_.clear();
+    dst_->fail(std::move(f));
+  }
+
+ private:
+  StagesT stages_;
+  Storage_ptr<dst_storage_type> dst_;
+
+  std::vector<std::vector<element_type>> chunks_;
+  std::size_t size_ = 0;
+  bool done_ = false;
+};
+}  // namespace detail
+
+template <typename Alloc, typename StagesT, typename... Ts>
+template <typename QueueT, typename AccT, typename OpT, typename CombineT>
+Basic_future<Alloc, AccT> Basic_stream_pipeline<Alloc, StagesT, Ts...>::reduce(
+    QueueT& queue, AccT init, OpT&& op, CombineT&& combine) {
+  assert(storage_);
+
+  using state_type = detail::Reduce_state<Alloc, AccT, std::decay_t<OpT>,
+                                          std::decay_t<CombineT>>;
+  using handler_t =
+      detail::Stream_reduce_handler<Alloc, state_type, QueueT, StagesT, Ts...>;
+
+  const Alloc& alloc = storage_->allocator();
+
+  detail::Storage_ptr<typename state_type::dst_storage_type> dst;
+  dst.allocate(alloc);
+  Basic_future<Alloc, AccT> result(dst);
+
+  auto state = std::allocate_shared<state_type>(
+      alloc, alloc, std::move(init), std::forward<OpT>(op),
+      std::forward<CombineT>(combine), std::move(dst));
+
+  storage_->template set_handler<handler_t>(&queue, std::move(state),
+                                            std::move(stages_));
+  storage_.reset();
+
+  return result;
+}
+
+template <typename Alloc, typename StagesT, typename... Ts>
+auto Basic_stream_pipeline<Alloc, StagesT, Ts...>::collect() {
+  assert(storage_);
+
+  using handler_t = detail::Stream_collect_handler<Alloc, StagesT, Ts...>;
+  using dst_storage_type = typename handler_t::dst_storage_type;
+
+  detail::Storage_ptr<dst_storage_type> dst;
+  dst.allocate(storage_->allocator());
+  typename dst_storage_type::future_type result(dst);
+
+  detail::Immediate_queue queue;
+  storage_->template set_handler<handler_t>(&queue, std::move(dst),
+                                            std::move(stages_));
+  storage_.reset();
+
+  return result;
+}
+
+template <typename Alloc, typename... Ts>
+template <typename QueueT, typename AccT, typename OpT, typename CombineT>
+Basic_future<Alloc, AccT> Basic_stream_future<Alloc, Ts...>::reduce(
+    QueueT& queue, AccT init, OpT&& op, CombineT&& combine) {
+  return as_pipeline().reduce(queue, std::move(init), std::forward<OpT>(op),
+                              std::forward<CombineT>(combine));
+}
+
+template <typename Alloc, typename... Ts>
+auto Basic_stream_future<Alloc, Ts...>::collect() {
+  return as_pipeline().collect();
+}
+}  // namespace aom
+#endif
@@ -0,0 +1,160 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_IMPL_STREAM_SPILL_INCLUDED_H
+#define AOM_VARIADIC_IMPL_STREAM_SPILL_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace aom {
+
+namespace detail {
+
+// Wether values made of Ts can be written to a file as raw bytes, and read
+// back.
+template <typename... Ts>
+constexpr bool stream_spillable_v =
+    (... && (std::is_trivially_copyable_v<Ts> &&
+             std::is_default_constructible_v<Ts>));
+
+// Values of a stream that were moved out of memory while it had no handler.
+//
+// Each value is recorded as the bytes of its fields, one after the other, at
+// the end of an anonymous temporary file that disappears once closed.
+// Spilling is best effort: if the file cannot be created or written to,
+// whatever was already written is kept, and the remaining values simply stay
+// in memory.
+template <typename... Ts>
+class Stream_spill {
+  static_assert(stream_spillable_v<Ts...>,
+                "Only streams of trivially copyable types can be spilled");
+
+ public:
+  using value_type = std::tuple<Ts...>;
+  static constexpr std::size_t record_size = (sizeof(Ts) + ... + 0);
+
+  explicit Stream_spill(std::size_t threshold)
+      : threshold_(std::max<std::size_t>(threshold, 1)) {}
+
+  ~Stream_spill() {
+    if (file_) {
+      std::fclose(file_);
+    }
+  }
+
+  // How many values may stay in memory before they are spilled.
+  std::size_t threshold() const { return threshold_; }
+
+  // Wether write() may still be invoked.
+  bool active() const { return !failed_; }
+
+  // Appends the values to the file, and clears values if they all made it.
+  void write(std::vector<value_type>& values) {
+    assert(active());
+
+    if (!file_) {
+      file_ = std::tmpfile();
+      if (!file_) {
+        failed_ = true;
+        return;
+      }
+    }
+
+    bytes_.resize(values.size() * record_size);
+    unsigned char* dst = bytes_.data();
+    for (const auto& v : values) {
+      dst = std::apply(
+          [&](const auto&... fields) {
+            ((std::memcpy(dst, &fields, sizeof(fields)),
+              dst += sizeof(fields)),
+             ...);
+            return dst;
+          },
+          v);
+    }
+
+    if (std::fwrite(bytes_.data(), 1, bytes_.size(), file_) != bytes_.size()) {
+      // The partial record is never read back, since count_ stops short of
+      // it, and nothing else is written after it.
+      failed_ = true;
+      return;
+    }
+
+    count_ += values.size();
+    values.clear();
+  }
+
+  // Invokes cb with each spilled value, in the order they were written.
+  // Throws std::system_error if the file cannot be read back.
+  template <typename CbT>
+  void replay(CbT&& cb) {
+    if (count_ == 0) {
+      return;
+    }
+
+    if (std::fseek(file_, 0, SEEK_SET) != 0) {
+      throw std::system_error(errno, std::generic_category(),
+                              "rewinding stream spill file");
+    }
+
+    std::size_t remaining = count_;
+    while (remaining != 0) {
+      std::size_t n = std::min(remaining, threshold_);
+      bytes_.resize(n * record_size);
+      if (std::fread(bytes_.data(), 1, bytes_.size(), file_) != bytes_.size()) {
+        throw std::system_error(errno, std::generic_category(),
+                                "reading stream spill file");
+      }
+
+      const unsigned char* src = bytes_.data();
+      for (std::size_t i = 0; i < n; ++i) {
+        value_type v;
+        std::apply(
+            [&](auto&... fields) {
+              ((std::memcpy(&fields, src, sizeof(fields)),
+                src += sizeof(fields)),
+               ...);
+            },
+            v);
+        cb(v);
+      }
+      remaining -= n;
+    }
+  }
+
+ private:
+  std::size_t threshold_;
+  std::FILE* file_ = nullptr;
+  std::size_t count_ = 0;
+  bool failed_ = false;
+  std::vector<unsigned char> bytes_;
+
+  Stream_spill(const Stream_spill&) = delete;
+  Stream_spill& operator=(const Stream_spill&) = delete;
+};
+}  // namespace detail
+}  // namespace aom
+#endif
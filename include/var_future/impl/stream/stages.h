@@ -0,0 +1,189 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef AOM_VARIADIC_IMPL_STREAM_STAGES_INCLUDED_H
+#define AOM_VARIADIC_IMPL_STREAM_STAGES_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace aom {
+
+namespace detail {
+
+// A stage of a stream pipeline is invoked as stage(next, values...), and
+// forwards zero or more sets of values to next(). It returns false once the
+// stream should end, regardless of what the producer does.
+//
+// Stream_stage_output<StageT, std::tuple<Ts...>>::type is the std::tuple of
+// the types the stage forwards when fed Ts.
+template <typename StageT, typename InT>
+struct Stream_stage_output;
+
+template <typename StagesT, typename InT>
+struct Stream_stages_output;
+
+template <typename InT>
+struct Stream_stages_output<std::tuple<>, InT> {
+  using type = InT;
+};
+
+template <typename FirstT, typename... RestT, typename InT>
+struct Stream_stages_output<std::tuple<FirstT, RestT...>, InT> {
+  using type = typename Stream_stages_output<
+      std::tuple<RestT...>,
+      typename Stream_stage_output<FirstT, InT>::type>::type;
+};
+
+template <typename StagesT, typename InT>
+using Stream_stages_output_t =
+    typename Stream_stages_output<StagesT, InT>::type;
+
+template <typename CbT>
+struct Stream_map_stage {
+  CbT cb_;
+
+  template <typename NextT, typename... Args>
+  bool operator()(NextT&& next, Args&&... args) {
+    return next(std::invoke(cb_, std::forward<Args>(args)...));
+  }
+
+  bool exhausted() const { return false; }
+};
+
+template <typename CbT, typename... Ts>
+struct Stream_stage_output<Stream_map_stage<CbT>, std::tuple<Ts...>> {
+  using result_type = std::invoke_result_t<CbT&, Ts...>;
+  static_assert(!std::is_same_v<void, result_type>,
+                "map() callbacks must return a value");
+
+  using type = std::tuple<std::decay_t<result_type>>;
+};
+
+template <typename PredT>
+struct Stream_filter_stage {
+  PredT pred_;
+
+  template <typename NextT, typename... Args>
+  bool operator()(NextT&& next, Args&&... args) {
+    if (!std::invoke(pred_, std::as_const(args)...)) {
+      return true;
+    }
+    return next(std::forward<Args>(args)...);
+  }
+
+  bool exhausted() const { return false; }
+};
+
+template <typename PredT, typename InT>
+struct Stream_stage_output<Stream_filter_stage<PredT>, InT> {
+  using type = InT;
+};
+
+struct Stream_take_stage {
+  std::size_t remaining_;
+
+  template <typename NextT, typename... Args>
+  bool operator()(NextT&& next, Args&&... args) {
+    assert(remaining_ != 0);
+    --remaining_;
+    bool more = next(std::forward<Args>(args)...);
+    return more && remaining_ != 0;
+  }
+
+  bool exhausted() const { return remaining_ == 0; }
+};
+
+template <typename InT>
+struct Stream_stage_output<Stream_take_stage, InT> {
+  using type = InT;
+};
+
+template <typename AccT, typename OpT>
+struct Stream_scan_stage {
+  AccT acc_;
+  OpT op_;
+
+  template <typename NextT, typename... Args>
+  bool operator()(NextT&& next, Args&&... args) {
+    acc_ = std::invoke(op_, std::move(acc_), std::forward<Args>(args)...);
+    return next(std::as_const(acc_));
+  }
+
+  bool exhausted() const { return false; }
+};
+
+template <typename AccT, typename OpT, typename InT>
+struct Stream_stage_output<Stream_scan_stage<AccT, OpT>, InT> {
+  using type = std::tuple<AccT>;
+};
+
+// The type used to represent a single value of a stream as a whole: the
+// field itself if there is a single one, or a std::tuple of the fields.
+template <typename TupleT>
+struct Stream_element {
+  using type = TupleT;
+};
+
+template <typename T>
+struct Stream_element<std::tuple<T>> {
+  using type = T;
+};
+
+template <typename TupleT>
+using Stream_element_t = typename Stream_element<TupleT>::type;
+
+template <typename TupleT>
+Stream_element_t<TupleT> to_stream_element(TupleT values) {
+  if constexpr (std::tuple_size_v<TupleT> == 1) {
+    return std::get<0>(std::move(values));
+  } else {
+    return values;
+  }
+}
+
+// Feeds values through every stage, and then to term(), which returns false
+// if the stream should end. Returns false once the stream should end.
+template <std::size_t I = 0, typename StagesT, typename TermT,
+          typename... Args>
+bool run_stream_stages(StagesT& stages, TermT& term, Args&&... args) {
+  if constexpr (I == std::tuple_size_v<StagesT>) {
+    return term(std::forward<Args>(args)...);
+  } else {
+    return std::get<I>(stages)(
+        [&](auto&&... vals) {
+          return run_stream_stages<I + 1>(
+              stages, term, std::forward<decltype(vals)>(vals)...);
+        },
+        std::forward<Args>(args)...);
+  }
+}
+
+// Wether a stage will end the stream before seeing any value.
+template <typename StagesT>
+bool stream_stages_exhausted(const StagesT& stages) {
+  return std::apply([](const auto&... s) { return (s.exhausted() || ...); },
+                    stages);
+}
+
+}  // namespace detail
+}  // namespace aom
+#endif
@@ -57,5 +57,11 @@ Basic_stream_future<Alloc, Ts...>::for_each(QueueT& queue, CbT&& cb) {
   return result_fut;
 }
 
+template <typename Alloc, typename... Ts>
+Alloc& Basic_stream_future<Alloc, Ts...>::allocator() {
+  assert(storage_);
+  return storage_->allocator();
+}
+
 }  // namespace aom
 #endif
\ No newline at end of file
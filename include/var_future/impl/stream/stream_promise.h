@@ -60,6 +60,24 @@ void Basic_stream_promise<Alloc, Ts...>::set_exception(fail_type e) {
   storage_.reset();
 }
 
+template <typename Alloc, typename... Ts>
+std::size_t Basic_stream_promise<Alloc, Ts...>::demand() const {
+  assert(storage_);
+  return storage_->demand();
+}
+
+template <typename Alloc, typename... Ts>
+Basic_future<Alloc, void> Basic_stream_promise<Alloc, Ts...>::when_demanded() {
+  assert(storage_);
+  return storage_->when_demanded();
+}
+
+template <typename Alloc, typename... Ts>
+void Basic_stream_promise<Alloc, Ts...>::spill_to_disk(std::size_t threshold) {
+  assert(storage_);
+  storage_->spill_to_disk(threshold);
+}
+
 template <typename Alloc, typename... Ts>
 Basic_stream_promise<Alloc, Ts...>::operator bool() const {
   return storage_;
@@ -17,10 +17,21 @@
 
 #include "var_future/config.h"
 
+#include "var_future/impl/stream/spill.h"
+
+#include <cstddef>
+#include <limits>
+#include <mutex>
+#include <vector>
+
 namespace aom {
 
 namespace detail {
 
+// Demand of handlers that accept values as fast as they come.
+constexpr std::size_t unbounded_stream_demand =
+    std::numeric_limits<std::size_t>::max();
+
 template <typename... Ts>
 class Stream_handler_iface {
  public:
@@ -39,6 +50,9 @@ class Stream_handler_iface {
   virtual void push(Ts...) = 0;
   virtual void complete() = 0;
   virtual void fail(fail_type) = 0;
+
+  // How many values the consumer is currently waiting for.
+  virtual std::size_t demand() const { return unbounded_stream_demand; }
 };
 
 template <typename QueueT, typename Enable = void, typename... Ts>
@@ -67,6 +81,9 @@ class Stream_handler_base<QueueT, std::enable_if_t<has_static_push_v<QueueT>>,
 constexpr std::uint8_t Stream_storage_state_ready_bit = 1;
 constexpr std::uint8_t Stream_storage_state_fail_bit = 2;
 constexpr std::uint8_t Stream_storage_state_complete_bit = 4;
+// The handler was failed while it was being set, as spilled values could not
+// be read back. Whatever the producer does next is ignored.
+constexpr std::uint8_t Stream_storage_state_broken_bit = 8;
 
 template <typename Alloc, typename... Ts>
 class Stream_storage : public Alloc {
@@ -91,15 +108,37 @@ class Stream_storage : public Alloc {
   Alloc& allocator() { return *static_cast<Alloc*>(this); }
   const Alloc& allocator() const { return *static_cast<const Alloc*>(this); }
 
+  // Must be invoked before set_handler() for the handler to receive the
+  // final promise. Handlers installed without it receive a null one.
+  //
+  // The promise has a reference count of its own, so it is allocated apart
+  // from the stream, which for_each() always pays for.
   Basic_future<Alloc, void> get_final_future() {
+    if (!final_promise_) {
+      final_promise_.allocate(allocator());
+    }
     return Basic_future<Alloc, void>{final_promise_};
   }
 
+  Stream_handler_iface<Ts...>* handler() const { return cb_data_.callback_; }
+
+  // 0 until a handler is set, and then whatever the handler reports.
+  std::size_t demand() const;
+
+  // Fullfilled once demand() is not 0. Only one may be pending at a time.
+  Basic_future<Alloc, void> when_demanded();
+
+  // Invoked by handlers when their demand stops being 0.
+  void notify_demand();
+
+  // Moves values out of memory, threshold at a time, until a handler is set.
+  void spill_to_disk(std::size_t threshold);
+
  private:
   struct Callback_data {
     // This will either point to sbo_buffer_, or heap-allocated data, depending
     // on state_.
-    Stream_handler_iface<Ts...>* callback_;
+    Stream_handler_iface<Ts...>* callback_ = nullptr;
   };
 
   Callback_data cb_data_;
@@ -107,10 +146,17 @@ class Stream_storage : public Alloc {
   std::mutex mtx_;
   fullfill_buffer_type fullfilled_;
   std::exception_ptr error_;
+  Storage_ptr<Future_storage<Alloc, void>> demand_waiter_;
+
+  // Only ever set for stream_spillable_v<Ts...>
+  Stream_spill<Ts...>* spill_ = nullptr;
+  void destroy_spill();
 
   template <typename T>
   friend struct Storage_ptr;
 
+  // Only allocated for consumers that hand out a completion future, such as
+  // for_each().
   Storage_ptr<Future_storage<Alloc, void>> final_promise_;
 
   std::atomic<std::uint8_t> state_ = 0;
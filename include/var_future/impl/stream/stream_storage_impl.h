@@ -37,13 +37,13 @@ Stream_storage<Alloc, Ts...>::~Stream_storage() {
     Real_alloc real_alloc(allocator());
     real_alloc.deallocate(cb_data_.callback_, 1);
   }
+
+  destroy_spill();
 }
 
 template <typename Alloc, typename... Ts>
 Stream_storage<Alloc, Ts...>::Stream_storage(const Alloc& alloc)
-    : Alloc(alloc) {
-  final_promise_.allocate(alloc);
-}
+    : Alloc(alloc) {}
 
 template <typename Alloc, typename... Ts>
 template <typename... Us>
@@ -55,7 +55,9 @@ void Stream_storage<Alloc, Ts...>::push(Us&&... args) {
 
   if (flags & Stream_storage_state_ready_bit) {
     // This is supposed to be by far and wide the most common case.
-    cb_data_.callback_->push(std::forward<Us>(args)...);
+    if ((flags & Stream_storage_state_broken_bit) == 0) {
+      cb_data_.callback_->push(std::forward<Us>(args)...);
+    }
   } else {
     std::unique_lock l(mtx_);
     flags = state_.load();
@@ -63,9 +65,18 @@ void Stream_storage<Alloc, Ts...>::push(Us&&... args) {
     if (flags & Stream_storage_state_ready_bit) {
       // This is extremely unlikely.
       l.unlock();
-      cb_data_.callback_->push(std::forward<Us>(args)...);
+      if ((flags & Stream_storage_state_broken_bit) == 0) {
+        cb_data_.callback_->push(std::forward<Us>(args)...);
+      }
     } else {
-      fullfilled_.push_back(std::move(args)...);
+      fullfilled_.emplace_back(std::forward<Us>(args)...);
+
+      if constexpr (stream_spillable_v<Ts...>) {
+        if (spill_ && spill_->active() &&
+            fullfilled_.size() >= spill_->threshold()) {
+          spill_->write(fullfilled_);
+        }
+      }
     }
   }
 }
@@ -77,7 +88,9 @@ void Stream_storage<Alloc, Ts...>::complete() {
 
   if (flags & Stream_storage_state_ready_bit) {
     l.unlock();
-    cb_data_.callback_->complete();
+    if ((flags & Stream_storage_state_broken_bit) == 0) {
+      cb_data_.callback_->complete();
+    }
   } else {
     state_.fetch_or(Stream_storage_state_complete_bit);
   }
@@ -90,7 +103,9 @@ void Stream_storage<Alloc, Ts...>::fail(fail_type&& e) {
 
   if (flags & Stream_storage_state_ready_bit) {
     l.unlock();
-    cb_data_.callback_->fail(std::move(e));
+    if ((flags & Stream_storage_state_broken_bit) == 0) {
+      cb_data_.callback_->fail(std::move(e));
+    }
   } else {
     error_ = std::move(e);
     state_.fetch_or(Stream_storage_state_fail_bit);
@@ -109,8 +124,8 @@ void Stream_storage<Alloc, Ts...>::set_handler(QueueT* queue,
   Real_alloc real_alloc(allocator());
   auto ptr = real_alloc.allocate(1);
   try {
-    new_handler = new (ptr)
-        Handler_t(final_promise_, queue, std::forward<Args_t>(args)...);
+    new_handler = new (ptr) Handler_t(std::move(final_promise_), queue,
+                                      std::forward<Args_t>(args)...);
   } catch (...) {
     real_alloc.deallocate(ptr, 1);
     throw;
@@ -119,13 +134,57 @@ void Stream_storage<Alloc, Ts...>::set_handler(QueueT* queue,
   cb_data_.callback_ = new_handler;
 
   std::unique_lock l(mtx_);
+
+  // Spilled values are older than the ones still in memory.
+  fail_type replay_error;
+  if constexpr (stream_spillable_v<Ts...>) {
+    if (spill_) {
+      try {
+        spill_->replay([&](fullfill_type& v) {
+          std::apply(
+              [&](auto&... args) { new_handler->push(std::move(args)...); },
+              v);
+        });
+      } catch (...) {
+        replay_error = std::current_exception();
+      }
+      destroy_spill();
+    }
+  }
+
+  if (replay_error) {
+    // The values in memory would come after a gap, so they are dropped along
+    // with whatever the producer still has to say.
+    fullfilled_.clear();
+    state_.fetch_or(Stream_storage_state_ready_bit |
+                    Stream_storage_state_broken_bit);
+    auto waiter = std::move(demand_waiter_);
+    l.unlock();
+
+    if (waiter) {
+      waiter->fullfill(fullfill_type_t<void>());
+    }
+    new_handler->fail(std::move(replay_error));
+    return;
+  }
+
   for (auto& v : fullfilled_) {
-    Handler_t::do_push(queue, new_handler->cb_, std::move(v));
+    std::apply([&](auto&... args) { new_handler->push(std::move(args)...); },
+               v);
   }
 
   auto flags = state_.fetch_or(Stream_storage_state_ready_bit);
+
+  Storage_ptr<Future_storage<Alloc, void>> waiter;
+  if (demand_waiter_ && new_handler->demand() != 0) {
+    waiter = std::move(demand_waiter_);
+  }
   l.unlock();
 
+  if (waiter) {
+    waiter->fullfill(fullfill_type_t<void>());
+  }
+
   if ((flags & Stream_storage_state_complete_bit) != 0) {
     cb_data_.callback_->complete();
   } else if ((flags & Stream_storage_state_fail_bit) != 0) {
@@ -133,6 +192,82 @@ void Stream_storage<Alloc, Ts...>::set_handler(QueueT* queue,
   }
 }
 
+template <typename Alloc, typename... Ts>
+std::size_t Stream_storage<Alloc, Ts...>::demand() const {
+  if ((state_.load() & Stream_storage_state_ready_bit) == 0) {
+    return 0;
+  }
+  return cb_data_.callback_->demand();
+}
+
+template <typename Alloc, typename... Ts>
+Basic_future<Alloc, void> Stream_storage<Alloc, Ts...>::when_demanded() {
+  Storage_ptr<Future_storage<Alloc, void>> waiter;
+  waiter.allocate(allocator());
+  Basic_future<Alloc, void> result(waiter);
+
+  std::unique_lock l(mtx_);
+  if (demand() == 0) {
+    assert(!demand_waiter_);
+    demand_waiter_ = std::move(waiter);
+    return result;
+  }
+  l.unlock();
+
+  waiter->fullfill(fullfill_type_t<void>());
+  return result;
+}
+
+template <typename Alloc, typename... Ts>
+void Stream_storage<Alloc, Ts...>::notify_demand() {
+  std::unique_lock l(mtx_);
+  auto waiter = std::move(demand_waiter_);
+  l.unlock();
+
+  if (waiter) {
+    waiter->fullfill(fullfill_type_t<void>());
+  }
+}
+
+template <typename Alloc, typename... Ts>
+void Stream_storage<Alloc, Ts...>::spill_to_disk(std::size_t threshold) {
+  static_assert(stream_spillable_v<Ts...>,
+                "Only streams of trivially copyable types can be spilled");
+
+  using alloc_traits = std::allocator_traits<Alloc>;
+  using Real_alloc =
+      typename alloc_traits::template rebind_alloc<Stream_spill<Ts...>>;
+
+  std::unique_lock l(mtx_);
+  if (spill_ || (state_.load() & Stream_storage_state_ready_bit) != 0) {
+    return;
+  }
+
+  Real_alloc real_alloc(allocator());
+  auto ptr = real_alloc.allocate(1);
+  spill_ = new (ptr) Stream_spill<Ts...>(threshold);
+
+  if (fullfilled_.size() >= spill_->threshold()) {
+    spill_->write(fullfilled_);
+  }
+}
+
+template <typename Alloc, typename... Ts>
+void Stream_storage<Alloc, Ts...>::destroy_spill() {
+  if constexpr (stream_spillable_v<Ts...>) {
+    if (spill_) {
+      using alloc_traits = std::allocator_traits<Alloc>;
+      using Real_alloc =
+          typename alloc_traits::template rebind_alloc<Stream_spill<Ts...>>;
+
+      spill_->~Stream_spill();
+      Real_alloc real_alloc(allocator());
+      real_alloc.deallocate(spill_, 1);
+      spill_ = nullptr;
+    }
+  }
+}
+
 }  // namespace detail
 }  // namespace aom
 #endif
\ No newline at end of file
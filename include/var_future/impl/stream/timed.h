@@ -0,0 +1,283 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_IMPL_STREAM_TIMED_INCLUDED_H
+#define AOM_VARIADIC_IMPL_STREAM_TIMED_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include "var_future/impl/stream/map_async.h"
+#include "var_future/impl/stream/stages.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+namespace aom {
+
+namespace detail {
+
+using Stream_duration = std::chrono::steady_clock::duration;
+
+// Lets values through, and then ignores them until the timer reopens the
+// gate. The stage runs where the values are pushed, so only the gate is
+// shared with the timer.
+template <typename TimerT>
+struct Stream_throttle_stage {
+  TimerT* timer_;
+  Stream_duration period_;
+  std::shared_ptr<std::atomic<bool>> open_;
+
+  template <typename NextT, typename... Args>
+  bool operator()(NextT&& next, Args&&... args) {
+    if (!open_->load(std::memory_order_acquire)) {
+      return true;
+    }
+
+    open_->store(false, std::memory_order_relaxed);
+    timer_->schedule(period_, [open = open_] {
+      open->store(true, std::memory_order_release);
+    });
+    return next(std::forward<Args>(args)...);
+  }
+
+  bool exhausted() const { return false; }
+};
+
+template <typename TimerT, typename InT>
+struct Stream_stage_output<Stream_throttle_stage<TimerT>, InT> {
+  using type = InT;
+};
+
+// Shared by the handler of a timed operator and the ticks of its timer.
+//
+// Values accumulate in DerivedT under mtx_, which only guards that buffer, so
+// that producers never wait for the destination's consumer. Each tick flushes
+// the buffer into the destination while holding emit_mtx_, which keeps the
+// ticks and the end of the source from pushing concurrently.
+//
+// Ticks reschedule themselves until the source is over. The pending tick
+// keeps the state alive until it fires.
+template <typename Alloc, typename TimerT, typename DerivedT, typename... Ts>
+class Ticking_state : public std::enable_shared_from_this<DerivedT> {
+ public:
+  using dst_type = Basic_stream_promise<Alloc, Ts...>;
+
+  Ticking_state(TimerT& timer, Stream_duration period, dst_type dst)
+      : timer_(timer), period_(period), dst_(std::move(dst)) {}
+
+  void start() { schedule_tick(); }
+
+  void on_source_end(std::exception_ptr e) {
+    std::lock_guard l(emit_mtx_);
+    if (!dst_) {
+      return;
+    }
+
+    static_cast<DerivedT*>(this)->flush(dst_);
+
+    auto dst = std::move(dst_);
+    if (e) {
+      dst.set_exception(std::move(e));
+    } else {
+      dst.complete();
+    }
+  }
+
+ protected:
+  std::mutex mtx_;
+
+ private:
+  void schedule_tick() {
+    timer_.schedule(period_,
+                    [self = this->shared_from_this()] { self->tick(); });
+  }
+
+  void tick() {
+    {
+      std::lock_guard l(emit_mtx_);
+      if (!dst_) {
+        return;
+      }
+      static_cast<DerivedT*>(this)->flush(dst_);
+    }
+    schedule_tick();
+  }
+
+  TimerT& timer_;
+  Stream_duration period_;
+
+  std::mutex emit_mtx_;
+  dst_type dst_;
+};
+
+template <typename Alloc, typename TimerT, typename InT>
+class Window_state
+    : public Ticking_state<Alloc, TimerT, Window_state<Alloc, TimerT, InT>,
+                           std::vector<Stream_element_t<InT>>> {
+ public:
+  using element_type = Stream_element_t<InT>;
+  using batch_type = std::vector<element_type>;
+  using parent_type = Ticking_state<Alloc, TimerT, Window_state, batch_type>;
+
+  using parent_type::parent_type;
+
+  void on_input(InT v) {
+    std::lock_guard l(this->mtx_);
+    batch_.push_back(to_stream_element(std::move(v)));
+  }
+
+  void flush(typename parent_type::dst_type& dst) {
+    // Windows tend to be alike, so the next batch is reserved ahead, outside
+    // of the lock.
+    batch_type batch;
+    batch.reserve(expected_size_);
+    {
+      std::lock_guard l(this->mtx_);
+      batch.swap(batch_);
+    }
+
+    if (!batch.empty()) {
+      expected_size_ = batch.size();
+      dst.push(std::move(batch));
+    }
+  }
+
+ private:
+  batch_type batch_;
+
+  // Emitter only
+  std::size_t expected_size_ = 0;
+};
+
+template <typename Alloc, typename TimerT, typename InT>
+class Sample_state;
+
+template <typename Alloc, typename TimerT, typename... Ts>
+class Sample_state<Alloc, TimerT, std::tuple<Ts...>>
+    : public Ticking_state<Alloc, TimerT,
+                           Sample_state<Alloc, TimerT, std::tuple<Ts...>>,
+                           Ts...> {
+ public:
+  using parent_type = Ticking_state<Alloc, TimerT, Sample_state, Ts...>;
+
+  using parent_type::parent_type;
+
+  void on_input(std::tuple<Ts...> v) {
+    std::lock_guard l(this->mtx_);
+    latest_ = std::move(v);
+  }
+
+  void flush(typename parent_type::dst_type& dst) {
+    std::optional<std::tuple<Ts...>> latest;
+    {
+      std::lock_guard l(this->mtx_);
+      latest.swap(latest_);
+    }
+
+    if (latest) {
+      std::apply([&](auto&... v) { dst.push(std::move(v)...); }, *latest);
+    }
+  }
+
+ private:
+  std::optional<std::tuple<Ts...>> latest_;
+};
+
+// Installs a handler feeding the pipeline's values to a new StateT, which
+// starts ticking right away.
+template <typename StateT, typename StagesT, typename TimerT, typename Alloc,
+          typename... Ts>
+auto attach_ticking_state(Storage_ptr<Stream_storage<Alloc, Ts...>>& storage,
+                          StagesT stages, TimerT& timer,
+                          Stream_duration period) {
+  assert(storage);
+
+  using handler_t =
+      Stream_map_async_handler<Alloc, StateT, Immediate_queue, StagesT, Ts...>;
+
+  const Alloc& alloc = storage->allocator();
+
+  typename StateT::dst_type dst;
+  auto result = dst.get_future(alloc);
+
+  auto state =
+      std::allocate_shared<StateT>(alloc, timer, period, std::move(dst));
+  state->start();
+
+  Immediate_queue queue;
+  storage->template set_handler<handler_t>(&queue, std::move(state),
+                                           std::move(stages));
+  storage.reset();
+
+  return result;
+}
+}  // namespace detail
+
+template <typename Alloc, typename StagesT, typename... Ts>
+template <typename TimerT>
+auto Basic_stream_pipeline<Alloc, StagesT, Ts...>::window(
+    TimerT& timer, std::chrono::steady_clock::duration period) {
+  using state_type = detail::Window_state<Alloc, TimerT, output_type>;
+  return detail::attach_ticking_state<state_type>(storage_, std::move(stages_),
+                                                  timer, period);
+}
+
+template <typename Alloc, typename StagesT, typename... Ts>
+template <typename TimerT>
+auto Basic_stream_pipeline<Alloc, StagesT, Ts...>::sample(
+    TimerT& timer, std::chrono::steady_clock::duration period) {
+  using state_type = detail::Sample_state<Alloc, TimerT, output_type>;
+  return detail::attach_ticking_state<state_type>(storage_, std::move(stages_),
+                                                  timer, period);
+}
+
+template <typename Alloc, typename StagesT, typename... Ts>
+template <typename TimerT>
+auto Basic_stream_pipeline<Alloc, StagesT, Ts...>::throttle(
+    TimerT& timer, std::chrono::steady_clock::duration period) {
+  assert(storage_);
+
+  using stage_type = detail::Stream_throttle_stage<TimerT>;
+  auto open =
+      std::allocate_shared<std::atomic<bool>>(storage_->allocator(), true);
+  return then_stage(stage_type{&timer, period, std::move(open)});
+}
+
+template <typename Alloc, typename... Ts>
+template <typename TimerT>
+auto Basic_stream_future<Alloc, Ts...>::window(
+    TimerT& timer, std::chrono::steady_clock::duration period) {
+  return as_pipeline().window(timer, period);
+}
+
+template <typename Alloc, typename... Ts>
+template <typename TimerT>
+auto Basic_stream_future<Alloc, Ts...>::sample(
+    TimerT& timer, std::chrono::steady_clock::duration period) {
+  return as_pipeline().sample(timer, period);
+}
+
+template <typename Alloc, typename... Ts>
+template <typename TimerT>
+auto Basic_stream_future<Alloc, Ts...>::throttle(
+    TimerT& timer, std::chrono::steady_clock::duration period) {
+  return as_pipeline().throttle(timer, period);
+}
+}  // namespace aom
+#endif
@@ -0,0 +1,165 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_IMPL_TASK_GRAPH_INCLUDED_H
+#define AOM_VARIADIC_IMPL_TASK_GRAPH_INCLUDED_H
+
+#include "var_future/config.h"
+
+#include "var_future/impl/utils.h"
+
+#include <cassert>
+#include <utility>
+
+namespace aom {
+
+inline void Task_graph::Run_resource::release() {
+  if (ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete this;
+  }
+}
+
+inline void* Task_graph::Run_resource::do_allocate(std::size_t bytes,
+                                                   std::size_t alignment) {
+  void* result = pool_.allocate(bytes, alignment);
+  ref_count_.fetch_add(1, std::memory_order_relaxed);
+  return result;
+}
+
+inline void Task_graph::Run_resource::do_deallocate(void* p, std::size_t bytes,
+                                                    std::size_t alignment) {
+  pool_.deallocate(p, bytes, alignment);
+  release();
+}
+
+inline bool Task_graph::Run_resource::do_is_equal(
+    const std::pmr::memory_resource& other) const noexcept {
+  return this == &other;
+}
+
+inline Task_graph::~Task_graph() { resource_->release(); }
+
+template <typename CbT>
+Task_graph::node_id Task_graph::add(CbT&& task,
+                                    std::initializer_list<node_id> deps) {
+  assert(!dst_);
+
+  node_id id = nodes_.size();
+  for (auto d : deps) {
+    // Dependencies must already exist, which keeps the graph acyclic.
+    assert(d < id);
+    nodes_[d].successors.push_back(id);
+  }
+
+  Node node;
+  node.task = std::forward<CbT>(task);
+  node.in_degree = deps.size();
+  nodes_.push_back(std::move(node));
+
+  if (deps.size() == 0) {
+    roots_.push_back(id);
+  }
+  return id;
+}
+
+template <typename QueueT>
+pmr::Future<void> Task_graph::run(QueueT& queue) {
+  assert(!dst_);
+
+  queue_ = &queue;
+  push_ = [](void* q, Node_task t) {
+    detail::enqueue(static_cast<QueueT*>(q), std::move(t));
+  };
+
+  dst_.allocate(std::pmr::polymorphic_allocator<std::byte>(resource_));
+  pmr::Future<void> result(dst_);
+
+  start_run();
+  return result;
+}
+
+inline void Task_graph::start_run() {
+  if (pending_size_ != nodes_.size()) {
+    // Only happens when the graph changed since the last run.
+    pending_.reset(new std::atomic<std::size_t>[nodes_.size()]);
+    pending_size_ = nodes_.size();
+  }
+
+  for (std::size_t i = 0; i < nodes_.size(); ++i) {
+    pending_[i].store(nodes_[i].in_degree, std::memory_order_relaxed);
+  }
+  failed_ = false;
+  error_ = nullptr;
+  remaining_.store(nodes_.size(), std::memory_order_release);
+
+  if (nodes_.empty()) {
+    auto dst = std::move(dst_);
+    dst->fullfill(std::tuple<>{});
+    return;
+  }
+
+  for (auto id : roots_) {
+    schedule(id);
+  }
+}
+
+inline void Task_graph::schedule(node_id id) {
+  try {
+    push_(queue_, Node_task{this, id});
+  } catch (...) {
+    if (!failed_.exchange(true)) {
+      error_ = std::current_exception();
+    }
+    // The node will never run. It is done as far as the run is concerned, so
+    // that the run fails once the tasks already in the queue are over.
+    node_done(id);
+  }
+}
+
+inline void Task_graph::run_node(node_id id) {
+  if (!failed_.load(std::memory_order_relaxed)) {
+    try {
+      nodes_[id].task();
+    } catch (...) {
+      if (!failed_.exchange(true)) {
+        error_ = std::current_exception();
+      }
+    }
+  }
+
+  node_done(id);
+}
+
+inline void Task_graph::node_done(node_id id) {
+  for (auto succ : nodes_[id].successors) {
+    if (pending_[succ].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      schedule(succ);
+    }
+  }
+
+  if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    // The graph may be run again, or destroyed, by the continuation of dst,
+    // so it is not touched past this point. Releasing dst afterwards is safe
+    // since its memory keeps the pool alive.
+    auto error = std::move(error_);
+    auto dst = std::move(dst_);
+    if (error) {
+      dst->fail(std::move(error));
+    } else {
+      dst->fullfill(std::tuple<>{});
+    }
+  }
+}
+}  // namespace aom
+#endif
@@ -42,55 +42,74 @@ class Future_then_handler : public Future_handler_base<QueueT, void, Ts...> {
   Future_then_handler(QueueT* q, dst_type dst, CbT cb)
       : parent_type(q), dst_(std::move(dst)), cb_(std::move(cb)) {}
 
-  void fullfill(fullfill_type v) override {
+  void fullfill(fullfill_type&& v) override {
     do_fullfill(this->get_queue(), std::move(v), std::move(dst_),
                 std::move(cb_));
   };
 
-  void finish(finish_type f) override {
-    do_finish(this->get_queue(), f, std::move(dst_), std::move(cb_));
+  void finish(finish_type&& f) override {
+    do_finish(this->get_queue(), std::move(f), std::move(dst_), std::move(cb_));
   }
 
-  static void do_fullfill(QueueT* q, fullfill_type v, dst_type dst, CbT cb) {
-    enqueue(q, [cb = std::move(cb), dst = std::move(dst), v = std::move(v)] {
-      try {
-        if constexpr (std::is_same_v<void, cb_result_type>) {
-          std::apply(cb, std::move(v));
-          dst->fullfill(std::tuple<>{});
-        } else {
-          if constexpr (is_expected_v<cb_result_type>) {
-            dst->finish(std::apply(cb, std::move(v)));
-          } else {
-            dst->fullfill(std::apply(cb, std::move(v)));
-          }
-        }
-
-      } catch (...) {
-        dst->fail(std::current_exception());
-      }
+  static void do_fullfill(QueueT* q, fullfill_type&& v, dst_type dst,
+                          CbT cb) {
+    // No need to move the values into a task, use them where they are.
+    if (try_run_inline(q, [&] {
+          invoke(dst, [&] { return std::apply(cb, std::move(v)); });
+        })) {
+      return;
+    }
+
+    enqueue(q, [cb = std::move(cb), dst = std::move(dst),
+                v = std::move(v)]() mutable {
+      invoke(dst, [&] { return std::apply(cb, std::move(v)); });
     });
   }
 
-  static void do_finish(QueueT* q, finish_type f, dst_type dst, CbT cb) {
+  static void do_finish(QueueT* q, finish_type&& f, dst_type dst, CbT cb) {
     auto err = std::apply(get_first_error<Ts...>, f);
     if (err) {
       do_fail(q, *err, std::move(dst), std::move(cb));
-    } else {
-      fullfill_type cb_args =
-          finish_to_fullfill<std::tuple_size_v<finish_type> - 1>(std::move(f));
+      return;
+    }
 
-      do_fullfill(q, std::move(cb_args), std::move(dst), std::move(cb));
+    if (try_run_inline(q, [&] {
+          invoke(dst, [&] { return apply_finish<Ts...>(cb, std::move(f)); });
+        })) {
+      return;
     }
+
+    enqueue(q, [cb = std::move(cb), dst = std::move(dst),
+                f = std::move(f)]() mutable {
+      invoke(dst, [&] { return apply_finish<Ts...>(cb, std::move(f)); });
+    });
   }
 
   static void do_fail(QueueT* q, fail_type e, dst_type dst, CbT) {
     // Straight propagation.
-    enqueue(q, [dst = std::move(dst), e = std::move(e)]() mutable {
+    dispatch(q, [dst = std::move(dst), e = std::move(e)]() mutable {
       dst->fail(std::move(e));
     });
   }
 
  private:
+  // Invokes the callback and assigns its result to dst.
+  template <typename InvokeT>
+  static void invoke(const dst_type& dst, InvokeT&& cb_invoke) {
+    try {
+      if constexpr (std::is_same_v<void, cb_result_type>) {
+        cb_invoke();
+        dst->fullfill(std::tuple<>{});
+      } else if constexpr (is_expected_v<cb_result_type>) {
+        dst->finish(cb_invoke());
+      } else {
+        dst->fullfill(cb_invoke());
+      }
+    } catch (...) {
+      dst->fail(std::current_exception());
+    }
+  }
+
   dst_type dst_;
   CbT cb_;
 };
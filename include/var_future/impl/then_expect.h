@@ -43,48 +43,57 @@ class Future_then_expect_handler
   Future_then_expect_handler(QueueT* q, dst_type dst, CbT cb)
       : parent_type(q), dst_(std::move(dst)), cb_(std::move(cb)) {}
 
-  void fullfill(fullfill_type v) override {
+  void fullfill(fullfill_type&& v) override {
     do_fullfill(this->get_queue(), std::move(v), std::move(dst_),
                 std::move(cb_));
   };
 
-  void finish(finish_type f) override {
+  void finish(finish_type&& f) override {
     do_finish(this->get_queue(), std::move(f), std::move(dst_), std::move(cb_));
   };
 
-  static void do_fullfill(QueueT* q, fullfill_type v, dst_type dst, CbT cb) {
-    auto cb_args =
-        fullfill_to_finish<0, 0, std::tuple<expected<Ts>...>>(std::move(v));
-
-    do_finish(q, std::move(cb_args), std::move(dst), std::move(cb));
+  static void do_fullfill(QueueT* q, fullfill_type&& v, dst_type dst,
+                          CbT cb) {
+    do_finish(q, fullfill_to_finish<Ts...>(std::move(v)), std::move(dst),
+              std::move(cb));
   }
 
-  static void do_finish(QueueT* q, finish_type f, dst_type dst, CbT cb) {
-    enqueue(q, [cb = std::move(cb), dst = std::move(dst), f = std::move(f)] {
-      try {
-        if constexpr (std::is_same_v<void, cb_result_type>) {
-          std::apply(cb, std::move(f));
-          dst->fullfill(std::tuple<>{});
-        } else {
-          if constexpr (is_expected_v<cb_result_type>) {
-            dst->finish(std::apply(cb, std::move(f)));
-          } else {
-            dst->fullfill(std::apply(cb, std::move(f)));
-          }
-        }
-
-      } catch (...) {
-        dst->fail(std::current_exception());
-      }
+  static void do_finish(QueueT* q, finish_type&& f, dst_type dst, CbT cb) {
+    // No need to move the values into a task, use them where they are.
+    if (try_run_inline(q, [&] {
+          invoke(dst, [&] { return std::apply(cb, std::move(f)); });
+        })) {
+      return;
+    }
+
+    enqueue(q, [cb = std::move(cb), dst = std::move(dst),
+                f = std::move(f)]() mutable {
+      invoke(dst, [&] { return std::apply(cb, std::move(f)); });
     });
   }
 
   static void do_fail(QueueT* q, fail_type e, dst_type dst, CbT cb) {
-    auto cb_args = fail_to_expect<0, std::tuple<expected<Ts>...>>(e);
-    do_finish(q, std::move(cb_args), std::move(dst), std::move(cb));
+    do_finish(q, fail_to_expect<Ts...>(e), std::move(dst), std::move(cb));
   }
 
  private:
+  // Invokes the callback and assigns its result to dst.
+  template <typename InvokeT>
+  static void invoke(const dst_type& dst, InvokeT&& cb_invoke) {
+    try {
+      if constexpr (std::is_same_v<void, cb_result_type>) {
+        cb_invoke();
+        dst->fullfill(std::tuple<>{});
+      } else if constexpr (is_expected_v<cb_result_type>) {
+        dst->finish(cb_invoke());
+      } else {
+        dst->fullfill(cb_invoke());
+      }
+    } catch (...) {
+      dst->fail(std::current_exception());
+    }
+  }
+
   dst_type dst_;
   CbT cb_;
 };
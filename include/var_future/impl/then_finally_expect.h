@@ -38,29 +38,31 @@ class Future_finally_handler : public Future_handler_base<QueueT, void, Ts...> {
   Future_finally_handler(QueueT* q, CbT cb)
       : parent_type(q), cb_(std::move(cb)) {}
 
-  void fullfill(fullfill_type v) override {
+  void fullfill(fullfill_type&& v) override {
     do_fullfill(this->get_queue(), std::move(v), std::move(cb_));
   };
 
-  void finish(finish_type f) override {
+  void finish(finish_type&& f) override {
     do_finish(this->get_queue(), std::move(f), std::move(cb_));
   };
 
-  static void do_fullfill(QueueT* q, fullfill_type v, CbT cb) {
-    auto cb_args =
-        fullfill_to_finish<0, 0, std::tuple<expected<Ts>...>>(std::move(v));
-    do_finish(q, std::move(cb_args), std::move(cb));
+  static void do_fullfill(QueueT* q, fullfill_type&& v, CbT cb) {
+    do_finish(q, fullfill_to_finish<Ts...>(std::move(v)), std::move(cb));
   }
 
-  static void do_finish(QueueT* q, finish_type f, CbT cb) {
+  static void do_finish(QueueT* q, finish_type&& f, CbT cb) {
+    // No need to move the values into a task, use them where they are.
+    if (try_run_inline(q, [&] { std::apply(cb, std::move(f)); })) {
+      return;
+    }
+
     enqueue(q, [cb = std::move(cb), f = std::move(f)]() mutable {
       std::apply(cb, std::move(f));
     });
   }
 
   static void do_fail(QueueT* q, fail_type e, CbT cb) {
-    auto cb_args = fail_to_expect<0, std::tuple<expected<Ts>...>>(std::move(e));
-    do_finish(q, std::move(cb_args), std::move(cb));
+    do_finish(q, fail_to_expect<Ts...>(e), std::move(cb));
   }
 };
 }  // namespace detail
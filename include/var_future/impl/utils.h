@@ -17,7 +17,16 @@
 
 #include "var_future/config.h"
 
+#include <cassert>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
 #include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace aom {
 
@@ -46,6 +55,17 @@ struct is_expected<expected<T>> : public std::true_type {};
 template <typename T>
 constexpr bool is_expected_v = is_expected<T>::value;
 
+// Determines wether a callable can be invoked with the fields of a std::tuple
+template <typename CbT, typename TupleT>
+struct is_applicable : public std::false_type {};
+
+template <typename CbT, typename... Ts>
+struct is_applicable<CbT, std::tuple<Ts...>>
+    : public std::is_invocable<CbT, Ts...> {};
+
+template <typename CbT, typename TupleT>
+constexpr bool is_applicable_v = is_applicable<CbT, TupleT>::value;
+
 // Function: get_first_error()
 // Returns the first error in a set of expected<>, if any
 template <typename... Ts>
@@ -152,75 +172,244 @@ using finish_type_t = std::tuple<expected<Ts>...>;
 template <typename... Ts>
 using fail_type_t = std::exception_ptr;
 
+// Position, within fullfill_type_t<Ts...>, of the i'th field of Ts. Void
+// fields are skipped, so this is only meaningful for non-void fields.
 template <std::size_t i, typename... Ts>
-auto finish_to_fullfill(std::tuple<Ts...>&& src) {
-  (void)src;
-  assert(std::get<i>(src).has_value());
+constexpr std::size_t fullfill_index() {
+  constexpr bool is_void[] = {std::is_same_v<void, Ts>...};
+  std::size_t result = 0;
+  for (std::size_t k = 0; k < i; ++k) {
+    if (!is_void[k]) {
+      ++result;
+    }
+  }
+  return result;
+}
 
-  using val_t = typename std::tuple_element_t<i, std::tuple<Ts...>>::value_type;
-  if constexpr (std::is_same_v<void, val_t>) {
-    if constexpr (i == 0) {
-      return std::tuple<>();
-    } else {
-      return finish_to_fullfill<i - 1>(std::move(src));
+// Position, within Ts, of the j'th field of fullfill_type_t<Ts...>.
+template <std::size_t j, typename... Ts>
+constexpr std::size_t finish_index() {
+  constexpr bool is_void[] = {std::is_same_v<void, Ts>...};
+  std::size_t remaining = j;
+  std::size_t result = 0;
+  while (is_void[result] || remaining != 0) {
+    if (!is_void[result]) {
+      --remaining;
     }
+    ++result;
+  }
+  return result;
+}
+
+// The conversions below build their result in a single pass: Every element is
+// moved exactly once, straight from the source tuple into the destination.
+template <typename... Ts, std::size_t... Is>
+fullfill_type_t<Ts...> finish_to_fullfill_impl(finish_type_t<Ts...>& src,
+                                               std::index_sequence<Is...>) {
+  (void)src;
+  return fullfill_type_t<Ts...>(
+      std::move(*std::get<finish_index<Is, Ts...>()>(src))...);
+}
+
+template <typename... Ts>
+fullfill_type_t<Ts...> finish_to_fullfill(finish_type_t<Ts...>&& src) {
+  assert(!std::apply(get_first_error<Ts...>, src));
+  constexpr std::size_t count = std::tuple_size_v<fullfill_type_t<Ts...>>;
+  return finish_to_fullfill_impl<Ts...>(src, std::make_index_sequence<count>());
+}
+
+template <std::size_t i, typename... Ts>
+decltype(auto) fullfill_to_finish_field(fullfill_type_t<Ts...>& src) {
+  (void)src;
+  using field_t = std::tuple_element_t<i, std::tuple<Ts...>>;
+  if constexpr (std::is_same_v<void, field_t>) {
+    return expected<void>();
   } else {
-    auto val_tup = std::tuple<val_t>(std::move(*std::get<i>(src)));
-    if constexpr (i == 0) {
-      return val_tup;
-    } else {
-      return std::tuple_cat(finish_to_fullfill<i - 1>(std::move(src)),
-                            std::move(val_tup));
-    }
+    return std::move(std::get<fullfill_index<i, Ts...>()>(src));
   }
 }
 
-template <std::size_t i, std::size_t j, typename Result_t, typename... Ts>
-auto fullfill_to_finish(std::tuple<Ts...>&& src) {
+template <typename... Ts, std::size_t... Is>
+finish_type_t<Ts...> fullfill_to_finish_impl(fullfill_type_t<Ts...>& src,
+                                             std::index_sequence<Is...>) {
+  return finish_type_t<Ts...>(fullfill_to_finish_field<Is, Ts...>(src)...);
+}
+
+template <typename... Ts>
+finish_type_t<Ts...> fullfill_to_finish(fullfill_type_t<Ts...>&& src) {
+  return fullfill_to_finish_impl<Ts...>(src, std::index_sequence_for<Ts...>());
+}
+
+// Invokes cb with the values of a successful finish_type_t<Ts...>, without
+// going through an intermediate fullfill_type_t<Ts...>.
+template <typename... Ts, typename CbT, std::size_t... Is>
+decltype(auto) apply_finish_impl(CbT& cb, finish_type_t<Ts...>& src,
+                                 std::index_sequence<Is...>) {
   (void)src;
-  using dst_t = std::tuple_element_t<i, Result_t>;
-  if constexpr (std::is_same_v<expected<void>, dst_t>) {
-    if constexpr (i == std::tuple_size_v<Result_t> - 1) {
-      return std::tuple<expected<void>>();
-    } else {
-      return std::tuple_cat(
-          std::tuple<expected<void>>(),
-          fullfill_to_finish<i + 1, j, Result_t>(std::move(src)));
+  return std::invoke(cb,
+                     std::move(*std::get<finish_index<Is, Ts...>()>(src))...);
+}
+
+template <typename... Ts, typename CbT>
+decltype(auto) apply_finish(CbT& cb, finish_type_t<Ts...>&& src) {
+  assert(!std::apply(get_first_error<Ts...>, src));
+  constexpr std::size_t count = std::tuple_size_v<fullfill_type_t<Ts...>>;
+  return apply_finish_impl<Ts...>(cb, src, std::make_index_sequence<count>());
+}
+
+template <typename... Ts>
+finish_type_t<Ts...> fail_to_expect(const std::exception_ptr& src) {
+  return finish_type_t<Ts...>(expected<Ts>(unexpected{src})...);
+}
+
+// Type-erased callable, like std::function, that also accepts move-only
+// callables. It is move-only itself as a result.
+template <typename Sig>
+class Unique_function;
+
+template <typename R, typename... Args>
+class Unique_function<R(Args...)> {
+ public:
+  Unique_function() = default;
+
+  template <typename F, typename = std::enable_if_t<!std::is_same_v<
+                            std::decay_t<F>, Unique_function>>>
+  Unique_function(F&& f)
+      : impl_(std::make_unique<Impl<std::decay_t<F>>>(std::forward<F>(f))) {}
+
+  R operator()(Args... args) { return impl_->call(std::forward<Args>(args)...); }
+
+  explicit operator bool() const { return impl_ != nullptr; }
+
+ private:
+  struct Impl_base {
+    virtual ~Impl_base() = default;
+    virtual R call(Args&&... args) = 0;
+  };
+
+  template <typename F>
+  struct Impl : public Impl_base {
+    explicit Impl(F f) : f_(std::move(f)) {}
+    R call(Args&&... args) override {
+      return std::invoke(f_, std::forward<Args>(args)...);
     }
-  } else {
-    using val_t = expected<std::tuple_element_t<j, std::tuple<Ts...>>>;
-    std::tuple<val_t> tup_val(std::move(std::get<j>(src)));
 
-    if constexpr (i == std::tuple_size_v<Result_t> - 1) {
-      return tup_val;
-    } else {
-      auto recur = fullfill_to_finish<i + 1, j + 1, Result_t>(std::move(src));
-      return std::tuple_cat(tup_val, recur);
+    F f_;
+  };
+
+  std::unique_ptr<Impl_base> impl_;
+};
+
+// Bounds the stack usage of continuations that are executed immediately.
+//
+// Completing a future runs its immediate continuation inline, which completes
+// the next future, and so on. Past AOM_VARFUT_MAX_INLINE_DEPTH nested
+// continuations, tasks are instead deferred to a thread-local queue that is
+// drained by the outermost one before it returns.
+class Trampoline {
+ public:
+  // Runs f inline, unless the depth budget is exhausted.
+  template <typename F>
+  static bool try_run_inline(F&& f) {
+    auto& self = instance();
+    if (self.depth_ >= AOM_VARFUT_MAX_INLINE_DEPTH) {
+      return false;
+    }
+
+    Frame frame(self);
+    if (self.depth_ != 1) {
+      f();
+      return true;
+    }
+
+    // Deferred tasks own the storage of the futures they complete, so they
+    // all run even if one of them, or f, throws. The first exception wins.
+    try {
+      f();
+    } catch (...) {
+      self.drain();
+      throw;
+    }
+
+    if (auto error = self.drain()) {
+      std::rethrow_exception(error);
     }
+    return true;
   }
-}
 
-template <std::size_t i, typename T>
-auto fail_to_expect(const std::exception_ptr& src) {
-  (void)src;
-  using element_t = std::tuple_element_t<i, T>;
-  std::tuple<element_t> val_tup(unexpected{src});
+  template <typename F>
+  static void defer(F&& f) {
+    assert(instance().depth_ != 0);
+    instance().deferred_.push_back(
+        std::make_unique<Task<std::decay_t<F>>>(std::forward<F>(f)));
+  }
 
-  if constexpr (i >= std::tuple_size_v<T> - 1) {
-    return val_tup;
-  } else {
-    return std::tuple_cat(val_tup, fail_to_expect<i + 1, T>(src));
+ private:
+  struct Task_base {
+    virtual ~Task_base() = default;
+    virtual void run() = 0;
+  };
+
+  template <typename F>
+  struct Task : public Task_base {
+    explicit Task(F f) : f_(std::move(f)) {}
+    void run() override { f_(); }
+
+    F f_;
+  };
+
+  struct Frame {
+    explicit Frame(Trampoline& t) : t_(t) { ++t_.depth_; }
+    ~Frame() { --t_.depth_; }
+
+    Trampoline& t_;
+  };
+
+  static Trampoline& instance() {
+    static thread_local Trampoline result;
+    return result;
   }
-}
+
+  // Runs every deferred task, and returns the first exception they threw.
+  std::exception_ptr drain() {
+    std::exception_ptr error;
+    while (!deferred_.empty()) {
+      // Tasks deferred while running this batch go in the next one.
+      auto batch = std::move(deferred_);
+      deferred_.clear();
+      for (auto& task : batch) {
+        try {
+          task->run();
+        } catch (...) {
+          if (!error) {
+            error = std::current_exception();
+          }
+        }
+      }
+    }
+    return error;
+  }
+
+  std::size_t depth_ = 0;
+
+  // Not a std::deque, since that would allocate on every thread that
+  // touches the trampoline.
+  std::vector<std::unique_ptr<Task_base>> deferred_;
+};
 
 // A special Immediate queue tag type
 struct Immediate_queue {
   template <typename F>
   static void push(F&& f) {
-    f();
+    if (!Trampoline::try_run_inline(f)) {
+      Trampoline::defer(std::forward<F>(f));
+    }
   }
 };
 
+template <typename T>
+constexpr bool is_immediate_queue_v = std::is_same_v<Immediate_queue, T>;
+
 inline void no_op_test() {}
 
 // Determines wether T's duck-typed push() method is static.
@@ -247,6 +436,83 @@ std::enable_if_t<has_static_push_v<Q>> enqueue(Q*, F&& f) {
   Q::push(std::forward<F>(f));
 }
 
+// Determines wether T has a duck-typed push_bulk(first, last) method, which
+// pushes every callable in the iterator range [first, last) at once.
+template <typename T, typename = void>
+struct has_push_bulk : std::false_type {};
+
+template <typename T>
+struct has_push_bulk<T, decltype(void(std::declval<T&>().push_bulk(
+                            std::declval<void (**)()>(),
+                            std::declval<void (**)()>())))> : std::true_type {
+};
+
+template <typename T>
+constexpr bool has_push_bulk_v = has_push_bulk<T>::value;
+
+// enqueue_bulk(), enqueues every callable in [first, last), moving them out
+// of the range. Uses q's push_bulk() if there is one.
+//
+// If Q has a static push method, push_bulk() must be static as well.
+template <typename Q, typename ItT>
+void enqueue_bulk(Q* q, ItT first, ItT last) {
+  (void)q;
+  if constexpr (has_push_bulk_v<Q> && has_static_push_v<Q>) {
+    Q::push_bulk(std::make_move_iterator(first), std::make_move_iterator(last));
+  } else if constexpr (has_push_bulk_v<Q>) {
+    q->push_bulk(std::make_move_iterator(first), std::make_move_iterator(last));
+  } else {
+    for (; first != last; ++first) {
+      enqueue(q, std::move(*first));
+    }
+  }
+}
+
+// Determines wether T has a duck-typed running_in_this_thread() method, which
+// returns true when invoked from a thread that executes T's tasks.
+template <typename T, typename = void>
+struct has_running_in_this_thread : std::false_type {};
+
+template <typename T>
+struct has_running_in_this_thread<
+    T, decltype(void(bool(std::declval<T&>().running_in_this_thread())))>
+    : std::true_type {};
+
+template <typename T>
+constexpr bool has_running_in_this_thread_v =
+    has_running_in_this_thread<T>::value;
+
+// Runs f right away if pushing it in q would be equivalent, and the inline
+// depth budget allows it. Returns wether f was run.
+//
+// If Q has a static push method, running_in_this_thread() must be static as
+// well, since q is ignored.
+template <typename Q, typename F>
+bool try_run_inline(Q* q, F&& f) {
+  (void)q;
+  if constexpr (is_immediate_queue_v<Q>) {
+    return Trampoline::try_run_inline(f);
+  } else if constexpr (has_running_in_this_thread_v<Q>) {
+    bool on_queue;
+    if constexpr (has_static_push_v<Q>) {
+      on_queue = Q::running_in_this_thread();
+    } else {
+      on_queue = q->running_in_this_thread();
+    }
+    return on_queue && Trampoline::try_run_inline(f);
+  } else {
+    return false;
+  }
+}
+
+// Either runs f inline as per try_run_inline(), or enqueues it.
+template <typename Q, typename F>
+void dispatch(Q* q, F&& f) {
+  if (!try_run_inline(q, f)) {
+    enqueue(q, std::forward<F>(f));
+  }
+}
+
 }  // namespace detail
 }  // namespace aom
 #endif
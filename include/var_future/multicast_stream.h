@@ -0,0 +1,111 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_MULTICAST_STREAM_INCLUDED_H
+#define AOM_VARIADIC_MULTICAST_STREAM_INCLUDED_H
+
+/// \file
+/// Streams that can be consumed by any number of subscribers.
+
+#include "var_future/config.h"
+
+#include "var_future/stream_future.h"
+
+#include <cstddef>
+#include <memory>
+
+namespace aom {
+
+namespace detail {
+template <typename Alloc, typename... Ts>
+class Multicast_state;
+}  // namespace detail
+
+/**
+ * @brief Shares the values of a stream between any number of subscribers.
+ *
+ * Every value is stored once, in a reference counted slot, and handed to each
+ * subscriber by const reference. Each subscriber advances through the values
+ * at its own pace, and a slot is reclaimed as soon as every subscriber has
+ * moved past it, and it has left the replay history.
+ *
+ * Subscribers can be attached at any time, including after the source has
+ * ended. They first receive up to history of the most recent values, and then
+ * every new one. A slow subscriber retains the values it has not seen yet.
+ * A subscriber leaves once its callback returns false, if it returns a bool,
+ * or throws.
+ *
+ * Copies of a Basic_multicast_stream share the same subscribers and history.
+ *
+ * @tparam Alloc The rebindable allocator to use.
+ * @tparam Ts The types making up the stream's fields.
+ */
+template <typename Alloc, typename... Ts>
+class Basic_multicast_stream {
+ public:
+  /**
+   * @brief Takes over a stream.
+   *
+   * @param source The stream to share.
+   * @param history How many of the most recent values are replayed to new
+   *                subscribers.
+   */
+  explicit Basic_multicast_stream(Basic_stream_future<Alloc, Ts...> source,
+                                  std::size_t history = 0);
+
+  /**
+   * @brief Invokes a callback on each value wherever it is produced.
+   *
+   * Replayed values are delivered from the subscribing thread.
+   *
+   * @param cb Callable invoked with const references to the fields of each
+   *           value. If it returns a bool, false unsubscribes.
+   * @return Basic_future<Alloc, void> A future that will be completed at the
+   *                                   end of the stream or once cb returns
+   *                                   false, or failed if the stream or cb
+   *                                   fails.
+   */
+  template <typename CbT>
+  [[nodiscard]] Basic_future<Alloc, void> subscribe(CbT&& cb);
+
+  /**
+   * @brief Posts the delivery of values to a queue.
+   *
+   * Values are delivered to a given subscriber one at a time and in order,
+   * from tasks that each handle every value available at the time they run.
+   *
+   * @param queue The queue on which cb will be invoked.
+   * @param cb Callable invoked with const references to the fields of each
+   *           value. If it returns a bool, false unsubscribes.
+   * @return Basic_future<Alloc, void> A future that will be completed at the
+   *                                   end of the stream or once cb returns
+   *                                   false, or failed if the stream or cb
+   *                                   fails.
+   */
+  template <typename QueueT, typename CbT>
+  [[nodiscard]] Basic_future<Alloc, void> subscribe(QueueT& queue, CbT&& cb);
+
+ private:
+  using state_type = detail::Multicast_state<Alloc, Ts...>;
+
+  std::shared_ptr<state_type> state_;
+};
+
+template <typename... Ts>
+using Multicast_stream = Basic_multicast_stream<std::allocator<void>, Ts...>;
+}  // namespace aom
+
+#include "var_future/impl/stream/multicast.h"
+
+#endif
@@ -0,0 +1,142 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_PRIORITY_QUEUE_INCLUDED_H
+#define AOM_VARIADIC_PRIORITY_QUEUE_INCLUDED_H
+
+/// \file
+/// Multi-level work queue.
+
+#include "var_future/config.h"
+#include "var_future/impl/utils.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace aom {
+
+/**
+ * @brief Thread-safe work queue with multiple priority levels.
+ *
+ * Level 0 has the highest priority. Tasks are normally executed from the
+ * highest non-empty level, but a non-empty level that has been passed over
+ * aging_threshold times in a row is served next, so that lower priority
+ * tasks cannot be starved.
+ *
+ * The queue does not own any thread, workers call run_one() or try_run_one().
+ */
+class Priority_queue {
+ public:
+  using task_type = detail::Unique_function<void()>;
+
+  /**
+   * @brief A view of the queue that pushes at a given priority.
+   *
+   * It can be used as a queue for then(), async(), etc...
+   */
+  class Level {
+   public:
+    template <typename F>
+    void push(F&& f);
+
+    std::size_t priority() const { return priority_; }
+
+   private:
+    friend class Priority_queue;
+
+    Level(Priority_queue* owner, std::size_t priority)
+        : owner_(owner), priority_(priority) {}
+
+    Priority_queue* owner_;
+    std::size_t priority_;
+  };
+
+  /**
+   * @param levels The number of priority levels.
+   * @param aging_threshold How many times in a row a non-empty level can be
+   *                        passed over in favor of a higher priority one.
+   */
+  explicit Priority_queue(std::size_t levels = 3,
+                          std::size_t aging_threshold = 16);
+
+  /**
+   * @brief Gets the view of the queue that pushes tasks at priority p.
+   *
+   * @pre p < levels()
+   */
+  Level& with_priority(std::size_t p);
+
+  /**
+   * @brief Pushes a task with the default priority, which is levels() / 2.
+   */
+  template <typename F>
+  void push(F&& f);
+
+  /**
+   * @brief Executes the next task, if any.
+   *
+   * @return wether a task was executed.
+   */
+  bool try_run_one();
+
+  /**
+   * @brief Waits for a task and executes it.
+   *
+   * @return false if the queue was stopped before a task became available.
+   */
+  bool run_one();
+
+  /**
+   * @brief Wakes up every worker blocked in run_one().
+   *
+   * Tasks that are still queued can be executed with try_run_one().
+   */
+  void stop();
+
+  std::size_t levels() const { return levels_.size(); }
+
+  /**
+   * @brief The number of queued tasks.
+   */
+  std::size_t size() const;
+
+ private:
+  struct Level_data {
+    std::deque<task_type> tasks;
+    std::size_t skipped = 0;
+  };
+
+  void push_at(std::size_t p, task_type task);
+
+  // Pops the next task as per priorities and aging. mtx_ must be held.
+  task_type pop_next();
+
+  std::vector<std::unique_ptr<Level>> views_;
+  std::vector<Level_data> levels_;
+  std::size_t aging_threshold_;
+  std::size_t size_ = 0;
+  bool stopped_ = false;
+
+  mutable std::mutex mtx_;
+  std::condition_variable cv_;
+};
+}  // namespace aom
+
+#include "var_future/impl/queues/priority_queue.h"
+
+#endif
@@ -0,0 +1,95 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_RETRY_INCLUDED_H
+#define AOM_VARIADIC_RETRY_INCLUDED_H
+
+/// \file
+/// Retrying asynchronous operations with exponential backoff.
+
+#include "var_future/config.h"
+
+#include "var_future/future.h"
+
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <functional>
+
+namespace aom {
+
+/**
+ * @brief Determines when, and how many times, retry() tries again.
+ */
+struct Retry_policy {
+  using duration = std::chrono::steady_clock::duration;
+
+  /// Total number of attempts, including the first one.
+  std::size_t max_attempts = 3;
+
+  /// Delay before the first retry.
+  duration initial_delay = std::chrono::milliseconds(100);
+
+  /// Growth factor of the delay between consecutive retries.
+  double multiplier = 2.0;
+
+  /// Upper bound of the delay, before jitter is applied.
+  duration max_delay = std::chrono::seconds(10);
+
+  /// Fraction, in [0, 1], of each delay that is randomized.
+  double jitter = 0.2;
+
+  /// Decides if a given error is transient. Every error is retried if empty.
+  /// If it throws, the retried operation fails with that exception instead.
+  std::function<bool(const std::exception_ptr&)> retry_if;
+
+  /**
+   * @brief The delay to wait after the given failed attempt.
+   *
+   * @param attempt The number of attempts made so far, starting at 1.
+   * @param r A random number in [0, 1), used to apply jitter.
+   */
+  duration delay(std::size_t attempt, double r) const;
+};
+
+/**
+ * @brief Invokes factory from queue, and invokes it again after a delay for as
+ *        long as the future it returns fails, as dictated by policy.
+ *
+ * The returned future is finished with the result of the last attempt. Its
+ * storage, and the retry bookkeeping, are allocated once regardless of the
+ * number of attempts.
+ *
+ * @param queue The queue factory is invoked from.
+ * @param timer Anything with a `schedule(duration, task)` method that invokes
+ *              `task()` once `duration` has elapsed. If it throws, the
+ *              returned future fails with that exception.
+ * @param policy
+ * @param factory Callable returning a Basic_future. It may also throw.
+ */
+template <typename QueueT, typename TimerT, typename FactoryT>
+auto retry(QueueT& queue, TimerT& timer, Retry_policy policy,
+           FactoryT&& factory);
+
+/**
+ * @brief retry(), with a custom allocator.
+ */
+template <typename QueueT, typename TimerT, typename Alloc, typename FactoryT>
+auto retry(QueueT& queue, TimerT& timer, Retry_policy policy,
+           const Alloc& alloc, FactoryT&& factory);
+}  // namespace aom
+
+#include "var_future/impl/retry.h"
+
+#endif
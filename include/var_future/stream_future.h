@@ -22,15 +22,43 @@
 
 #include "var_future/future.h"
 
+#include "var_future/impl/stream/stages.h"
 #include "var_future/impl/stream/stream_storage_decl.h"
 
+#include <chrono>
+#include <cstddef>
 #include <memory>
+#include <optional>
+#include <tuple>
+#include <vector>
 
 namespace aom {
 
 template <typename Alloc, typename... Ts>
 class Basic_stream_promise;
 
+template <typename Alloc, typename StagesT, typename... Ts>
+class Basic_stream_pipeline;
+
+template <typename Alloc, typename... Ts>
+class Basic_stream_iterator;
+
+namespace detail {
+template <typename Alloc, typename... Ts>
+class Stream_pull_handler;
+}  // namespace detail
+
+/**
+ * @brief How map_async() emits its results.
+ */
+enum class Stream_order {
+  /// Results are emitted in the order of the values they were computed from.
+  ordered,
+
+  /// Results are emitted as soon as they are computed.
+  unordered
+};
+
 /**
  * @brief Represents a stream of values that will be eventually available.
  *
@@ -89,14 +117,369 @@ class Basic_stream_future {
   template <typename QueueT, typename CbT>
   [[nodiscard]] Basic_future<Alloc, void> for_each(QueueT& queue, CbT&& cb);
 
+  /**
+   * @brief Transforms each value of the stream.
+   *
+   * Transformations are not applied until a terminal operation, such as
+   * for_each(), is invoked on the returned pipeline. The stages of a pipeline
+   * all run from a single handler, where the values are pushed.
+   *
+   * @param cb Callable invoked with the fields of each value, returning the
+   *           new value.
+   */
+  template <typename CbT>
+  auto map(CbT&& cb);
+
+  /**
+   * @brief Only keeps the values for which pred returns true.
+   */
+  template <typename PredT>
+  auto filter(PredT&& pred);
+
+  /**
+   * @brief Ends the stream after its first n values.
+   *
+   * The resulting stream completes as soon as the n'th value has been seen,
+   * and ignores whatever the producer does afterwards.
+   */
+  auto take(std::size_t n);
+
+  /**
+   * @brief Produces the successive values of acc = op(acc, values...).
+   */
+  template <typename AccT, typename OpT>
+  auto scan(AccT init, OpT&& op);
+
+  /**
+   * @brief Invokes cb from queue for up to max_in_flight values concurrently,
+   *        and produces a stream of the results.
+   *
+   * Values that arrive while max_in_flight callbacks are pending wait for one
+   * of them to finish. If cb throws, the resulting stream fails right away.
+   *
+   * @param queue cb will be posted to that queue
+   * @param max_in_flight The maximum number of concurrent invocations of cb.
+   * @param cb Callable invoked with the fields of each value. It may be invoked
+   *           concurrently.
+   * @param order Wether results must be emitted in the order of their values.
+   * @return Basic_stream_future<Alloc, R> The stream of cb's results.
+   */
+  template <typename QueueT, typename CbT>
+  auto map_async(QueueT& queue, std::size_t max_in_flight, CbT&& cb,
+                 Stream_order order = Stream_order::ordered);
+
+  /**
+   * @brief Gathers the values of the stream into one batch per period.
+   *
+   * Every period, the values pushed since the previous batch are emitted as
+   * a single vector, from the timer's thread. Periods that saw no values
+   * produce no batch. Once the source ends, the values that are left are
+   * emitted right away, and the resulting stream ends the same way.
+   *
+   * @param timer Anything with a `schedule(duration, task)` method that invokes
+   *              `task()` once `duration` has elapsed. A single timer can
+   *              drive any number of streams.
+   * @param period The duration of each window.
+   * @return Basic_stream_future<Alloc, std::vector<T>> where T is the type of
+   *         the single field, or a std::tuple of the fields.
+   */
+  template <typename TimerT>
+  auto window(TimerT& timer, std::chrono::steady_clock::duration period);
+
+  /**
+   * @brief Lets a value through, and then ignores values until period has
+   *        elapsed.
+   *
+   * Unlike window() and sample(), nothing is emitted from the timer: values
+   * that are let through are forwarded where they are pushed.
+   *
+   * @param timer Anything with a `schedule(duration, task)` method that invokes
+   *              `task()` once `duration` has elapsed.
+   * @param period How long values are ignored after one is let through.
+   */
+  template <typename TimerT>
+  auto throttle(TimerT& timer, std::chrono::steady_clock::duration period);
+
+  /**
+   * @brief Emits the most recent value of the stream once per period.
+   *
+   * Values are emitted from the timer's thread, and only if a new one was
+   * pushed since the previous period. Once the source ends, the value that
+   * was not emitted yet, if any, is emitted right away, and the resulting
+   * stream ends the same way.
+   *
+   * @param timer Anything with a `schedule(duration, task)` method that invokes
+   *              `task()` once `duration` has elapsed. A single timer can
+   *              drive any number of streams.
+   * @param period The duration between samples.
+   * @return Basic_stream_future<Alloc, Fields...> where Fields are the fields
+   *         of the stream.
+   */
+  template <typename TimerT>
+  auto sample(TimerT& timer, std::chrono::steady_clock::duration period);
+
+  /**
+   * @brief Folds the stream into a single value, from a queue that may run
+   *        its tasks concurrently.
+   *
+   * Each thread running the tasks folds values into its own partial
+   * accumulator, starting from a copy of init, using acc = op(acc, values...).
+   * Once the stream has completed and every task has run, the partials are
+   * combined with acc = combine(acc, partial), starting from init.
+   *
+   * Since init is used to seed every partial accumulator, it must be an
+   * identity of combine, and the result must not depend on how the values
+   * are split between threads.
+   *
+   * @param queue op will be posted to that queue
+   * @param init The identity value of the accumulator.
+   * @param op Callable invoked with a partial accumulator and the fields of a
+   *           value, returning the new accumulator.
+   * @param combine Callable invoked with two accumulators, returning their
+   *                combination.
+   * @return Basic_future<Alloc, AccT> The combined accumulator.
+   */
+  template <typename QueueT, typename AccT, typename OpT, typename CombineT>
+  [[nodiscard]] Basic_future<Alloc, AccT> reduce(QueueT& queue, AccT init,
+                                                 OpT&& op, CombineT&& combine);
+
+  /**
+   * @brief Gathers every value of the stream in a vector.
+   *
+   * Values are gathered in chunks of doubling sizes as they are pushed, and
+   * only moved once, to a vector of the right size, when the stream
+   * completes.
+   *
+   * @return Basic_future<Alloc, std::vector<T>> where T is the type of the
+   *         single field, or a std::tuple of the fields.
+   */
+  [[nodiscard]] auto collect();
+
+  /**
+   * @brief Consumes the stream by pulling values one at a time.
+   *
+   * The producer can observe how many values are awaited through
+   * Basic_stream_promise::demand() and when_demanded(), and only produce
+   * them as fast as they are consumed.
+   */
+  [[nodiscard]] Basic_stream_iterator<Alloc, Ts...> begin_async();
+
+  /**
+   * @brief Get the allocator associated with this stream.
+   *
+   * @pre The stream must have shared storage associated with it.
+   *
+   * @return Alloc&
+   */
+  Alloc& allocator();
+
  private:
   template <typename SubAlloc, typename... Us>
   friend class Basic_stream_promise;
 
+  Basic_stream_pipeline<Alloc, std::tuple<>, Ts...> as_pipeline();
+
   explicit Basic_stream_future(detail::Storage_ptr<storage_type> s);
   detail::Storage_ptr<storage_type> storage_;
 };
 
+/**
+ * @brief Pulls values out of a stream, one future at a time.
+ *
+ * Values that the producer pushes ahead of requests are buffered, and handed
+ * out by the following calls to next(). The futures returned by next() share
+ * a single storage, which is reused as long as the previous one has been
+ * consumed by the time next() is invoked again.
+ *
+ * Once the iterator is destroyed, the values that are still pushed are
+ * dropped, and the demand seen by the producer becomes unbounded.
+ *
+ * @tparam Alloc The rebindable allocator to use.
+ * @tparam Ts The types making up the stream fields.
+ */
+template <typename Alloc, typename... Ts>
+class Basic_stream_iterator {
+ public:
+  /// A value of the stream, or std::nullopt at its end.
+  using value_type = std::optional<std::tuple<Ts...>>;
+  using future_type = Basic_future<Alloc, value_type>;
+
+  Basic_stream_iterator(Basic_stream_iterator&&) = default;
+  Basic_stream_iterator& operator=(Basic_stream_iterator&&);
+  ~Basic_stream_iterator();
+
+  /**
+   * @brief Gets the next value of the stream.
+   *
+   * Past the end of the stream, every call produces std::nullopt, or the
+   * error the stream failed with.
+   *
+   * @pre The future returned by the previous call must be finished.
+   */
+  [[nodiscard]] future_type next();
+
+  /**
+   * @brief Lets the producer know that n values will be requested ahead of
+   *        the calls to next() that retrieve them.
+   */
+  void request(std::size_t n);
+
+ private:
+  using storage_type = detail::Stream_storage<Alloc, Ts...>;
+  using handler_type = detail::Stream_pull_handler<Alloc, Ts...>;
+  using dst_storage_type = typename future_type::storage_type;
+
+  template <typename SubAlloc, typename... Us>
+  friend class Basic_stream_future;
+
+  explicit Basic_stream_iterator(detail::Storage_ptr<storage_type> s);
+
+  handler_type* handler() const;
+
+  detail::Storage_ptr<storage_type> storage_;
+  detail::Storage_ptr<dst_storage_type> spare_;
+};
+
+template <typename... Ts>
+using Stream_iterator = Basic_stream_iterator<std::allocator<void>, Ts...>;
+
+/**
+ * @brief Interleaves the values of multiple streams of the same type.
+ *
+ * The resulting stream completes once every source has completed, and fails
+ * as soon as any of them fails. Values from a given source keep their order.
+ */
+template <typename Alloc, typename... Ts, typename... RestT>
+Basic_stream_future<Alloc, Ts...> merge(Basic_stream_future<Alloc, Ts...> first,
+                                        RestT... rest);
+
+/**
+ * @brief Pairs the values of multiple streams by index.
+ *
+ * The i'th value of the resulting stream is made of the fields of the i'th
+ * value of every source, in order. It completes as soon as one of the sources
+ * has completed and every one of its values were paired, and fails as soon as
+ * any of them fails.
+ *
+ * @return Basic_stream_future<Alloc, Fields...> where Fields are the fields
+ *         of all the sources.
+ */
+template <typename Alloc, typename... Ts, typename... RestT>
+auto zip(Basic_stream_future<Alloc, Ts...> first, RestT... rest);
+
+/**
+ * @brief A stream future with transformations applied to it.
+ *
+ * Created by Basic_stream_future::map(), filter(), take(), scan() and
+ * throttle(). The transformations are fused into the handler that is
+ * installed by the terminal operation, so a pipeline costs a single virtual
+ * call per value, no matter how many stages it has.
+ *
+ * @tparam Alloc The rebindable allocator to use.
+ * @tparam StagesT std::tuple of the transformations.
+ * @tparam Ts The types making up the source stream's fields.
+ */
+template <typename Alloc, typename StagesT, typename... Ts>
+class Basic_stream_pipeline {
+ public:
+  using storage_type = detail::Stream_storage<Alloc, Ts...>;
+
+  /// std::tuple of the types making up the transformed stream's fields.
+  using output_type =
+      detail::Stream_stages_output_t<StagesT, std::tuple<Ts...>>;
+
+  Basic_stream_pipeline(Basic_stream_pipeline&&) = default;
+  Basic_stream_pipeline& operator=(Basic_stream_pipeline&&) = default;
+
+  /**
+   * @brief Basic_stream_future::map()
+   */
+  template <typename CbT>
+  auto map(CbT&& cb);
+
+  /**
+   * @brief Basic_stream_future::filter()
+   */
+  template <typename PredT>
+  auto filter(PredT&& pred);
+
+  /**
+   * @brief Basic_stream_future::take()
+   */
+  auto take(std::size_t n);
+
+  /**
+   * @brief Basic_stream_future::scan()
+   */
+  template <typename AccT, typename OpT>
+  auto scan(AccT init, OpT&& op);
+
+  /**
+   * @brief Basic_stream_future::map_async()
+   */
+  template <typename QueueT, typename CbT>
+  auto map_async(QueueT& queue, std::size_t max_in_flight, CbT&& cb,
+                 Stream_order order = Stream_order::ordered);
+
+  /**
+   * @brief Basic_stream_future::window()
+   */
+  template <typename TimerT>
+  auto window(TimerT& timer, std::chrono::steady_clock::duration period);
+
+  /**
+   * @brief Basic_stream_future::throttle()
+   */
+  template <typename TimerT>
+  auto throttle(TimerT& timer, std::chrono::steady_clock::duration period);
+
+  /**
+   * @brief Basic_stream_future::sample()
+   */
+  template <typename TimerT>
+  auto sample(TimerT& timer, std::chrono::steady_clock::duration period);
+
+  /**
+   * @brief Invokes a callback on each transformed value.
+   */
+  template <typename CbT>
+  [[nodiscard]] Basic_future<Alloc, void> for_each(CbT&& cb);
+
+  /**
+   * @brief Posts the execution of a callback to a queue for each transformed
+   *        value.
+   */
+  template <typename QueueT, typename CbT>
+  [[nodiscard]] Basic_future<Alloc, void> for_each(QueueT& queue, CbT&& cb);
+
+  /**
+   * @brief Basic_stream_future::reduce()
+   */
+  template <typename QueueT, typename AccT, typename OpT, typename CombineT>
+  [[nodiscard]] Basic_future<Alloc, AccT> reduce(QueueT& queue, AccT init,
+                                                 OpT&& op, CombineT&& combine);
+
+  /**
+   * @brief Basic_stream_future::collect()
+   */
+  [[nodiscard]] auto collect();
+
+ private:
+  template <typename SubAlloc, typename SubStagesT, typename... Us>
+  friend class Basic_stream_pipeline;
+
+  template <typename SubAlloc, typename... Us>
+  friend class Basic_stream_future;
+
+  Basic_stream_pipeline(detail::Storage_ptr<storage_type> s, StagesT stages);
+
+  template <typename StageT>
+  auto then_stage(StageT stage);
+
+  detail::Storage_ptr<storage_type> storage_;
+  StagesT stages_;
+};
+
 /**
  * @brief Basic_stream_future with default allocator.
  *
@@ -172,6 +555,46 @@ class Basic_stream_promise {
    */
   void set_exception(fail_type);
 
+  /**
+   * @brief How many values the consumer is waiting for.
+   *
+   * 0 until the future is consumed. Consumers that use for_each() accept
+   * values as fast as they come, which is reported as
+   * std::numeric_limits<std::size_t>::max().
+   */
+  std::size_t demand() const;
+
+  /**
+   * @brief Obtains a future that is fullfilled as soon as demand() is not 0.
+   *
+   * Producers that wait for it before every push generate values only as
+   * fast as they are consumed.
+   *
+   * @pre Only one such future may be pending at a time.
+   */
+  Basic_future<Alloc, void> when_demanded();
+
+  /**
+   * @brief Bounds the memory used by values that are pushed before the
+   *        future is consumed.
+   *
+   * Once threshold values are waiting for a consumer, they are appended to
+   * an anonymous temporary file, and the following ones are as well,
+   * threshold at a time. The spilled values are read back sequentially, in
+   * order, as soon as a consumer is attached. If the file cannot be created
+   * or written to, values simply remain in memory. If it cannot be read
+   * back, the consumer fails with a std::system_error, and the values pushed
+   * from then on are ignored.
+   *
+   * Only available for streams of trivially copyable, default constructible
+   * types, since values are spilled as raw bytes.
+   *
+   * @pre get_future() must have been invoked.
+   *
+   * @param threshold How many values may be held in memory.
+   */
+  void spill_to_disk(std::size_t threshold);
+
   /**
    * @brief returns wether the promise still refers to an uncompleted future
    *
@@ -196,8 +619,14 @@ template <typename... Ts>
 using Stream_promise = Basic_stream_promise<std::allocator<void>, Ts...>;
 }  // namespace aom
 
+#include "var_future/impl/stream/combine.h"
+#include "var_future/impl/stream/map_async.h"
+#include "var_future/impl/stream/pipeline.h"
+#include "var_future/impl/stream/pull.h"
+#include "var_future/impl/stream/reduce.h"
 #include "var_future/impl/stream/stream_future.h"
 #include "var_future/impl/stream/stream_promise.h"
 #include "var_future/impl/stream/stream_storage_impl.h"
+#include "var_future/impl/stream/timed.h"
 
 #endif
@@ -0,0 +1,97 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_STREAM_GENERATOR_INCLUDED_H
+#define AOM_VARIADIC_STREAM_GENERATOR_INCLUDED_H
+
+/// \file
+/// Coroutines producing streams.
+
+#include "var_future/config.h"
+
+#if !AOM_VARFUT_HAS_COROUTINES
+#error "Stream generators require coroutine support"
+#endif
+
+#include "var_future/stream_future.h"
+
+#include <memory>
+
+namespace aom {
+
+namespace detail {
+template <typename Alloc, typename... Ts>
+class Stream_generator_promise;
+}  // namespace detail
+
+/**
+ * @brief Return type of coroutines that produce a stream.
+ *
+ * Each co_yield pushes a value into the stream. Once
+ * AOM_VARFUT_STREAM_GENERATOR_CAPACITY values have been pushed while nobody
+ * was waiting for them, co_yield suspends the coroutine until the consumer
+ * asks for more, as reported by Basic_stream_promise::when_demanded(). The
+ * coroutine is then resumed from the consumer's thread. Consumers using
+ * for_each() take values as fast as they come, so they never suspend it.
+ *
+ * co_return completes the stream, and an exception escaping the coroutine
+ * fails it.
+ *
+ * When a single field is produced, its value is yielded directly. Otherwise,
+ * a std::tuple of the fields is yielded.
+ *
+ * The coroutine frame and the stream are allocated with an Alloc, which is
+ * taken from the coroutine's parameters when they start with
+ * std::allocator_arg followed by an Alloc, and default constructed otherwise.
+ * Some versions of GCC wrongly report -Wmismatched-new-delete on such
+ * coroutines.
+ *
+ * The coroutine runs until its first suspension as soon as it is invoked, and
+ * then runs on its own. Its stream must be consumed, as a suspended generator
+ * only resumes once its values are asked for.
+ *
+ * @tparam Alloc The rebindable allocator to use.
+ * @tparam Ts The types making up the stream's fields.
+ */
+template <typename Alloc, typename... Ts>
+class Basic_stream_generator {
+ public:
+  using promise_type = detail::Stream_generator_promise<Alloc, Ts...>;
+  using future_type = Basic_stream_future<Alloc, Ts...>;
+
+  Basic_stream_generator(Basic_stream_generator&&) = default;
+  Basic_stream_generator& operator=(Basic_stream_generator&&) = default;
+
+  /**
+   * @brief Get the stream produced by the coroutine.
+   *
+   * @pre May only be called once.
+   */
+  future_type get_future();
+
+ private:
+  friend promise_type;
+
+  explicit Basic_stream_generator(future_type f);
+
+  future_type future_;
+};
+
+template <typename... Ts>
+using Stream_generator = Basic_stream_generator<std::allocator<void>, Ts...>;
+}  // namespace aom
+
+#include "var_future/impl/stream/generator.h"
+
+#endif
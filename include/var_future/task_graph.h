@@ -0,0 +1,153 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_TASK_GRAPH_INCLUDED_H
+#define AOM_VARIADIC_TASK_GRAPH_INCLUDED_H
+
+/// \file
+/// Reusable dependency graphs of tasks.
+
+#include "var_future/config.h"
+
+#include "var_future/future.h"
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+namespace aom {
+
+/**
+ * @brief A DAG of tasks that is built once, and then executed many times.
+ *
+ * The shape of the graph, including the in-degree of every node, is computed
+ * as nodes are added. Executing the graph only resets per-node counters, and
+ * the future returned by run() is allocated from a pool owned by the graph, so
+ * that repeated runs do not allocate once the pool is warm.
+ *
+ * If a task throws, the tasks that have not started yet are skipped, and the
+ * run's future is failed with the first exception.
+ *
+ * Only one run may be in flight at a time. A new run may be started, and the
+ * graph may be destroyed, from a continuation of the previous run's future.
+ */
+class Task_graph {
+ public:
+  using node_id = std::size_t;
+  using task_type = std::function<void()>;
+
+  Task_graph() = default;
+
+  /**
+   * @brief The pool of the runs' futures is released once the last of them
+   *        is destroyed.
+   */
+  ~Task_graph();
+
+  /**
+   * @brief Adds a task that runs once every task in deps has completed.
+   *
+   * @param task Callable<void()>
+   * @param deps Nodes that were previously added to this graph.
+   * @return node_id Identifies the new node in subsequent calls to add().
+   */
+  template <typename CbT>
+  node_id add(CbT&& task, std::initializer_list<node_id> deps = {});
+
+  /**
+   * @brief The number of nodes in the graph.
+   */
+  std::size_t size() const { return nodes_.size(); }
+
+  /**
+   * @brief Pushes every task of the graph in queue as soon as their
+   *        dependencies are met.
+   *
+   * @return A future that is fullfilled once every task has completed.
+   *
+   * @pre No previous run of this graph is still in flight.
+   */
+  template <typename QueueT>
+  pmr::Future<void> run(QueueT& queue);
+
+ private:
+  struct Node {
+    task_type task;
+    std::vector<node_id> successors;
+    std::size_t in_degree = 0;
+  };
+
+  using storage_type = pmr::Future<void>::storage_type;
+
+  // Fits in std::function's small buffer, so pushing tasks does not allocate.
+  struct Node_task {
+    void operator()() const { graph->run_node(id); }
+
+    Task_graph* graph;
+    node_id id;
+  };
+
+  // Pool of the runs' futures. Every allocation holds a reference to it, so
+  // that it outlives the graph for as long as one of them is still in use,
+  // be it by the task that delivers a run's result, or by its future.
+  class Run_resource : public std::pmr::memory_resource {
+   public:
+    void release();
+
+   private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* p, std::size_t bytes,
+                       std::size_t alignment) override;
+    bool do_is_equal(
+        const std::pmr::memory_resource& other) const noexcept override;
+
+    std::atomic<std::size_t> ref_count_ = 1;
+    std::pmr::synchronized_pool_resource pool_;
+  };
+
+  void start_run();
+  void schedule(node_id id);
+  void run_node(node_id id);
+  void node_done(node_id id);
+
+  std::vector<Node> nodes_;
+  std::vector<node_id> roots_;
+
+  // Per-run state
+  std::unique_ptr<std::atomic<std::size_t>[]> pending_;
+  std::size_t pending_size_ = 0;
+  std::atomic<std::size_t> remaining_ = 0;
+  std::atomic<bool> failed_ = false;
+  std::exception_ptr error_;
+  detail::Storage_ptr<storage_type> dst_;
+
+  void* queue_ = nullptr;
+  void (*push_)(void*, Node_task) = nullptr;
+
+  Run_resource* resource_ = new Run_resource();
+
+  Task_graph(const Task_graph&) = delete;
+  Task_graph& operator=(const Task_graph&) = delete;
+};
+}  // namespace aom
+
+#include "var_future/impl/task_graph.h"
+
+#endif
@@ -13,7 +13,10 @@
 // limitations under the License.
 
 #include <iostream>
+#include "var_future/async_scope.h"
 #include "var_future/future.h"
+#include "var_future/future_array.h"
+#include "var_future/stream_future.h"
 
 #include "doctest.h"
 
@@ -59,6 +62,14 @@ struct Test_alloc {
     return *this;
   }
 
+  friend bool operator==(const Test_alloc& lhs, const Test_alloc& rhs) {
+    return lhs.counter_ == rhs.counter_;
+  }
+
+  friend bool operator!=(const Test_alloc& lhs, const Test_alloc& rhs) {
+    return !(lhs == rhs);
+  }
+
   std::atomic<int>* counter_;
   std::atomic<int>* total_;
 };
@@ -507,4 +518,140 @@ SUBCASE("te_expected_returning_callback_throw") {
   REQUIRE_THROWS_AS(f3.std_future().get(), std::runtime_error);
   REQUIRE_THROWS_AS(f4.std_future().get(), std::runtime_error);
 }
+
+SUBCASE("async") {
+  std::atomic<int> counter = 0;
+  std::atomic<int> total = 0;
+  std::queue<std::function<void()>> queue;
+
+  {
+    Test_alloc<void> alloc(&counter, &total);
+    auto fut = async(queue, alloc, []() { return 3; });
+    auto bulk = async_bulk(queue, alloc, 4, [](std::size_t i) { return i; });
+
+    static_assert(std::is_same_v<decltype(fut), Future_type>);
+
+    while (!queue.empty()) {
+      queue.front()();
+      queue.pop();
+    }
+
+    REQUIRE_EQ(3, fut.get());
+    auto values = bulk.get();
+    static_assert(std::is_same_v<Test_alloc<std::size_t>,
+                                 decltype(values.get_allocator())>);
+    REQUIRE_EQ(std::vector<std::size_t>{0, 1, 2, 3},
+               std::vector<std::size_t>(values.begin(), values.end()));
+  }
+
+  REQUIRE(total > 0);
+  REQUIRE_EQ(0, counter);
+}
+
+SUBCASE("array_promise") {
+  std::atomic<int> counter = 0;
+  std::atomic<int> total = 0;
+
+  {
+    Test_alloc<void> alloc(&counter, &total);
+    Basic_array_promise<Test_alloc<void>, int> p(100, alloc);
+    auto fut = p.get_future();
+
+    for (int i = 0; i < 100; ++i) {
+      p.set_value(i, i);
+    }
+
+    // The future's storage, and a single block for every element.
+    REQUIRE_EQ(2, total);
+
+    auto res = fut.get();
+    REQUIRE_EQ(100, res.size());
+    REQUIRE_EQ(99, res[99]);
+  }
+
+  REQUIRE_EQ(0, counter);
+}
+
+SUBCASE("async_scope") {
+  std::atomic<int> counter = 0;
+  std::atomic<int> total = 0;
+
+  {
+    Async_scope scope;
+    Promise_type p(Test_alloc<void>(&counter, &total));
+    scope.spawn(p.get_future());
+
+    // The future's storage, and its handler. No result storage.
+    REQUIRE_EQ(2, total);
+
+    p.set_value(1);
+    REQUIRE_EQ(0, scope.size());
+  }
+
+  REQUIRE_EQ(0, counter);
+}
+
+SUBCASE("stream_iterator") {
+  std::atomic<int> counter = 0;
+  std::atomic<int> total = 0;
+
+  {
+    Test_alloc<void> alloc(&counter, &total);
+    Basic_stream_promise<Test_alloc<void>, int> p;
+    auto it = p.get_future(alloc).begin_async();
+
+    int after_first = 0;
+    for (int i = 0; i < 10; ++i) {
+      auto f = it.next();
+      p.push(i);
+      REQUIRE_EQ(i, std::get<0>(*f.try_get()->value()));
+
+      if (i == 0) {
+        after_first = total;
+      }
+    }
+
+    // Every call to next() reused the first one's storage.
+    REQUIRE_EQ(after_first, total);
+    p.complete();
+  }
+
+  REQUIRE_EQ(0, counter);
+}
+
+SUBCASE("stream_final_future") {
+  std::atomic<int> counter = 0;
+  std::atomic<int> total = 0;
+
+  {
+    Test_alloc<void> alloc(&counter, &total);
+    Basic_stream_promise<Test_alloc<void>, int> p;
+    auto fut = p.get_future(alloc);
+    REQUIRE_EQ(1, total);
+
+    // The handler and the result, but no completion future.
+    auto all = fut.collect();
+    REQUIRE_EQ(3, total);
+
+    p.push(1);
+    p.complete();
+    REQUIRE_EQ(std::vector<int>{1}, all.get());
+  }
+
+  {
+    Test_alloc<void> alloc(&counter, &total);
+    Basic_stream_promise<Test_alloc<void>, int> p;
+    auto fut = p.get_future(alloc);
+
+    total = 0;
+    auto done = fut.for_each([](int) {});
+
+    // for_each() hands out a completion future.
+    REQUIRE_EQ(2, total);
+    p.complete();
+    done.get();
+  }
+
+  REQUIRE_EQ(0, counter);
+}
 }
@@ -18,6 +18,9 @@
 #include "doctest.h"
 
 #include <queue>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
 using namespace aom;
 
@@ -36,3 +39,109 @@ TEST_CASE("async function") {
 
   REQUIRE_EQ(12, dst);
 }
+
+TEST_CASE("async returning void") {
+  std::queue<std::function<void()>> queue;
+
+  int dst = 0;
+  auto fut = async(queue, [&]() { dst = 12; });
+
+  REQUIRE_EQ(1, queue.size());
+  queue.front()();
+  queue.pop();
+
+  REQUIRE_EQ(12, dst);
+  fut.get();
+}
+
+TEST_CASE("async_bulk") {
+  std::queue<std::function<void()>> queue;
+  auto run_all = [&] {
+    while (!queue.empty()) {
+      queue.front()();
+      queue.pop();
+    }
+  };
+
+  SUBCASE("values") {
+    auto fut = async_bulk(queue, 100, [](std::size_t i) { return int(i * 2); });
+    REQUIRE_EQ(100, queue.size());
+    run_all();
+
+    auto values = fut.get();
+    REQUIRE_EQ(100, values.size());
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      REQUIRE_EQ(int(i * 2), values[i]);
+    }
+  }
+
+  SUBCASE("void") {
+    std::vector<int> hits(10, 0);
+    Future<void> fut = async_bulk(queue, 10, [&](std::size_t i) { ++hits[i]; });
+    run_all();
+
+    fut.get();
+    REQUIRE_EQ(std::vector<int>(10, 1), hits);
+  }
+
+  SUBCASE("empty") {
+    auto fut = async_bulk(queue, 0, [](std::size_t) { return 1; });
+    REQUIRE(queue.empty());
+    REQUIRE(fut.get().empty());
+  }
+
+  SUBCASE("failure") {
+    auto fut = async_bulk(queue, 10, [](std::size_t i) {
+      if (i == 4) {
+        throw std::runtime_error("nope");
+      }
+      return i;
+    });
+    run_all();
+
+    REQUIRE_THROWS_AS(fut.get(), std::runtime_error);
+  }
+
+  SUBCASE("queue that throws partway") {
+    struct Full_queue {
+      void push(std::function<void()> f) {
+        if (queue->size() == 3) {
+          throw std::length_error("full");
+        }
+        queue->push(std::move(f));
+      }
+      std::queue<std::function<void()>>* queue;
+    };
+
+    Full_queue fq{&queue};
+    int calls = 0;
+    auto fut = async_bulk(fq, 10, [&](std::size_t) { ++calls; });
+    REQUIRE_EQ(3, queue.size());
+    REQUIRE_FALSE(fut.is_ready());
+
+    run_all();
+    REQUIRE_EQ(3, calls);
+    REQUIRE_THROWS_AS(fut.get(), std::length_error);
+  }
+
+  SUBCASE("threaded") {
+    std::vector<std::thread> workers;
+
+    struct Thread_queue {
+      void push(std::function<void()> f) {
+        workers->emplace_back(std::move(f));
+      }
+      std::vector<std::thread>* workers;
+    };
+
+    Thread_queue tq{&workers};
+    auto fut = async_bulk(tq, 8, [](std::size_t i) { return i + 1; });
+    auto values = fut.get();
+
+    for (auto& w : workers) {
+      w.join();
+    }
+
+    REQUIRE_EQ(std::vector<std::size_t>{1, 2, 3, 4, 5, 6, 7, 8}, values);
+  }
+}
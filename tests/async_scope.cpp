@@ -0,0 +1,126 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "var_future/async_scope.h"
+
+#include "doctest.h"
+#include "test_queues.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace aom;
+
+TEST_CASE("Async scope") {
+SUBCASE("empty scope") {
+  Async_scope scope;
+  auto fut = scope.on_empty();
+  REQUIRE(fut.is_ready());
+  fut.get();
+}
+
+SUBCASE("waits for spawned futures") {
+  Async_scope scope;
+  Promise<int> a;
+  Promise<void, float> b;
+
+  scope.spawn(a.get_future());
+  scope.spawn(b.get_future());
+  REQUIRE_EQ(2, scope.size());
+
+  auto first = scope.on_empty();
+  auto second = scope.on_empty();
+
+  a.set_value(1);
+  REQUIRE_FALSE(first.is_ready());
+
+  b.set_exception(std::make_exception_ptr(std::runtime_error("ignored")));
+  REQUIRE_EQ(0, scope.size());
+  first.get();
+  second.get();
+}
+
+SUBCASE("already finished futures") {
+  Async_scope scope;
+  Promise<int> p;
+  p.set_value(1);
+
+  scope.spawn(p.get_future());
+  REQUIRE_EQ(0, scope.size());
+  scope.on_empty().get();
+}
+
+SUBCASE("spawn on a queue") {
+  Manual_queue queue;
+  Async_scope scope;
+  int count = 0;
+
+  for (int i = 0; i < 10; ++i) {
+    scope.spawn(queue, [&] { ++count; });
+  }
+
+  auto done = scope.on_empty();
+  REQUIRE_FALSE(done.is_ready());
+
+  queue.run_all();
+  done.get();
+  REQUIRE_EQ(10, count);
+}
+
+SUBCASE("scope can be reused") {
+  Async_scope scope;
+
+  Promise<void> a;
+  scope.spawn(a.get_future());
+  auto first = scope.on_empty();
+  a.set_value();
+  first.get();
+
+  Promise<void> b;
+  scope.spawn(b.get_future());
+  auto second = scope.on_empty();
+  REQUIRE_FALSE(second.is_ready());
+  b.set_value();
+  second.get();
+}
+
+SUBCASE("from many threads") {
+  Async_scope scope;
+  std::atomic<int> count = 0;
+
+  std::vector<Promise<void>> proms(1000);
+  for (auto& p : proms) {
+    scope.spawn(p.get_future().then([&] { ++count; }));
+  }
+
+  auto done = scope.on_empty();
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t] {
+      for (std::size_t i = t; i < proms.size(); i += 4) {
+        proms[i].set_value();
+      }
+    });
+  }
+
+  done.get();
+  for (auto& t : threads) {
+    t.join();
+  }
+  REQUIRE_EQ(1000, count);
+}
+}
@@ -0,0 +1,215 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include "var_future/batching_queue.h"
+#include "var_future/future.h"
+
+#include "doctest.h"
+#include "test_queues.h"
+
+#include <functional>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <vector>
+
+using namespace aom;
+
+namespace {
+struct Counting_queue {
+  void push(std::function<void()> cb) {
+    ++push_count;
+    tasks.push(std::move(cb));
+  }
+
+  void run() {
+    while (!tasks.empty()) {
+      auto task = std::move(tasks.front());
+      tasks.pop();
+      task();
+    }
+  }
+
+  std::queue<std::function<void()>> tasks;
+  int push_count = 0;
+};
+
+struct Bulk_queue : public Counting_queue {
+  template <typename ItT>
+  void push_bulk(ItT first, ItT last) {
+    bulk_sizes.push_back(std::distance(first, last));
+    for (; first != last; ++first) {
+      tasks.push(*first);
+    }
+  }
+
+  std::vector<std::ptrdiff_t> bulk_sizes;
+};
+
+struct Failing_queue {
+  void push(std::function<void()>) { throw std::runtime_error("full"); }
+};
+
+static_assert(!detail::has_push_bulk_v<Counting_queue>);
+static_assert(detail::has_push_bulk_v<Bulk_queue>);
+static_assert(detail::has_push_bulk_v<Batching_queue<Counting_queue>>);
+}  // namespace
+
+TEST_CASE("Batching queue") {
+SUBCASE("pushes from outside are forwarded immediately") {
+  Counting_queue dst;
+  Batching_queue<Counting_queue> queue(dst);
+
+  int count = 0;
+  queue.push([&] { ++count; });
+  queue.push([&] { ++count; });
+
+  REQUIRE_EQ(2, dst.push_count);
+  dst.run();
+  REQUIRE_EQ(2, count);
+}
+
+SUBCASE("continuations are coalesced") {
+  Counting_queue dst;
+  Batching_queue<Counting_queue> queue(dst, 64);
+
+  std::vector<Promise<int>> promises(100);
+  std::vector<Future<int>> futures;
+  for (auto& p : promises) {
+    futures.push_back(p.get_future().then(queue, [](int v) { return v * 2; }));
+  }
+
+  queue.push([&] {
+    for (int i = 0; i < 100; ++i) {
+      promises[i].set_value(i);
+    }
+  });
+  REQUIRE_EQ(1, dst.push_count);
+
+  dst.run();
+
+  // One flush at 64 tasks, and the rest when the producing task ends.
+  REQUIRE_EQ(3, dst.push_count);
+  for (int i = 0; i < 100; ++i) {
+    REQUIRE_EQ(i * 2, futures[i].get());
+  }
+}
+
+SUBCASE("explicit batch") {
+  Bulk_queue dst;
+  Batching_queue<Bulk_queue> queue(dst, 64);
+
+  std::vector<Promise<int>> promises(10);
+  std::vector<Future<int>> futures;
+  for (auto& p : promises) {
+    futures.push_back(p.get_future().then(queue, [](int v) { return v + 1; }));
+  }
+
+  {
+    Batching_queue<Bulk_queue>::Batch batch(queue);
+    for (int i = 0; i < 10; ++i) {
+      promises[i].set_value(i);
+    }
+    REQUIRE(dst.tasks.empty());
+  }
+
+  REQUIRE_EQ(std::vector<std::ptrdiff_t>{10}, dst.bulk_sizes);
+  REQUIRE_EQ(0, dst.push_count);
+
+  dst.run();
+  for (int i = 0; i < 10; ++i) {
+    REQUIRE_EQ(i + 1, futures[i].get());
+  }
+}
+
+SUBCASE("failed flush") {
+  Failing_queue dst;
+  Batching_queue<Failing_queue> queue(dst);
+
+  Batching_queue<Failing_queue>::Batch batch(queue);
+  queue.push([] {});
+  REQUIRE_THROWS_AS(batch.flush(), std::runtime_error);
+}
+
+SUBCASE("throwing task in a batch") {
+  Counting_queue dst;
+  Batching_queue<Counting_queue> queue(dst);
+
+  std::vector<int> ran;
+  {
+    Batching_queue<Counting_queue>::Batch batch(queue);
+    queue.push([&] { ran.push_back(0); });
+    queue.push([&] {
+      ran.push_back(1);
+      throw std::runtime_error("nope");
+    });
+    queue.push([&] { ran.push_back(2); });
+  }
+  REQUIRE_EQ(1, dst.push_count);
+
+  // The rest of the batch still runs.
+  REQUIRE_THROWS_AS(dst.run(), std::runtime_error);
+  REQUIRE_EQ(std::vector<int>{0, 1, 2}, ran);
+}
+
+SUBCASE("move-only tasks") {
+  Move_only_queue dst;
+  Batching_queue<Move_only_queue> queue(dst);
+
+  int total = 0;
+  queue.push([&total, v = std::make_unique<int>(1)] { total += *v; });
+  REQUIRE_EQ(1, dst.tasks.size());
+
+  Promise<int> p;
+  auto fut = p.get_future().then(
+      queue, [v = std::make_unique<int>(2)](int x) { return x + *v; });
+  {
+    Batching_queue<Move_only_queue>::Batch batch(queue);
+    queue.push([&total, v = std::make_unique<int>(3)] { total += *v; });
+    p.set_value(4);
+    REQUIRE_EQ(1, dst.tasks.size());
+  }
+
+  // The batch is forwarded as a single task.
+  REQUIRE_EQ(2, dst.tasks.size());
+
+  dst.run_all();
+  REQUIRE_EQ(4, total);
+  REQUIRE_EQ(6, fut.get());
+}
+
+SUBCASE("async_bulk prefers push_bulk") {
+  Bulk_queue dst;
+
+  auto fut = async_bulk(dst, 5, [](std::size_t i) { return int(i); });
+
+  REQUIRE_EQ(std::vector<std::ptrdiff_t>{5}, dst.bulk_sizes);
+  REQUIRE_EQ(0, dst.push_count);
+
+  dst.run();
+  REQUIRE_EQ(std::vector<int>{0, 1, 2, 3, 4}, fut.get());
+}
+
+SUBCASE("async_bulk through the adapter") {
+  Counting_queue dst;
+  Batching_queue<Counting_queue> queue(dst, 4);
+
+  auto fut = async_bulk(queue, 10, [](std::size_t i) { return int(i); });
+  REQUIRE_EQ(3, dst.push_count);
+
+  dst.run();
+  REQUIRE_EQ(std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}, fut.get());
+}
+}
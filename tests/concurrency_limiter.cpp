@@ -0,0 +1,227 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "var_future/concurrency_limiter.h"
+
+#include "doctest.h"
+#include "test_queues.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace aom;
+
+TEST_CASE("Concurrency limiter") {
+SUBCASE("pushed tasks are admitted up to the limit") {
+  Manual_queue queue;
+  Concurrency_limiter limiter(queue, 2);
+
+  std::vector<int> order;
+  for (int i = 0; i < 5; ++i) {
+    limiter.push([&, i] { order.push_back(i); });
+  }
+
+  REQUIRE_EQ(2, queue.tasks.size());
+  REQUIRE_EQ(5, limiter.size());
+
+  queue.run_all();
+  REQUIRE_EQ(std::vector<int>{0, 1, 2, 3, 4}, order);
+  REQUIRE_EQ(0, limiter.size());
+}
+
+SUBCASE("async value") {
+  Manual_queue queue;
+  Concurrency_limiter limiter(queue, 1);
+
+  auto a = async(limiter, [] { return 1; });
+  auto b = async(limiter, [] { return 2; });
+  auto c = async(limiter, [] {});
+
+  REQUIRE_EQ(1, queue.tasks.size());
+  queue.run_all();
+
+  REQUIRE_EQ(1, a.get());
+  REQUIRE_EQ(2, b.get());
+  c.get();
+}
+
+SUBCASE("async move-only callback") {
+  Manual_queue queue;
+  Concurrency_limiter limiter(queue, 1);
+
+  Promise<int> p;
+  auto pf = p.get_future();
+  auto a = async(limiter, [v = std::make_unique<int>(1)] { return *v; });
+  auto b = async(limiter, [p = std::move(p)]() mutable {
+    p.set_value(2);
+    return 3;
+  });
+
+  queue.run_all();
+  REQUIRE_EQ(1, a.get());
+  REQUIRE_EQ(3, b.get());
+  REQUIRE_EQ(2, pf.get());
+}
+
+SUBCASE("throwing queue") {
+  struct Flaky_queue {
+    void push(std::function<void()> f) {
+      if (fail) {
+        fail = false;
+        throw std::length_error("full");
+      }
+      tasks.push_back(std::move(f));
+    }
+
+    bool fail = false;
+    std::vector<std::function<void()>> tasks;
+  } queue;
+  Concurrency_limiter limiter(queue, 1);
+  int count = 0;
+
+  queue.fail = true;
+  REQUIRE_THROWS_AS(limiter.push([&] { ++count; }), std::length_error);
+  REQUIRE_EQ(0, limiter.size());
+
+  // The slot was given back.
+  limiter.push([&] { ++count; });
+  limiter.push([&] { ++count; });
+  REQUIRE_EQ(1, queue.tasks.size());
+  REQUIRE_EQ(2, limiter.size());
+
+  // The waiting task cannot be forwarded as the first one releases its slot.
+  queue.fail = true;
+  auto first = std::move(queue.tasks[0]);
+  queue.tasks.clear();
+  REQUIRE_NOTHROW(first());
+
+  REQUIRE_EQ(1, count);
+  REQUIRE(queue.tasks.empty());
+  REQUIRE_EQ(0, limiter.size());
+}
+
+SUBCASE("async failure releases the slot") {
+  Manual_queue queue;
+  Concurrency_limiter limiter(queue, 1);
+
+  auto a = async(limiter, []() -> int { throw std::runtime_error("nope"); });
+  auto b = async(limiter, [] { return 2; });
+
+  queue.run_all();
+  REQUIRE_THROWS_AS(a.get(), std::runtime_error);
+  REQUIRE_EQ(2, b.get());
+}
+
+SUBCASE("async future holds the slot until it is finished") {
+  Manual_queue queue;
+  Concurrency_limiter limiter(queue, 1);
+
+  Promise<int> p;
+  bool second_ran = false;
+
+  auto a = async(limiter, [&] { return p.get_future(); });
+  auto b = async(limiter, [&] {
+    second_ran = true;
+    return 2;
+  });
+
+  queue.run_all();
+  REQUIRE_FALSE(second_ran);
+  REQUIRE_EQ(2, limiter.size());
+
+  p.set_value(1);
+  REQUIRE_EQ(1, queue.tasks.size());
+  queue.run_all();
+
+  REQUIRE(second_ran);
+  REQUIRE_EQ(1, a.get());
+  REQUIRE_EQ(2, b.get());
+}
+
+SUBCASE("async failed future releases the slot") {
+  Manual_queue queue;
+  Concurrency_limiter limiter(queue, 1);
+
+  Promise<int> p;
+  auto a = async(limiter, [&] { return p.get_future(); });
+  auto b = async(limiter, [] { return 2; });
+
+  queue.run_all();
+  p.set_exception(std::make_exception_ptr(std::runtime_error("nope")));
+  queue.run_all();
+
+  REQUIRE_THROWS_AS(a.get(), std::runtime_error);
+  REQUIRE_EQ(2, b.get());
+}
+
+SUBCASE("then") {
+  Manual_queue queue;
+  Concurrency_limiter limiter(queue, 1);
+
+  Promise<int> p;
+  auto fut = p.get_future().then(limiter, [](int v) { return v * 2; });
+  p.set_value(3);
+  queue.run_all();
+
+  REQUIRE_EQ(6, fut.get());
+}
+
+SUBCASE("never exceeds the limit under contention") {
+  constexpr std::size_t limit = 3;
+  constexpr int task_count = 2000;
+
+  Thread_pool pool(8);
+  Concurrency_limiter limiter(pool, limit);
+
+  std::atomic<std::size_t> running = 0;
+  std::atomic<std::size_t> peak = 0;
+
+  auto task = [&] {
+    auto now = running.fetch_add(1) + 1;
+    auto prev = peak.load();
+    while (prev < now && !peak.compare_exchange_weak(prev, now)) {
+    }
+    std::this_thread::yield();
+    running.fetch_sub(1);
+  };
+
+  std::vector<Future<void>> futs;
+  std::vector<std::thread> producers;
+  std::mutex futs_mtx;
+  for (int t = 0; t < 4; ++t) {
+    producers.emplace_back([&] {
+      for (int i = 0; i < task_count / 4; ++i) {
+        auto f = async(limiter, task);
+        std::lock_guard l(futs_mtx);
+        futs.push_back(std::move(f));
+      }
+    });
+  }
+  for (auto& t : producers) {
+    t.join();
+  }
+  for (auto& f : futs) {
+    f.get();
+  }
+
+  REQUIRE_EQ(task_count, futs.size());
+  REQUIRE(peak.load() <= limit);
+  REQUIRE(peak.load() > 0);
+}
+}
@@ -0,0 +1,232 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "var_future/stream_future.h"
+
+#if AOM_VARFUT_HAS_COROUTINES
+#include "var_future/stream_generator.h"
+#endif
+
+#include "doctest.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace aom;
+
+#if AOM_VARFUT_HAS_COROUTINES
+
+namespace {
+// Starts right away, and runs to completion on its own.
+struct Detached_task {
+  struct promise_type {
+    Detached_task get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+Detached_task sum_stream(Stream_iterator<int> it, int& sum, bool& done) {
+  while (auto v = co_await it.next()) {
+    sum += std::get<0>(*v);
+  }
+  done = true;
+}
+
+Detached_task await_value(Future<int> f, int& dst) {
+  dst = co_await std::move(f);
+}
+
+Detached_task await_error(Future<int> f, bool& caught) {
+  try {
+    co_await std::move(f);
+  } catch (std::runtime_error&) {
+    caught = true;
+  }
+}
+Stream_generator<int> count_to(int n) {
+  for (int i = 0; i < n; ++i) {
+    co_yield i;
+  }
+}
+
+Stream_generator<int, std::string> pairs() {
+  co_yield std::make_tuple(1, std::string("a"));
+  co_yield std::make_tuple(2, std::string("b"));
+}
+
+Stream_generator<int> failing() {
+  co_yield 1;
+  throw std::runtime_error("nope");
+}
+
+std::atomic<int> frame_allocs = 0;
+
+template <typename T>
+struct Counting_alloc {
+  using value_type = T;
+
+  Counting_alloc() = default;
+  template <typename U>
+  Counting_alloc(const Counting_alloc<U>&) {}
+
+  T* allocate(std::size_t n) {
+    ++frame_allocs;
+    return static_cast<T*>(std::malloc(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, std::size_t) {
+    --frame_allocs;
+    std::free(p);
+  }
+
+  template <typename U>
+  bool operator==(const Counting_alloc<U>&) const {
+    return true;
+  }
+};
+
+// GCC mistakes the frame's usual operator delete for a mismatch of the
+// allocator-taking operator new.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+Basic_stream_generator<Counting_alloc<void>, int> allocated(
+    std::allocator_arg_t, Counting_alloc<void>, int n) {
+  for (int i = 0; i < n; ++i) {
+    co_yield i;
+  }
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+}  // namespace
+
+TEST_CASE("co_await futures") {
+SUBCASE("ready") {
+  Promise<int> prom;
+  auto f = prom.get_future();
+  prom.set_value(3);
+
+  int v = 0;
+  await_value(std::move(f), v);
+  REQUIRE_EQ(3, v);
+}
+
+SUBCASE("pending") {
+  Promise<int> prom;
+  int v = 0;
+  await_value(prom.get_future(), v);
+  REQUIRE_EQ(0, v);
+
+  prom.set_value(4);
+  REQUIRE_EQ(4, v);
+}
+
+SUBCASE("failure") {
+  Promise<int> prom;
+  bool caught = false;
+  await_error(prom.get_future(), caught);
+
+  prom.set_exception(std::make_exception_ptr(std::runtime_error("nope")));
+  REQUIRE(caught);
+}
+}
+
+TEST_CASE("co_await stream iterator") {
+  Stream_promise<int> prom;
+
+  int sum = 0;
+  bool done = false;
+  sum_stream(prom.get_future().begin_async(), sum, done);
+
+  prom.push(1);
+  prom.push(2);
+  REQUIRE_EQ(3, sum);
+  REQUIRE_FALSE(done);
+
+  prom.push(3);
+  prom.complete();
+  REQUIRE_EQ(6, sum);
+  REQUIRE(done);
+}
+
+TEST_CASE("Stream generator") {
+SUBCASE("push consumer") {
+  std::vector<int> values;
+  auto done = count_to(100).get_future().for_each(
+      [&](int v) { values.push_back(v); });
+
+  done.get();
+  REQUIRE_EQ(100, values.size());
+  REQUIRE_EQ(99, values.back());
+}
+
+SUBCASE("multiple fields") {
+  std::vector<std::string> values;
+  auto done = pairs().get_future().for_each(
+      [&](int, std::string s) { values.push_back(s); });
+
+  done.get();
+  REQUIRE_EQ(std::vector<std::string>{"a", "b"}, values);
+}
+
+SUBCASE("failure") {
+  auto done = failing().get_future().for_each([](int) {});
+  REQUIRE_THROWS_AS(done.get(), std::runtime_error);
+}
+
+SUBCASE("bounded buffer") {
+  constexpr int capacity = AOM_VARFUT_STREAM_GENERATOR_CAPACITY;
+
+  auto fut = count_to(3 * capacity).get_future();
+  auto stream = fut.begin_async();
+
+  // Nothing has been asked for yet, so the generator stopped at capacity.
+  Stream_iterator<int>* it = &stream;
+  for (int i = 0; i < 3 * capacity; ++i) {
+    REQUIRE_EQ(i, std::get<0>(*it->next().get()));
+  }
+  REQUIRE_FALSE(it->next().get());
+}
+
+SUBCASE("frame allocation") {
+  constexpr int n = AOM_VARFUT_STREAM_GENERATOR_CAPACITY + 1;
+  {
+    auto fut = allocated(std::allocator_arg, Counting_alloc<void>(), n)
+                   .get_future();
+
+    // The suspended frame, the stream, and the future the generator is
+    // waiting on along with its handler.
+    REQUIRE_EQ(4, frame_allocs.load());
+
+    int sum = 0;
+    auto done = fut.for_each([&](int v) { sum += v; });
+    done.get();
+    REQUIRE_EQ(n * (n - 1) / 2, sum);
+  }
+  REQUIRE_EQ(0, frame_allocs.load());
+}
+}
+
+#endif
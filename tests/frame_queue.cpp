@@ -0,0 +1,203 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include "var_future/frame_queue.h"
+#include "var_future/future.h"
+
+#include "doctest.h"
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace aom;
+using namespace std::chrono_literals;
+
+TEST_CASE("Polling futures") {
+SUBCASE("is_ready does not consume") {
+  Promise<int> p;
+  auto f = p.get_future();
+
+  REQUIRE_FALSE(f.is_ready());
+  REQUIRE_FALSE(f.try_get());
+  REQUIRE_FALSE(f.is_ready());
+
+  p.set_value(3);
+  REQUIRE(f.is_ready());
+  REQUIRE(f.is_ready());
+
+  auto v = f.try_get();
+  REQUIRE(v);
+  REQUIRE_EQ(3, v->value());
+}
+
+SUBCASE("failure") {
+  Promise<int> p;
+  auto f = p.get_future();
+
+  p.set_exception(std::make_exception_ptr(std::logic_error("nope")));
+  REQUIRE(f.is_ready());
+
+  auto v = f.try_get();
+  REQUIRE(v);
+  REQUIRE_FALSE(v->has_value());
+  REQUIRE_THROWS_AS(std::rethrow_exception(v->error()), std::logic_error);
+}
+
+SUBCASE("void and multiple fields") {
+  Promise<void> p_void;
+  Promise<int, void, std::string> p_multi;
+  auto f_void = p_void.get_future();
+  auto f_multi = p_multi.get_future();
+
+  p_void.set_value();
+  p_multi.set_value(1, "a");
+
+  REQUIRE(f_void.try_get()->has_value());
+  REQUIRE_EQ(std::make_tuple(1, std::string("a")), f_multi.try_get()->value());
+}
+
+SUBCASE("emplaced") {
+  Promise<int, int> p;
+  auto f = p.get_future();
+
+  p.emplace<0>(1);
+  REQUIRE_FALSE(f.is_ready());
+  p.emplace<1>(2);
+  REQUIRE(f.is_ready());
+}
+}
+
+TEST_CASE("Frame queue") {
+SUBCASE("run_all") {
+  Frame_queue queue;
+  int count = 0;
+
+  for (int i = 0; i < 10; ++i) {
+    queue.push([&] { ++count; });
+  }
+  REQUIRE_EQ(10, queue.size());
+
+  REQUIRE_EQ(10, queue.run_all());
+  REQUIRE_EQ(10, count);
+  REQUIRE_EQ(0, queue.size());
+}
+
+SUBCASE("budget carries tasks over") {
+  Frame_queue queue;
+  std::vector<int> order;
+
+  for (int i = 0; i < 10; ++i) {
+    queue.push([&, i] {
+      order.push_back(i);
+      std::this_thread::sleep_for(2ms);
+    });
+  }
+
+  auto first = queue.run_for(5ms);
+  REQUIRE_GE(first, 1);
+  REQUIRE_LT(first, 10);
+  REQUIRE_EQ(10 - first, queue.size());
+
+  queue.push([&] { order.push_back(10); });
+  queue.run_all();
+
+  REQUIRE_EQ(std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10}, order);
+}
+
+SUBCASE("always makes progress") {
+  Frame_queue queue;
+  int count = 0;
+  queue.push([&] { ++count; });
+
+  REQUIRE_EQ(1, queue.run_for(0ms));
+  REQUIRE_EQ(0, queue.run_for(0ms));
+  REQUIRE_EQ(1, count);
+}
+
+SUBCASE("polling asset loads") {
+  Frame_queue queue;
+  std::vector<Promise<int>> loads(4);
+  std::vector<Future<int>> assets;
+  for (auto& p : loads) {
+    assets.push_back(p.get_future().then(queue, [](int v) { return v * 2; }));
+  }
+
+  std::thread loader([&] {
+    for (int i = 0; i < 4; ++i) {
+      loads[i].set_value(i);
+    }
+  });
+  loader.join();
+
+  int ready = 0;
+  while (ready != 4) {
+    queue.run_for(1ms);
+    ready = 0;
+    for (auto& a : assets) {
+      ready += a.is_ready() ? 1 : 0;
+    }
+  }
+
+  for (int i = 0; i < 4; ++i) {
+    REQUIRE_EQ(i * 2, assets[i].try_get()->value());
+  }
+}
+
+SUBCASE("continuations run inline while draining") {
+  Frame_queue queue;
+  Promise<int> p;
+  auto f = p.get_future().then(queue, [](int v) { return v + 1; });
+
+  queue.push([&] { p.set_value(1); });
+  REQUIRE_FALSE(queue.running_in_this_thread());
+
+  REQUIRE_EQ(1, queue.run_for(0ms));
+  REQUIRE_EQ(2, f.try_get()->value());
+}
+
+SUBCASE("move-only continuations") {
+  Frame_queue queue;
+  Promise<int> p;
+  auto f = p.get_future().then(
+      queue, [u = std::make_unique<int>(1)](int v) { return v + *u; });
+
+  p.set_value(2);
+  REQUIRE_EQ(1, queue.run_all());
+  REQUIRE_EQ(3, f.try_get()->value());
+}
+
+SUBCASE("size with a concurrent producer") {
+  constexpr int count = 100000;
+
+  Frame_queue queue;
+  std::thread producer([&] {
+    for (int i = 0; i < count; ++i) {
+      queue.push([] {});
+    }
+  });
+
+  int ran = 0;
+  while (ran != count) {
+    ran += static_cast<int>(queue.run_all());
+    // A task popped before being counted would wrap the size around.
+    REQUIRE_LE(queue.size(), count);
+  }
+  producer.join();
+
+  REQUIRE_EQ(0, queue.size());
+}
+}
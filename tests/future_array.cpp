@@ -0,0 +1,166 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include "var_future/future_array.h"
+
+#include "doctest.h"
+
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace aom;
+
+TEST_CASE("Future arrays") {
+SUBCASE("values are contiguous") {
+  Array_promise<int> p(200);
+  auto fut = p.get_future();
+
+  for (int i = 0; i < 200; ++i) {
+    p.set_value(i, i * 2);
+  }
+
+  auto res = fut.get();
+  REQUIRE_EQ(200, res.size());
+  REQUIRE_EQ(0, res.error_count());
+  REQUIRE_EQ(&res[0] + 199, &res[199]);
+
+  int total = std::accumulate(res.begin(), res.end(), 0);
+  REQUIRE_EQ(199 * 200, total);
+}
+
+SUBCASE("delivered once every element is assigned") {
+  Array_promise<std::string> p(3);
+  bool done = false;
+
+  auto fut = p.get_future().then([&](const Array_result<std::string>& res) {
+    done = true;
+    return res[0] + res[1] + res[2];
+  });
+
+  p.set_value(2, "c");
+  p.set_value(0, "a");
+  REQUIRE_FALSE(done);
+  p.set_value(1, 1, 'b');
+  REQUIRE(done);
+
+  REQUIRE_EQ("abc", fut.get());
+}
+
+SUBCASE("failed elements") {
+  Array_promise<int> p(4);
+  auto fut = p.get_future();
+
+  p.set_value(0, 1);
+  p.set_exception(3, std::make_exception_ptr(std::runtime_error("3")));
+  p.set_exception(1, std::make_exception_ptr(std::logic_error("1")));
+  p.set_value(2, 3);
+
+  auto res = fut.get();
+  REQUIRE_EQ(2, res.error_count());
+  REQUIRE_FALSE(res.is_failed(0));
+  REQUIRE(res.is_failed(1));
+  REQUIRE_FALSE(res.is_failed(2));
+  REQUIRE(res.is_failed(3));
+
+  REQUIRE_EQ(nullptr, res.error(0));
+  REQUIRE_THROWS_AS(std::rethrow_exception(res.error(1)), std::logic_error);
+  REQUIRE_THROWS_AS(std::rethrow_exception(res.error(3)), std::runtime_error);
+  REQUIRE_EQ(0, res[1]);
+}
+
+SUBCASE("unfullfilled elements") {
+  Future_array<int> fut;
+  {
+    Array_promise<int> p(3);
+    fut = p.get_future();
+    p.set_value(1, 1);
+  }
+
+  auto res = fut.get();
+  REQUIRE_EQ(2, res.error_count());
+  REQUIRE_THROWS_AS(std::rethrow_exception(res.error(0)), Unfullfilled_promise);
+  REQUIRE_FALSE(res.is_failed(1));
+  REQUIRE_THROWS_AS(std::rethrow_exception(res.error(2)), Unfullfilled_promise);
+}
+
+SUBCASE("empty") {
+  Array_promise<int> p(0);
+  auto res = p.get_future().get();
+
+  REQUIRE_EQ(0, res.size());
+  REQUIRE_EQ(res.begin(), res.end());
+}
+
+SUBCASE("element handles") {
+  Future_array<int> fut;
+  std::vector<Array_element_promise<int>> elements;
+  {
+    Array_promise<int> p(3);
+    fut = p.get_future();
+    for (std::size_t i = 0; i < 3; ++i) {
+      elements.push_back(p.element(i));
+    }
+  }
+
+  elements[0].set_value(4);
+  REQUIRE_FALSE(elements[0]);
+  REQUIRE(elements[1]);
+
+  // Dropped handles fail their element.
+  elements.pop_back();
+  elements[1].set_value(5);
+
+  auto res = fut.get();
+  REQUIRE_EQ(4, res[0]);
+  REQUIRE_EQ(5, res[1]);
+  REQUIRE_THROWS_AS(std::rethrow_exception(res.error(2)), Unfullfilled_promise);
+}
+
+SUBCASE("threaded") {
+  constexpr std::size_t n = 4096;
+  Array_promise<std::size_t> p(n);
+  auto fut = p.get_future();
+
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < 4; ++t) {
+    std::vector<Array_element_promise<std::size_t>> elements;
+    for (std::size_t i = t; i < n; i += 4) {
+      elements.push_back(p.element(i));
+    }
+
+    threads.emplace_back([elems = std::move(elements), t]() mutable {
+      std::size_t i = t;
+      for (auto& e : elems) {
+        e.set_value(i);
+        i += 4;
+      }
+    });
+  }
+
+  p = Array_promise<std::size_t>(0);
+
+  auto res = fut.get();
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  REQUIRE_EQ(0, res.error_count());
+  for (std::size_t i = 0; i < n; ++i) {
+    REQUIRE_EQ(i, res[i]);
+  }
+}
+}
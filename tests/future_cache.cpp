@@ -0,0 +1,193 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include "var_future/future_cache.h"
+
+#include "doctest.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace aom;
+using namespace std::chrono_literals;
+
+TEST_CASE("Future cache") {
+SUBCASE("single flight") {
+  Future_cache<int, std::string> cache;
+  Promise<std::string> load;
+  int load_count = 0;
+
+  auto loader = [&](int) {
+    ++load_count;
+    return load.get_future();
+  };
+
+  auto a = cache.get(1, loader);
+  auto b = cache.get(1, loader);
+  REQUIRE_EQ(1, load_count);
+  REQUIRE_FALSE(a.is_ready());
+
+  load.set_value("one");
+
+  auto va = a.get();
+  auto vb = b.get();
+  REQUIRE_EQ("one", *va);
+
+  // Both waiters share the same value.
+  REQUIRE_EQ(va.get(), vb.get());
+
+  // Completed values are cached.
+  auto c = cache.get(1, loader);
+  REQUIRE(c.is_ready());
+  REQUIRE_EQ(va.get(), c.get().get());
+  REQUIRE_EQ(1, load_count);
+}
+
+SUBCASE("synchronous loaders") {
+  Future_cache<int, int> cache;
+  int load_count = 0;
+  auto loader = [&](int k) {
+    ++load_count;
+    return k * 2;
+  };
+
+  REQUIRE_EQ(4, *cache.get(2, loader).get());
+  REQUIRE_EQ(4, *cache.get(2, loader).get());
+  REQUIRE_EQ(1, load_count);
+}
+
+SUBCASE("failures are not cached") {
+  Future_cache<int, int> cache;
+  int load_count = 0;
+  auto failing = [&](int) -> int {
+    ++load_count;
+    throw std::runtime_error("nope");
+  };
+
+  REQUIRE_THROWS_AS(cache.get(1, failing).get(), std::runtime_error);
+  REQUIRE_EQ(0, cache.size());
+
+  REQUIRE_THROWS_AS(cache.get(1, failing).get(), std::runtime_error);
+  REQUIRE_EQ(2, load_count);
+}
+
+SUBCASE("lru eviction") {
+  Future_cache<int, int>::Options opts;
+  opts.shards = 1;
+  opts.max_entries = 2;
+  Future_cache<int, int> cache(opts);
+
+  int load_count = 0;
+  auto loader = [&](int k) {
+    ++load_count;
+    return k;
+  };
+
+  cache.get(1, loader).get();
+  cache.get(2, loader).get();
+  cache.get(1, loader).get();  // 2 is now the least recently used.
+  cache.get(3, loader).get();
+  REQUIRE_EQ(3, load_count);
+  REQUIRE_EQ(2, cache.size());
+
+  cache.get(1, loader).get();
+  REQUIRE_EQ(3, load_count);
+  cache.get(2, loader).get();
+  REQUIRE_EQ(4, load_count);
+}
+
+SUBCASE("ttl") {
+  Future_cache<int, int>::Options opts;
+  opts.ttl = 10ms;
+  Future_cache<int, int> cache(opts);
+
+  int load_count = 0;
+  auto loader = [&](int k) {
+    ++load_count;
+    return k;
+  };
+
+  cache.get(1, loader).get();
+  cache.get(1, loader).get();
+  REQUIRE_EQ(1, load_count);
+
+  std::this_thread::sleep_for(20ms);
+  cache.get(1, loader).get();
+  REQUIRE_EQ(2, load_count);
+}
+
+SUBCASE("erase during a load") {
+  Future_cache<int, int> cache;
+  std::vector<Promise<int>> loads;
+  auto loader = [&](int) {
+    loads.emplace_back();
+    return loads.back().get_future();
+  };
+
+  auto a = cache.get(1, loader);
+  cache.erase(1);
+  auto b = cache.get(1, loader);
+  REQUIRE_EQ(2, loads.size());
+
+  loads[0].set_value(1);
+  loads[1].set_value(2);
+
+  REQUIRE_EQ(1, *a.get());
+  REQUIRE_EQ(2, *b.get());
+  REQUIRE_EQ(2, *cache.get(1, loader).get());
+}
+
+SUBCASE("loads outliving the cache") {
+  Promise<int> load;
+  Future<std::shared_ptr<const int>> fut;
+  {
+    Future_cache<int, int> cache;
+    fut = cache.get(1, [&](int) { return load.get_future(); });
+  }
+
+  load.set_value(3);
+  REQUIRE_EQ(3, *fut.get());
+}
+
+SUBCASE("threaded") {
+  Future_cache<int, int> cache;
+  std::atomic<int> load_count = 0;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 1000; ++i) {
+        int k = i % 50;
+        auto v = cache
+                     .get(k,
+                          [&](int key) {
+                            ++load_count;
+                            return key;
+                          })
+                     .get();
+        REQUIRE_EQ(k, *v);
+      }
+    });
+  }
+
+  for (auto& t : threads) {
+    t.join();
+  }
+  REQUIRE_EQ(50, load_count);
+}
+}
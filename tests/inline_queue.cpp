@@ -0,0 +1,122 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include "var_future/future.h"
+
+#include "doctest.h"
+
+#include <functional>
+#include <queue>
+
+using namespace aom;
+
+namespace {
+// Single-threaded queue that knows when its tasks are being executed.
+struct Tracking_queue {
+  void push(std::function<void()> cb) {
+    ++push_count;
+    tasks.push(std::move(cb));
+  }
+
+  bool running_in_this_thread() const { return running; }
+
+  void run() {
+    running = true;
+    while (!tasks.empty()) {
+      auto task = std::move(tasks.front());
+      tasks.pop();
+      task();
+    }
+    running = false;
+  }
+
+  std::queue<std::function<void()>> tasks;
+  int push_count = 0;
+  bool running = false;
+};
+
+static_assert(detail::has_running_in_this_thread_v<Tracking_queue>);
+static_assert(!detail::has_running_in_this_thread_v<std::queue<int>>);
+}  // namespace
+
+TEST_CASE("Inline execution on the target queue") {
+SUBCASE("fullfilled from elsewhere") {
+  Tracking_queue queue;
+  Promise<int> p;
+
+  auto fut = p.get_future().then(queue, [](int v) { return v * 2; });
+
+  p.set_value(2);
+  REQUIRE_EQ(1, queue.push_count);
+
+  queue.run();
+  REQUIRE_EQ(4, fut.get());
+}
+
+SUBCASE("fullfilled from the queue") {
+  Tracking_queue queue;
+  Promise<int> p;
+  bool done = false;
+
+  auto fut = p.get_future().then(queue, [](int v) { return v * 2; });
+  fut.finally(queue, [&](expected<int> v) {
+    REQUIRE_EQ(4, *v);
+    done = true;
+  });
+
+  queue.push([&] {
+    p.set_value(2);
+    REQUIRE(done);
+  });
+  queue.run();
+
+  REQUIRE(done);
+  REQUIRE_EQ(1, queue.push_count);
+}
+
+SUBCASE("failure from the queue") {
+  Tracking_queue queue;
+  Promise<int> p;
+
+  auto fut = p.get_future().then(queue, [](int v) { return v * 2; });
+
+  queue.push(
+      [&] { p.set_exception(std::make_exception_ptr(std::logic_error(""))); });
+  queue.run();
+
+  REQUIRE_EQ(1, queue.push_count);
+  REQUIRE_THROWS_AS(fut.get(), std::logic_error);
+}
+
+SUBCASE("depth is bounded") {
+  constexpr int chain_length = 200000;
+
+  Tracking_queue queue;
+  Promise<int> p;
+  Future<int> f = p.get_future();
+
+  for (int i = 0; i < chain_length; ++i) {
+    f = f.then(queue, [](int v) { return v + 1; });
+  }
+
+  queue.push([&] { p.set_value(0); });
+  queue.run();
+
+  // Past the depth limit, callbacks go through the queue again.
+  REQUIRE_GT(queue.push_count, 1);
+  REQUIRE_LT(queue.push_count, chain_length);
+  REQUIRE_EQ(chain_length, f.get());
+}
+}
@@ -0,0 +1,228 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include "var_future/future.h"
+
+#include "doctest.h"
+
+#include <optional>
+
+using namespace aom;
+
+namespace {
+struct Move_counter {
+  static int moves;
+  static int copies;
+
+  static void reset() {
+    moves = 0;
+    copies = 0;
+  }
+
+  Move_counter() = default;
+  Move_counter(int v, int w) : value(v + w) {}
+  Move_counter(const Move_counter&) { ++copies; }
+  Move_counter(Move_counter&&) { ++moves; }
+  Move_counter& operator=(const Move_counter&) {
+    ++copies;
+    return *this;
+  }
+  Move_counter& operator=(Move_counter&&) {
+    ++moves;
+    return *this;
+  }
+
+  int value = 0;
+};
+
+int Move_counter::moves = 0;
+int Move_counter::copies = 0;
+
+// Keeps track of how many instances are alive.
+struct Counted {
+  explicit Counted(int* c) : count(c) { ++*count; }
+  Counted(const Counted& rhs) : count(rhs.count) { ++*count; }
+  Counted& operator=(const Counted&) = default;
+  ~Counted() { --*count; }
+
+  int* count;
+};
+}  // namespace
+
+TEST_CASE("move semantics") {
+SUBCASE("fullfill_to_finish") {
+  using fullfill_t = detail::fullfill_type_t<Move_counter, void, Move_counter>;
+
+  fullfill_t src;
+  Move_counter::reset();
+
+  auto dst = detail::fullfill_to_finish<Move_counter, void, Move_counter>(
+      std::move(src));
+
+  REQUIRE(std::get<0>(dst).has_value());
+  REQUIRE(std::get<1>(dst).has_value());
+  REQUIRE(std::get<2>(dst).has_value());
+  REQUIRE_EQ(0, Move_counter::copies);
+  REQUIRE_EQ(2, Move_counter::moves);
+}
+
+SUBCASE("finish_to_fullfill") {
+  using finish_t =
+      detail::finish_type_t<void, Move_counter, Move_counter, Move_counter>;
+
+  finish_t src;
+  Move_counter::reset();
+
+  auto dst = detail::finish_to_fullfill<void, Move_counter, Move_counter,
+                                        Move_counter>(std::move(src));
+
+  static_assert(std::tuple_size_v<decltype(dst)> == 3);
+  REQUIRE_EQ(0, Move_counter::copies);
+  REQUIRE_EQ(3, Move_counter::moves);
+}
+
+SUBCASE("no copies through then") {
+  Promise<Move_counter, Move_counter, Move_counter> p;
+  int calls = 0;
+
+  auto f = p.get_future().then(
+      [&](Move_counter, Move_counter, Move_counter) { ++calls; });
+
+  Move_counter::reset();
+  p.set_value(Move_counter{}, Move_counter{}, Move_counter{});
+  f.get();
+
+  REQUIRE_EQ(1, calls);
+  REQUIRE_EQ(0, Move_counter::copies);
+}
+
+SUBCASE("no copies through then, prefilled") {
+  Promise<Move_counter, void, Move_counter> p;
+  auto f = p.get_future();
+
+  Move_counter::reset();
+  p.set_value(Move_counter{}, Move_counter{});
+
+  int calls = 0;
+  f.then([&](Move_counter, Move_counter) { ++calls; }).get();
+
+  REQUIRE_EQ(1, calls);
+  REQUIRE_EQ(0, Move_counter::copies);
+}
+
+SUBCASE("emplace_value, handler first") {
+  Promise<Move_counter> p;
+  int result = 0;
+
+  p.get_future().finally(
+      [&](const expected<Move_counter>& v) { result = v->value; });
+
+  Move_counter::reset();
+  p.emplace_value(1, 2);
+
+  REQUIRE_EQ(3, result);
+  REQUIRE_EQ(0, Move_counter::copies);
+  REQUIRE_EQ(0, Move_counter::moves);
+}
+
+SUBCASE("emplace_value, prefilled") {
+  Promise<Move_counter> p;
+  auto f = p.get_future();
+
+  Move_counter::reset();
+  p.emplace_value(1, 2);
+
+  int result = 0;
+  f.then([&](const Move_counter& v) { result = v.value; }).get();
+
+  REQUIRE_EQ(3, result);
+  REQUIRE_EQ(0, Move_counter::copies);
+  REQUIRE_EQ(0, Move_counter::moves);
+}
+
+SUBCASE("emplace fields") {
+  Promise<int, void, std::string> p;
+  auto f = p.get_future();
+
+  p.emplace<2>(3, 'a');
+  p.emplace<1>();
+  REQUIRE(p);
+  p.emplace<0>(12);
+  REQUIRE_FALSE(p);
+
+  auto r = f.then([](int a, std::string b) { return std::to_string(a) + b; });
+  REQUIRE_EQ("12aaa", r.get());
+}
+
+SUBCASE("partially emplaced promise") {
+  std::optional<Promise<int, std::string>> p;
+  p.emplace();
+
+  expected<int> a;
+  expected<std::string> b;
+  p->get_future().finally([&](expected<int> x, expected<std::string> y) {
+    a = std::move(x);
+    b = std::move(y);
+  });
+
+  p->emplace<1>("hi");
+  p.reset();
+
+  REQUIRE_FALSE(a.has_value());
+  REQUIRE_THROWS_AS(std::rethrow_exception(a.error()), Unfullfilled_promise);
+  REQUIRE_EQ("hi", b.value());
+}
+
+SUBCASE("set_value after partial emplace") {
+  int alive = 0;
+  {
+    Promise<Counted, int> p;
+    auto f = p.get_future();
+
+    p.emplace<0>(&alive);
+    REQUIRE_EQ(1, alive);
+
+    p.set_value(Counted(&alive), 2);
+    REQUIRE_EQ(1, alive);
+
+    int b = 0;
+    f.finally([&](expected<Counted> x, expected<int> y) {
+      REQUIRE(x.has_value());
+      b = y.value();
+    });
+    REQUIRE_EQ(2, b);
+  }
+  REQUIRE_EQ(0, alive);
+}
+
+SUBCASE("throwing emplace") {
+  struct Thrower {
+    Thrower(int) { throw std::runtime_error("nope"); }
+  };
+
+  Promise<Thrower> p;
+  auto f = p.get_future();
+
+  REQUIRE_THROWS_AS(p.emplace_value(1), std::runtime_error);
+  REQUIRE(p);
+
+  p.set_exception(std::make_exception_ptr(std::logic_error("")));
+  int errors = 0;
+  f.finally([&](const expected<Thrower>& v) {
+    if (!v.has_value()) ++errors;
+  });
+  REQUIRE_EQ(1, errors);
+}
+}
@@ -0,0 +1,271 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "var_future/multicast_stream.h"
+
+#include "doctest.h"
+#include "test_queues.h"
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace aom;
+
+namespace {
+// Keeps track of how many instances exist, and how many were copied.
+struct Tracked {
+  static int alive;
+  static int copies;
+
+  explicit Tracked(int v) : value(v) { ++alive; }
+  Tracked(const Tracked& o) : value(o.value) {
+    ++alive;
+    ++copies;
+  }
+  Tracked(Tracked&& o) : value(o.value) { ++alive; }
+  ~Tracked() { --alive; }
+
+  int value;
+};
+
+int Tracked::alive = 0;
+int Tracked::copies = 0;
+}  // namespace
+
+TEST_CASE("Multicast stream") {
+SUBCASE("every subscriber sees every value") {
+  Stream_promise<int> prom;
+  Multicast_stream<int> mc(prom.get_future());
+
+  std::vector<int> a;
+  std::vector<int> b;
+  auto done_a = mc.subscribe([&](int v) { a.push_back(v); });
+  auto done_b = mc.subscribe([&](int v) { b.push_back(v); });
+
+  prom.push(1);
+  prom.push(2);
+  REQUIRE_FALSE(done_a.is_ready());
+  prom.complete();
+
+  done_a.get();
+  done_b.get();
+  REQUIRE_EQ(std::vector<int>{1, 2}, a);
+  REQUIRE_EQ(std::vector<int>{1, 2}, b);
+}
+
+SUBCASE("values are shared") {
+  Tracked::alive = 0;
+  Tracked::copies = 0;
+  {
+    Stream_promise<Tracked> prom;
+    Multicast_stream<Tracked> mc(prom.get_future());
+
+    int sum = 0;
+    std::vector<Future<void>> done;
+    for (int i = 0; i < 3; ++i) {
+      done.push_back(mc.subscribe([&](const Tracked& t) { sum += t.value; }));
+    }
+
+    for (int i = 1; i <= 10; ++i) {
+      prom.push(Tracked(i));
+    }
+
+    // Only the most recent value is retained.
+    REQUIRE_EQ(1, Tracked::alive);
+
+    prom.complete();
+    for (auto& d : done) {
+      d.get();
+    }
+
+    REQUIRE_EQ(3 * 55, sum);
+    REQUIRE_EQ(0, Tracked::copies);
+  }
+  REQUIRE_EQ(0, Tracked::alive);
+}
+
+SUBCASE("independent cursors") {
+  Stream_promise<int> prom;
+  Multicast_stream<int> mc(prom.get_future());
+
+  Manual_queue slow;
+  std::vector<int> a;
+  std::vector<int> b;
+  auto done_a = mc.subscribe([&](int v) { a.push_back(v); });
+  auto done_b = mc.subscribe(slow, [&](int v) { b.push_back(v); });
+
+  prom.push(1);
+  prom.push(2);
+  prom.push(3);
+  REQUIRE_EQ(std::vector<int>{1, 2, 3}, a);
+  REQUIRE(b.empty());
+
+  // A single task delivers everything that is available.
+  REQUIRE_EQ(1, slow.tasks.size());
+  slow.run_all();
+  REQUIRE_EQ(std::vector<int>{1, 2, 3}, b);
+
+  prom.complete();
+  done_a.get();
+  REQUIRE_FALSE(done_b.is_ready());
+  slow.run_all();
+  done_b.get();
+}
+
+SUBCASE("unsubscribe") {
+  Stream_promise<int> prom;
+  Multicast_stream<int> mc(prom.get_future());
+
+  auto token = std::make_shared<int>(0);
+  std::vector<int> a;
+  std::vector<int> b;
+  auto done_a = mc.subscribe([&, token](int v) {
+    a.push_back(v);
+    return v < 2;
+  });
+  auto done_b = mc.subscribe([&](int v) { b.push_back(v); });
+
+  prom.push(1);
+  prom.push(2);
+  REQUIRE(done_a.is_ready());
+  REQUIRE_NOTHROW(done_a.get());
+
+  // The subscriber is released once the source is done signaling.
+  REQUIRE_EQ(1, token.use_count());
+  prom.push(3);
+
+  prom.complete();
+  done_b.get();
+  REQUIRE_EQ(std::vector<int>{1, 2}, a);
+  REQUIRE_EQ(std::vector<int>{1, 2, 3}, b);
+}
+
+SUBCASE("replay history") {
+  Stream_promise<int> prom;
+  Multicast_stream<int> mc(prom.get_future(), 2);
+
+  prom.push(1);
+  prom.push(2);
+  prom.push(3);
+
+  std::vector<int> late;
+  auto done = mc.subscribe([&](int v) { late.push_back(v); });
+  REQUIRE_EQ(std::vector<int>{2, 3}, late);
+
+  prom.push(4);
+  REQUIRE_EQ(std::vector<int>{2, 3, 4}, late);
+
+  prom.complete();
+  done.get();
+
+  // Subscribing after the end replays the history and completes.
+  auto token = std::make_shared<int>(0);
+  std::vector<int> after;
+  auto done_after = mc.subscribe([&, token](int v) { after.push_back(v); });
+  REQUIRE_EQ(std::vector<int>{3, 4}, after);
+  done_after.get();
+
+  // Without waiting for an event that will never come.
+  REQUIRE_EQ(1, token.use_count());
+}
+
+SUBCASE("history larger than the stream") {
+  Stream_promise<int> prom;
+  Multicast_stream<int> mc(prom.get_future(), 10);
+
+  prom.push(1);
+  prom.push(2);
+
+  std::vector<int> late;
+  auto done = mc.subscribe([&](int v) { late.push_back(v); });
+  REQUIRE_EQ(std::vector<int>{1, 2}, late);
+  prom.complete();
+  done.get();
+}
+
+SUBCASE("source failure") {
+  Stream_promise<int> prom;
+  Multicast_stream<int> mc(prom.get_future(), 1);
+
+  auto done = mc.subscribe([&](int) {});
+  prom.push(1);
+  prom.set_exception(std::make_exception_ptr(std::runtime_error("nope")));
+
+  REQUIRE_THROWS_AS(done.get(), std::runtime_error);
+
+  int seen = 0;
+  auto late = mc.subscribe([&](int v) { seen = v; });
+  REQUIRE_EQ(1, seen);
+  REQUIRE_THROWS_AS(late.get(), std::runtime_error);
+}
+
+SUBCASE("callback failure") {
+  Stream_promise<int> prom;
+  Multicast_stream<int> mc(prom.get_future());
+
+  int count = 0;
+  auto failing = mc.subscribe([&](int) {
+    ++count;
+    throw std::runtime_error("nope");
+  });
+  std::vector<int> other;
+  auto fine = mc.subscribe([&](int v) { other.push_back(v); });
+
+  prom.push(1);
+  prom.push(2);
+  prom.complete();
+
+  REQUIRE_THROWS_AS(failing.get(), std::runtime_error);
+  REQUIRE_EQ(1, count);
+  fine.get();
+  REQUIRE_EQ(std::vector<int>{1, 2}, other);
+}
+
+SUBCASE("concurrent subscribers") {
+  Stream_promise<int> prom;
+  Multicast_stream<int> mc(prom.get_future(), 4);
+
+  Thread_pool pool(4);
+  std::atomic<long long> total = 0;
+  std::atomic<bool> out_of_order = false;
+  std::vector<Future<void>> done;
+
+  std::thread producer([&] {
+    for (int i = 1; i <= 1000; ++i) {
+      prom.push(i);
+    }
+    prom.complete();
+  });
+
+  for (int i = 0; i < 8; ++i) {
+    done.push_back(mc.subscribe(pool, [&, last = 0](int v) mutable {
+      if (v <= last) {
+        out_of_order = true;
+      }
+      last = v;
+      total += v;
+    }));
+  }
+
+  producer.join();
+  for (auto& d : done) {
+    d.get();
+  }
+  REQUIRE_FALSE(out_of_order.load());
+  REQUIRE_GT(total.load(), 0);
+}
+}
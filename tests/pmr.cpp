@@ -0,0 +1,134 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include "var_future/future.h"
+#include "var_future/stream_future.h"
+
+#include "doctest.h"
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+
+using namespace aom;
+
+namespace {
+std::atomic<bool> tracking = false;
+std::atomic<int> global_allocs = 0;
+
+// Counts global heap allocations made between construction and destruction.
+struct Heap_tracker {
+  Heap_tracker() {
+    global_allocs = 0;
+    tracking = true;
+  }
+
+  ~Heap_tracker() { tracking = false; }
+};
+}  // namespace
+
+void* operator new(std::size_t size) {
+  if (tracking) {
+    ++global_allocs;
+  }
+
+  if (void* result = std::malloc(size == 0 ? 1 : size)) {
+    return result;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+TEST_CASE("Futures with polymorphic allocators") {
+SUBCASE("then and join graph within an arena") {
+  std::array<std::byte, 8192> buffer;
+  int result = 0;
+
+  {
+    // Running out of room in the buffer would throw instead of falling back
+    // to the heap.
+    std::pmr::monotonic_buffer_resource arena(
+        buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+    Heap_tracker tracker;
+
+    pmr::Promise<int> p_a(&arena);
+    pmr::Promise<int> p_b(&arena);
+
+    auto fut_a = p_a.get_future().then([](int v) { return v * 2; });
+    auto fut_b = p_b.get_future().then_expect(
+        [](const expected<int>& v) { return v.value() + 1; });
+
+    pmr::Future<int, int> joined = join(fut_a, fut_b);
+
+    joined.then([](int a, int b) { return a + b; })
+        .finally([&](expected<int> v) { result = v.value(); });
+
+    p_b.set_value(4);
+    p_a.set_value(3);
+
+    REQUIRE_EQ(0, global_allocs);
+  }
+
+  REQUIRE_EQ(11, result);
+}
+
+SUBCASE("futures share the resource of their source") {
+  std::pmr::unsynchronized_pool_resource pool;
+  pmr::Promise<int> p(&pool);
+
+  auto fut = p.get_future().then([](int v) { return v; });
+  REQUIRE_EQ(&pool, fut.allocator().resource());
+
+  p.set_value(1);
+  REQUIRE_EQ(1, fut.get());
+}
+
+SUBCASE("merged streams within an arena") {
+  using alloc_type = std::pmr::polymorphic_allocator<std::byte>;
+
+  std::array<std::byte, 8192> buffer;
+  int total = 0;
+  bool completed = false;
+
+  {
+    std::pmr::monotonic_buffer_resource arena(
+        buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+    Heap_tracker tracker;
+
+    Basic_stream_promise<alloc_type, int> a;
+    Basic_stream_promise<alloc_type, int> b;
+
+    merge(a.get_future(&arena), b.get_future(&arena))
+        .for_each([&](int v) { total += v; })
+        .finally([&](expected<void> r) { completed = r.has_value(); });
+
+    a.push(1);
+    b.push(2);
+    a.push(3);
+    a.complete();
+    b.push(4);
+    b.complete();
+
+    REQUIRE_EQ(0, global_allocs);
+  }
+
+  REQUIRE(completed);
+  REQUIRE_EQ(10, total);
+}
+}
@@ -0,0 +1,120 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include "var_future/future.h"
+#include "var_future/priority_queue.h"
+
+#include "doctest.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace aom;
+
+TEST_CASE("Priority queue") {
+SUBCASE("higher priorities go first") {
+  Priority_queue queue(3);
+  std::vector<int> order;
+
+  queue.with_priority(2).push([&] { order.push_back(2); });
+  queue.push([&] { order.push_back(1); });
+  queue.with_priority(0).push([&] { order.push_back(0); });
+  queue.with_priority(0).push([&] { order.push_back(3); });
+
+  REQUIRE_EQ(4, queue.size());
+  while (queue.try_run_one()) {
+  }
+
+  REQUIRE_EQ(std::vector<int>{0, 3, 1, 2}, order);
+}
+
+SUBCASE("aging") {
+  Priority_queue queue(2, 4);
+  std::vector<int> order;
+
+  queue.with_priority(1).push([&] { order.push_back(1); });
+  for (int i = 0; i < 10; ++i) {
+    queue.with_priority(0).push([&] { order.push_back(0); });
+  }
+
+  while (queue.try_run_one()) {
+  }
+
+  // The low priority task was passed over 4 times.
+  REQUIRE_EQ(std::vector<int>{0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0}, order);
+}
+
+SUBCASE("continuations") {
+  Priority_queue queue(3);
+  std::vector<int> order;
+
+  Promise<int> p;
+  auto f = p.get_future();
+
+  auto background =
+      f.then(queue.with_priority(2), [&](int v) { order.push_back(v); });
+  auto critical = async(queue.with_priority(0), [&] { order.push_back(0); });
+
+  p.set_value(2);
+  while (queue.try_run_one()) {
+  }
+
+  REQUIRE_EQ(std::vector<int>{0, 2}, order);
+  background.get();
+  critical.get();
+}
+
+SUBCASE("move-only continuations") {
+  Priority_queue queue(3);
+
+  Promise<int> p;
+  auto f = p.get_future().then(
+      queue.with_priority(0),
+      [u = std::make_unique<int>(1)](int v) { return v + *u; });
+
+  p.set_value(2);
+  while (queue.try_run_one()) {
+  }
+
+  REQUIRE_EQ(3, f.get());
+}
+
+SUBCASE("workers") {
+  Priority_queue queue;
+  std::vector<std::thread> workers;
+  for (int i = 0; i < 4; ++i) {
+    workers.emplace_back([&] {
+      while (queue.run_one()) {
+      }
+    });
+  }
+
+  std::vector<Future<int>> futures;
+  for (int i = 0; i < 1000; ++i) {
+    futures.push_back(
+        async(queue.with_priority(std::size_t(i) % 3), [i] { return i; }));
+  }
+
+  for (int i = 0; i < 1000; ++i) {
+    REQUIRE_EQ(i, futures[i].get());
+  }
+
+  queue.stop();
+  for (auto& w : workers) {
+    w.join();
+  }
+}
+}
@@ -0,0 +1,228 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "var_future/retry.h"
+
+#include "doctest.h"
+#include "test_queues.h"
+
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+using namespace aom;
+using namespace std::chrono_literals;
+
+namespace {
+struct Inline_queue {
+  void push(std::function<void()> cb) {
+    ++push_count;
+    cb();
+  }
+
+  int push_count = 0;
+};
+
+struct Transient_error : std::runtime_error {
+  Transient_error() : std::runtime_error("transient") {}
+};
+}  // namespace
+
+TEST_CASE("Retry policy delays") {
+  Retry_policy policy;
+  policy.initial_delay = 100ms;
+  policy.multiplier = 2.0;
+  policy.max_delay = 1s;
+  policy.jitter = 0.5;
+
+  REQUIRE_EQ(policy.delay(1, 0.0), 100ms);
+  REQUIRE_EQ(policy.delay(2, 0.0), 200ms);
+  REQUIRE_EQ(policy.delay(3, 0.0), 400ms);
+  REQUIRE_EQ(policy.delay(5, 0.0), 1s);
+  REQUIRE_EQ(policy.delay(2, 1.0), 100ms);
+}
+
+TEST_CASE("Retry") {
+  Inline_queue queue;
+  Manual_timer timer;
+
+  Retry_policy policy;
+  policy.max_attempts = 4;
+  policy.jitter = 0.0;
+
+SUBCASE("success on first attempt") {
+  int calls = 0;
+  auto fut = retry(queue, timer, policy, [&] {
+    ++calls;
+    Promise<int> p;
+    p.set_value(12);
+    return p.get_future();
+  });
+
+  REQUIRE_EQ(12, fut.get());
+  REQUIRE_EQ(1, calls);
+  REQUIRE(timer.delays.empty());
+}
+
+SUBCASE("success after failures") {
+  int calls = 0;
+  auto fut = retry(queue, timer, policy, [&] {
+    Promise<int> p;
+    if (++calls < 3) {
+      p.set_exception(std::make_exception_ptr(Transient_error()));
+    } else {
+      p.set_value(calls);
+    }
+    return p.get_future();
+  });
+
+  timer.run();
+  REQUIRE_EQ(3, fut.get());
+  REQUIRE_EQ(3, calls);
+  REQUIRE_EQ(std::vector<std::chrono::steady_clock::duration>{100ms, 200ms},
+             timer.delays);
+}
+
+SUBCASE("gives up after max attempts") {
+  int calls = 0;
+  auto fut = retry(queue, timer, policy, [&]() -> Future<int> {
+    ++calls;
+    throw Transient_error();
+  });
+
+  timer.run();
+  REQUIRE_THROWS_AS(fut.get(), Transient_error);
+  REQUIRE_EQ(4, calls);
+  REQUIRE_EQ(4, queue.push_count);
+  REQUIRE_EQ(3, timer.delays.size());
+}
+
+SUBCASE("only retries matching errors") {
+  policy.retry_if = [](const std::exception_ptr& e) {
+    try {
+      std::rethrow_exception(e);
+    } catch (const Transient_error&) {
+      return true;
+    } catch (...) {
+      return false;
+    }
+  };
+
+  int calls = 0;
+  auto fut = retry(queue, timer, policy, [&] {
+    Promise<void> p;
+    if (++calls == 1) {
+      p.set_exception(std::make_exception_ptr(Transient_error()));
+    } else {
+      p.set_exception(std::make_exception_ptr(std::logic_error("fatal")));
+    }
+    return p.get_future();
+  });
+
+  timer.run();
+  REQUIRE_THROWS_AS(fut.get(), std::logic_error);
+  REQUIRE_EQ(2, calls);
+}
+
+SUBCASE("throwing retry_if") {
+  policy.retry_if = [](const std::exception_ptr&) -> bool {
+    throw std::logic_error("retry_if");
+  };
+
+  int calls = 0;
+  auto fut = retry(queue, timer, policy, [&] {
+    ++calls;
+    Promise<int> p;
+    p.set_exception(std::make_exception_ptr(Transient_error()));
+    return p.get_future();
+  });
+
+  REQUIRE_THROWS_AS(fut.get(), std::logic_error);
+  REQUIRE_EQ(1, calls);
+  REQUIRE_EQ(0, timer.pending());
+}
+
+SUBCASE("throwing retry_if on a pending attempt") {
+  policy.retry_if = [](const std::exception_ptr&) -> bool {
+    throw std::logic_error("retry_if");
+  };
+
+  Promise<int> attempt;
+  auto fut = retry(queue, timer, policy, [&] { return attempt.get_future(); });
+
+  REQUIRE_NOTHROW(
+      attempt.set_exception(std::make_exception_ptr(Transient_error())));
+  REQUIRE_THROWS_AS(fut.get(), std::logic_error);
+}
+
+SUBCASE("throwing timer") {
+  struct Failing_timer {
+    void schedule(std::chrono::steady_clock::duration, std::function<void()>) {
+      throw std::out_of_range("timer");
+    }
+  } failing_timer;
+
+  auto fut = retry(queue, failing_timer, policy, [&] {
+    Promise<int> p;
+    p.set_exception(std::make_exception_ptr(Transient_error()));
+    return p.get_future();
+  });
+
+  REQUIRE_THROWS_AS(fut.get(), std::out_of_range);
+}
+
+SUBCASE("throwing queue on a retry") {
+  struct Failing_queue {
+    void push(std::function<void()> cb) {
+      if (++push_count > 1) {
+        throw std::length_error("queue");
+      }
+      cb();
+    }
+
+    int push_count = 0;
+  } failing_queue;
+
+  auto fut = retry(failing_queue, timer, policy, [&] {
+    Promise<int> p;
+    p.set_exception(std::make_exception_ptr(Transient_error()));
+    return p.get_future();
+  });
+
+  REQUIRE_NOTHROW(timer.run());
+  REQUIRE_THROWS_AS(fut.get(), std::length_error);
+  REQUIRE_EQ(2, failing_queue.push_count);
+}
+
+SUBCASE("pending attempts") {
+  std::vector<Promise<int, float>> attempts;
+  auto fut = retry(queue, timer, policy, [&] {
+    attempts.emplace_back();
+    return attempts.back().get_future();
+  });
+
+  REQUIRE_EQ(1, attempts.size());
+  attempts[0].set_exception(std::make_exception_ptr(Transient_error()));
+  REQUIRE_EQ(1, timer.pending());
+
+  timer.run();
+  REQUIRE_EQ(2, attempts.size());
+  attempts[1].set_value(1, 2.0f);
+
+  auto [a, b] = fut.get();
+  REQUIRE_EQ(1, a);
+  REQUIRE_EQ(2.0f, b);
+}
+}
@@ -19,6 +19,7 @@
 
 #include <queue>
 #include <random>
+#include <thread>
 
 using namespace aom;
 
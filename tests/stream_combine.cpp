@@ -0,0 +1,221 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "var_future/stream_future.h"
+
+#include "doctest.h"
+
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace aom;
+
+TEST_CASE("Merging streams") {
+SUBCASE("interleaves values") {
+  Stream_promise<int> a;
+  Stream_promise<int> b;
+
+  std::vector<int> result;
+  auto done = merge(a.get_future(), b.get_future()).for_each([&](int v) {
+    result.push_back(v);
+  });
+
+  a.push(1);
+  b.push(2);
+  a.push(3);
+  a.complete();
+  REQUIRE_FALSE(done.is_ready());
+
+  b.push(4);
+  b.complete();
+  done.get();
+
+  REQUIRE_EQ(std::vector<int>{1, 2, 3, 4}, result);
+}
+
+SUBCASE("values pushed before merging") {
+  Stream_promise<int> a;
+  Stream_promise<int> b;
+  auto fa = a.get_future();
+  auto fb = b.get_future();
+
+  a.push(1);
+  a.complete();
+  b.push(2);
+
+  int total = 0;
+  auto done = merge(std::move(fa), std::move(fb)).for_each([&](int v) {
+    total += v;
+  });
+
+  b.complete();
+  done.get();
+  REQUIRE_EQ(3, total);
+}
+
+SUBCASE("fails on first failure") {
+  Stream_promise<int> a;
+  Stream_promise<int> b;
+
+  auto done = merge(a.get_future(), b.get_future()).for_each([&](int) {});
+
+  a.push(1);
+  b.set_exception(std::make_exception_ptr(std::runtime_error("")));
+  REQUIRE_THROWS_AS(done.get(), std::runtime_error);
+
+  a.push(2);
+  a.complete();
+}
+
+SUBCASE("from many threads") {
+  constexpr int per_source = 10000;
+  constexpr int sources = 4;
+
+  std::vector<Stream_promise<int, int>> proms(sources);
+  std::vector<Stream_future<int, int>> futs;
+  for (auto& p : proms) {
+    futs.push_back(p.get_future());
+  }
+
+  std::vector<int> last(sources, -1);
+  bool in_order = true;
+  int count = 0;
+  auto done = merge(std::move(futs[0]), std::move(futs[1]), std::move(futs[2]),
+                    std::move(futs[3]))
+                  .for_each([&](int src, int v) {
+                    in_order = in_order && v == last[src] + 1;
+                    last[src] = v;
+                    ++count;
+                  });
+
+  std::vector<std::thread> threads;
+  for (int s = 0; s < sources; ++s) {
+    threads.emplace_back([&, s] {
+      for (int i = 0; i < per_source; ++i) {
+        proms[s].push(s, i);
+      }
+      proms[s].complete();
+    });
+  }
+
+  done.get();
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  REQUIRE(in_order);
+  REQUIRE_EQ(sources * per_source, count);
+}
+}
+
+TEST_CASE("Zipping streams") {
+SUBCASE("pairs values by index") {
+  Stream_promise<int> a;
+  Stream_promise<std::string, float> b;
+
+  std::vector<std::string> result;
+  auto done = zip(a.get_future(), b.get_future())
+                  .for_each([&](int i, std::string s, float f) {
+                    result.push_back(std::to_string(i) + s +
+                                     std::to_string(int(f)));
+                  });
+
+  a.push(1);
+  a.push(2);
+  REQUIRE(result.empty());
+
+  b.push("a", 3.0f);
+  REQUIRE_EQ(std::vector<std::string>{"1a3"}, result);
+
+  b.push("b", 4.0f);
+  a.complete();
+  b.complete();
+  done.get();
+
+  REQUIRE_EQ(std::vector<std::string>{"1a3", "2b4"}, result);
+}
+
+SUBCASE("ends with the shortest stream") {
+  Stream_promise<int> a;
+  Stream_promise<int> b;
+
+  int count = 0;
+  auto done = zip(a.get_future(), b.get_future()).for_each([&](int, int) {
+    ++count;
+  });
+
+  a.push(1);
+  a.complete();
+  REQUIRE_FALSE(done.is_ready());
+
+  b.push(1);
+  REQUIRE(done.is_ready());
+  b.push(2);
+
+  done.get();
+  REQUIRE_EQ(1, count);
+}
+
+SUBCASE("fails on first failure") {
+  Stream_promise<int> a;
+  Stream_promise<int> b;
+
+  auto done = zip(a.get_future(), b.get_future()).for_each([&](int, int) {});
+
+  a.push(1);
+  b.set_exception(std::make_exception_ptr(std::runtime_error("")));
+  REQUIRE_THROWS_AS(done.get(), std::runtime_error);
+  a.complete();
+}
+
+SUBCASE("from many threads") {
+  constexpr int count = 20000;
+
+  Stream_promise<int> a;
+  Stream_promise<int> b;
+  Stream_promise<int> c;
+
+  bool matched = true;
+  int seen = 0;
+  auto done = zip(a.get_future(), b.get_future(), c.get_future())
+                  .for_each([&](int x, int y, int z) {
+                    matched = matched && x == seen && y == seen && z == seen;
+                    ++seen;
+                  });
+
+  auto produce = [&](Stream_promise<int>& p) {
+    return std::thread([&] {
+      for (int i = 0; i < count; ++i) {
+        p.push(i);
+      }
+      p.complete();
+    });
+  };
+
+  auto ta = produce(a);
+  auto tb = produce(b);
+  auto tc = produce(c);
+
+  done.get();
+  ta.join();
+  tb.join();
+  tc.join();
+
+  REQUIRE(matched);
+  REQUIRE_EQ(count, seen);
+}
+}
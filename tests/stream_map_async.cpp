@@ -0,0 +1,214 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "var_future/stream_future.h"
+
+#include "doctest.h"
+#include "test_queues.h"
+
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace aom;
+
+TEST_CASE("Stream map_async") {
+SUBCASE("ordered") {
+  Manual_queue queue;
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  std::vector<int> result;
+  auto done = fut.map_async(queue, 2, [](int v) { return v * 10; })
+                  .for_each([&](int v) { result.push_back(v); });
+
+  prom.push(1);
+  prom.push(2);
+  prom.push(3);
+  prom.complete();
+
+  // Only two values are in flight.
+  REQUIRE_EQ(2, queue.tasks.size());
+
+  // The second one finishes first, but has to wait for the first.
+  queue.run(1);
+  REQUIRE(result.empty());
+  REQUIRE_EQ(1, queue.tasks.size());
+
+  queue.run(0);
+  REQUIRE_EQ(std::vector<int>{10, 20}, result);
+  REQUIRE_EQ(1, queue.tasks.size());
+  REQUIRE_FALSE(done.is_ready());
+
+  queue.run(0);
+  REQUIRE_EQ(std::vector<int>{10, 20, 30}, result);
+  done.get();
+}
+
+SUBCASE("unordered") {
+  Manual_queue queue;
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  std::vector<int> result;
+  auto done = fut.map_async(queue, 2, [](int v) { return v * 10; },
+                            Stream_order::unordered)
+                  .for_each([&](int v) { result.push_back(v); });
+
+  prom.push(1);
+  prom.push(2);
+  prom.push(3);
+  prom.complete();
+
+  queue.run(1);
+  REQUIRE_EQ(std::vector<int>{20}, result);
+  REQUIRE_EQ(2, queue.tasks.size());
+
+  queue.run(1);
+  REQUIRE_EQ(std::vector<int>{20, 30}, result);
+
+  queue.run(0);
+  REQUIRE_EQ(std::vector<int>{20, 30, 10}, result);
+  done.get();
+}
+
+SUBCASE("after other stages") {
+  Manual_queue queue;
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  prom.push(1);
+  prom.push(2);
+  prom.push(3);
+
+  std::vector<int> result;
+  auto done = fut.filter([](int v) { return v != 2; })
+                  .map_async(queue, 8, [](int v) { return v + 1; })
+                  .for_each([&](int v) { result.push_back(v); });
+
+  prom.complete();
+  REQUIRE_EQ(2, queue.tasks.size());
+  queue.run(0);
+  queue.run(0);
+
+  REQUIRE_EQ(std::vector<int>{2, 4}, result);
+  done.get();
+}
+
+SUBCASE("callback failure") {
+  Manual_queue queue;
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  auto done = fut.map_async(queue, 2,
+                            [](int v) {
+                              if (v == 2) {
+                                throw std::runtime_error("nope");
+                              }
+                              return v;
+                            })
+                  .for_each([&](int) {});
+
+  prom.push(1);
+  prom.push(2);
+  prom.push(3);
+  queue.run(1);
+
+  REQUIRE_THROWS_AS(done.get(), std::runtime_error);
+
+  // Whatever was still in flight is ignored, and nothing else is launched.
+  queue.run(0);
+  prom.push(4);
+  REQUIRE(queue.tasks.empty());
+  prom.complete();
+}
+
+SUBCASE("throwing queue") {
+  struct Throwing_queue {
+    void push(std::function<void()>) { throw std::length_error("full"); }
+  } queue;
+
+  Stream_promise<int> prom;
+  std::vector<int> result;
+  auto done = prom.get_future()
+                  .map_async(queue, 2, [](int v) { return v * 10; })
+                  .for_each([&](int v) { result.push_back(v); });
+
+  REQUIRE_NOTHROW(prom.push(1));
+  REQUIRE_THROWS_AS(done.get(), std::length_error);
+
+  // Later values are dropped instead of being stuck behind a drainer.
+  REQUIRE_NOTHROW(prom.push(2));
+  prom.complete();
+  REQUIRE(result.empty());
+}
+
+SUBCASE("source failure waits for values in flight") {
+  Manual_queue queue;
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  std::vector<int> result;
+  auto done = fut.map_async(queue, 2, [](int v) { return v; })
+                  .for_each([&](int v) { result.push_back(v); });
+
+  prom.push(1);
+  prom.set_exception(std::make_exception_ptr(std::logic_error("")));
+  REQUIRE_FALSE(done.is_ready());
+
+  queue.run(0);
+  REQUIRE_EQ(std::vector<int>{1}, result);
+  REQUIRE_THROWS_AS(done.get(), std::logic_error);
+}
+
+SUBCASE("thread pool") {
+  constexpr int count = 5000;
+  constexpr std::size_t limit = 4;
+
+  Thread_pool pool(4);
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  std::atomic<std::size_t> running = 0;
+  std::atomic<std::size_t> peak = 0;
+
+  std::vector<int> result;
+  auto done = fut.map_async(pool, limit,
+                            [&](int v) {
+                              auto now = running.fetch_add(1) + 1;
+                              auto prev = peak.load();
+                              while (prev < now &&
+                                     !peak.compare_exchange_weak(prev, now)) {
+                              }
+                              running.fetch_sub(1);
+                              return v * 2;
+                            })
+                  .for_each([&](int v) { result.push_back(v); });
+
+  for (int i = 0; i < count; ++i) {
+    prom.push(i);
+  }
+  prom.complete();
+  done.get();
+
+  REQUIRE_EQ(count, result.size());
+  for (int i = 0; i < count; ++i) {
+    REQUIRE_EQ(i * 2, result[i]);
+  }
+  REQUIRE(peak.load() <= limit);
+}
+}
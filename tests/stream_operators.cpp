@@ -0,0 +1,232 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "var_future/stream_future.h"
+
+#include "doctest.h"
+
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+using namespace aom;
+
+TEST_CASE("Stream operators") {
+SUBCASE("map") {
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  std::vector<std::string> result;
+  auto done = fut.map([](int v) { return std::to_string(v); })
+                  .for_each([&](std::string v) { result.push_back(v); });
+
+  prom.push(1);
+  prom.push(2);
+  prom.complete();
+  done.get();
+
+  REQUIRE_EQ(std::vector<std::string>{"1", "2"}, result);
+}
+
+SUBCASE("map of multiple fields") {
+  Stream_promise<int, float> prom;
+  auto fut = prom.get_future();
+
+  float total = 0.0f;
+  auto done = fut.map([](int a, float b) { return a * b; })
+                  .for_each([&](float v) { total += v; });
+
+  prom.push(2, 1.5f);
+  prom.push(1, 1.0f);
+  prom.complete();
+  done.get();
+
+  REQUIRE_EQ(4.0f, total);
+}
+
+SUBCASE("filter") {
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  std::vector<int> result;
+  auto done = fut.filter([](int v) { return v % 2 == 0; })
+                  .for_each([&](int v) { result.push_back(v); });
+
+  for (int i = 0; i < 6; ++i) {
+    prom.push(i);
+  }
+  prom.complete();
+  done.get();
+
+  REQUIRE_EQ(std::vector<int>{0, 2, 4}, result);
+}
+
+SUBCASE("take") {
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  std::vector<int> result;
+  auto done = fut.take(2).for_each([&](int v) { result.push_back(v); });
+
+  prom.push(1);
+  REQUIRE_FALSE(done.is_ready());
+  prom.push(2);
+  REQUIRE(done.is_ready());
+
+  // The producer is unaware that the consumer is gone.
+  prom.push(3);
+  prom.complete();
+
+  done.get();
+  REQUIRE_EQ(std::vector<int>{1, 2}, result);
+}
+
+SUBCASE("take before values arrive") {
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  prom.push(1);
+  prom.push(2);
+  prom.push(3);
+
+  std::vector<int> result;
+  auto done = fut.take(2).for_each([&](int v) { result.push_back(v); });
+  done.get();
+
+  REQUIRE_EQ(std::vector<int>{1, 2}, result);
+}
+
+SUBCASE("take nothing") {
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  bool called = false;
+  auto done = fut.take(0).for_each([&](int) { called = true; });
+  REQUIRE(done.is_ready());
+
+  prom.push(1);
+  done.get();
+  REQUIRE_FALSE(called);
+}
+
+SUBCASE("take ignores late failures") {
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  auto done = fut.take(1).for_each([&](int) {});
+  prom.push(1);
+  prom.set_exception(std::make_exception_ptr(std::runtime_error("")));
+
+  done.get();
+}
+
+SUBCASE("scan") {
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  std::vector<int> result;
+  auto done = fut.scan(10, [](int acc, int v) { return acc + v; })
+                  .for_each([&](int v) { result.push_back(v); });
+
+  prom.push(1);
+  prom.push(2);
+  prom.push(3);
+  prom.complete();
+  done.get();
+
+  REQUIRE_EQ(std::vector<int>{11, 13, 16}, result);
+}
+
+SUBCASE("fused pipeline") {
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  std::vector<int> result;
+  auto done = fut.map([](int v) { return v * 2; })
+                  .filter([](int v) { return v % 4 == 0; })
+                  .scan(0, [](int acc, int v) { return acc + v; })
+                  .take(3)
+                  .for_each([&](int v) { result.push_back(v); });
+
+  for (int i = 0; i < 100; ++i) {
+    prom.push(i);
+  }
+
+  done.get();
+  REQUIRE_EQ(std::vector<int>{0, 4, 12}, result);
+}
+
+SUBCASE("move-only values") {
+  Stream_promise<std::unique_ptr<int>> prom;
+  auto fut = prom.get_future();
+
+  prom.push(std::make_unique<int>(1));
+
+  int total = 0;
+  auto done = fut.filter([](const std::unique_ptr<int>& v) { return *v > 0; })
+                  .map([](std::unique_ptr<int> v) { return *v * 3; })
+                  .for_each([&](int v) { total += v; });
+
+  prom.push(std::make_unique<int>(-1));
+  prom.push(std::make_unique<int>(2));
+  prom.complete();
+  done.get();
+
+  REQUIRE_EQ(9, total);
+}
+
+SUBCASE("failure") {
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  int total = 0;
+  auto done = fut.map([](int v) { return v + 1; })
+                  .for_each([&](int v) { total += v; });
+
+  prom.push(1);
+  prom.set_exception(std::make_exception_ptr(std::runtime_error("")));
+
+  REQUIRE_THROWS_AS(done.get(), std::runtime_error);
+  REQUIRE_EQ(2, total);
+}
+
+SUBCASE("only the output is queued") {
+  std::queue<std::function<void()>> queue;
+
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  int total = 0;
+  auto done = fut.filter([](int v) { return v > 1; })
+                  .for_each(queue, [&](int v) { total += v; });
+
+  prom.push(1);
+  prom.push(2);
+  prom.push(3);
+  prom.complete();
+
+  // Two values, and the completion.
+  REQUIRE_EQ(3, queue.size());
+  while (!queue.empty()) {
+    queue.front()();
+    queue.pop();
+  }
+
+  REQUIRE_EQ(5, total);
+  done.get();
+}
+}
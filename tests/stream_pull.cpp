@@ -0,0 +1,169 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "var_future/stream_future.h"
+
+#include "doctest.h"
+
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+
+using namespace aom;
+
+TEST_CASE("Stream iterator") {
+SUBCASE("values pushed ahead") {
+  Stream_promise<int> prom;
+  auto it = prom.get_future().begin_async();
+
+  prom.push(1);
+  prom.push(2);
+  prom.complete();
+
+  REQUIRE_EQ(std::make_tuple(1), it.next().get().value());
+  REQUIRE_EQ(std::make_tuple(2), it.next().get().value());
+  REQUIRE_FALSE(it.next().get());
+  REQUIRE_FALSE(it.next().get());
+}
+
+SUBCASE("values pushed before iterating") {
+  Stream_promise<int, std::string> prom;
+  auto fut = prom.get_future();
+  prom.push(1, "a");
+
+  auto it = fut.begin_async();
+  prom.push(2, "b");
+
+  REQUIRE_EQ(std::make_tuple(1, std::string("a")), *it.next().get());
+  REQUIRE_EQ(std::make_tuple(2, std::string("b")), *it.next().get());
+
+  auto last = it.next();
+  REQUIRE_FALSE(last.is_ready());
+  prom.complete();
+  REQUIRE_FALSE(last.get());
+}
+
+SUBCASE("pending request") {
+  Stream_promise<int> prom;
+  auto it = prom.get_future().begin_async();
+
+  auto v = it.next();
+  REQUIRE_FALSE(v.is_ready());
+
+  prom.push(3);
+  REQUIRE(v.is_ready());
+  REQUIRE_EQ(std::make_tuple(3), v.get().value());
+}
+
+SUBCASE("failure") {
+  Stream_promise<int> prom;
+  auto it = prom.get_future().begin_async();
+
+  prom.push(1);
+  auto first = it.next();
+  auto second = it.next();
+  prom.set_exception(std::make_exception_ptr(std::runtime_error("nope")));
+
+  REQUIRE_EQ(std::make_tuple(1), first.get().value());
+  REQUIRE_THROWS_AS(second.get(), std::runtime_error);
+  REQUIRE_THROWS_AS(it.next().get(), std::runtime_error);
+}
+
+SUBCASE("demand") {
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+  REQUIRE_EQ(0, prom.demand());
+
+  auto it = fut.begin_async();
+  REQUIRE_EQ(0, prom.demand());
+
+  auto demanded = prom.when_demanded();
+  REQUIRE_FALSE(demanded.is_ready());
+
+  auto v = it.next();
+  REQUIRE_EQ(1, prom.demand());
+  REQUIRE(demanded.is_ready());
+
+  prom.push(1);
+  REQUIRE_EQ(0, prom.demand());
+  v.get();
+
+  // Announced values are only counted once.
+  it.request(2);
+  REQUIRE_EQ(2, prom.demand());
+  auto w = it.next();
+  REQUIRE_EQ(2, prom.demand());
+  prom.push(2);
+  REQUIRE_EQ(1, prom.demand());
+  w.get();
+
+  prom.push(3);
+  REQUIRE_EQ(0, prom.demand());
+  REQUIRE_EQ(std::make_tuple(3), it.next().get().value());
+}
+
+SUBCASE("demand of push consumers is unbounded") {
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  auto demanded = prom.when_demanded();
+  REQUIRE_FALSE(demanded.is_ready());
+
+  auto done = fut.for_each([](int) {});
+  REQUIRE(demanded.is_ready());
+  REQUIRE_EQ(std::numeric_limits<std::size_t>::max(), prom.demand());
+  prom.complete();
+  done.get();
+}
+
+SUBCASE("abandoned iterator") {
+  Stream_promise<int> prom;
+  {
+    auto it = prom.get_future().begin_async();
+    prom.push(1);
+  }
+
+  REQUIRE_EQ(std::numeric_limits<std::size_t>::max(), prom.demand());
+  prom.push(2);
+  prom.complete();
+}
+
+SUBCASE("paced producer") {
+  Stream_promise<int> prom;
+  auto it = prom.get_future().begin_async();
+
+  bool ran_ahead = false;
+  std::thread producer([&] {
+    for (int i = 0; i < 100; ++i) {
+      prom.when_demanded().get();
+      if (prom.demand() == 0) {
+        ran_ahead = true;
+      }
+      prom.push(i);
+    }
+    prom.complete();
+  });
+
+  int expected_value = 0;
+  while (auto v = it.next().get()) {
+    REQUIRE_EQ(expected_value++, std::get<0>(*v));
+  }
+  REQUIRE_EQ(100, expected_value);
+  producer.join();
+  REQUIRE_FALSE(ran_ahead);
+}
+}
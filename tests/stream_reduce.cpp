@@ -0,0 +1,260 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "var_future/stream_future.h"
+
+#include "doctest.h"
+#include "test_queues.h"
+
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+using namespace aom;
+
+namespace {
+int add(int a, int b) { return a + b; }
+
+// Rejects a push when told to.
+struct Flaky_queue : public Manual_queue {
+  void push(std::function<void()> cb) {
+    if (reject) {
+      reject = false;
+      throw std::length_error("full");
+    }
+    Manual_queue::push(std::move(cb));
+  }
+
+  bool reject = false;
+};
+}  // namespace
+
+TEST_CASE("Stream reduce") {
+SUBCASE("single thread") {
+  Manual_queue queue;
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  auto sum = fut.reduce(queue, 0, add, add);
+
+  prom.push(1);
+  prom.push(2);
+  prom.push(3);
+  prom.complete();
+
+  REQUIRE_FALSE(sum.is_ready());
+  queue.run_all();
+  REQUIRE_EQ(6, sum.get());
+}
+
+SUBCASE("empty stream") {
+  Manual_queue queue;
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  auto sum = fut.reduce(queue, 0, add, add);
+  prom.complete();
+  REQUIRE_EQ(0, sum.get());
+}
+
+SUBCASE("different accumulator type") {
+  Manual_queue queue;
+  Stream_promise<int, std::string> prom;
+  auto fut = prom.get_future();
+
+  auto total = fut.reduce(
+      queue, std::size_t(0),
+      [](std::size_t acc, int n, const std::string& s) {
+        return acc + n * s.size();
+      },
+      [](std::size_t a, std::size_t b) { return a + b; });
+
+  prom.push(2, "abc");
+  prom.push(3, "de");
+  prom.complete();
+  queue.run_all();
+  REQUIRE_EQ(12, total.get());
+}
+
+SUBCASE("after other stages") {
+  Manual_queue queue;
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  auto sum = fut.filter([](int v) { return v % 2 == 0; })
+                 .map([](int v) { return v * 10; })
+                 .take(2)
+                 .reduce(queue, 0, add, add);
+
+  for (int i = 0; i < 10; ++i) {
+    prom.push(i);
+  }
+  queue.run_all();
+  REQUIRE_EQ(20, sum.get());
+}
+
+SUBCASE("concurrent") {
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+  Future<long long> sum;
+
+  {
+    Thread_pool pool(4);
+    sum = fut.reduce(
+        pool, 0LL, [](long long acc, int v) { return acc + v; },
+        [](long long a, long long b) { return a + b; });
+
+    for (int i = 1; i <= 10000; ++i) {
+      prom.push(i);
+    }
+    prom.complete();
+
+    REQUIRE_EQ(50005000LL, sum.get());
+  }
+}
+
+SUBCASE("op failure") {
+  Manual_queue queue;
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  auto sum = fut.reduce(
+      queue, 0,
+      [](int acc, int v) {
+        if (v == 2) {
+          throw std::runtime_error("nope");
+        }
+        return acc + v;
+      },
+      add);
+
+  prom.push(1);
+  prom.push(2);
+  prom.push(3);
+  prom.complete();
+  queue.run_all();
+  REQUIRE_THROWS_AS(sum.get(), std::runtime_error);
+}
+
+SUBCASE("queue failure") {
+  Flaky_queue queue;
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  auto sum = fut.reduce(queue, 0, add, add);
+
+  prom.push(1);
+  queue.reject = true;
+  REQUIRE_THROWS_AS(prom.push(2), std::length_error);
+  prom.push(3);
+  prom.complete();
+
+  // The value that was never posted is not waited for, but fails the result.
+  queue.run_all();
+  REQUIRE_THROWS_AS(sum.get(), std::length_error);
+}
+
+SUBCASE("stream failure") {
+  Manual_queue queue;
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  auto sum = fut.reduce(queue, 0, add, add);
+
+  prom.push(1);
+  prom.set_exception(std::make_exception_ptr(std::runtime_error("nope")));
+
+  // The pending task still runs before the future is failed.
+  REQUIRE_FALSE(sum.is_ready());
+  queue.run_all();
+  REQUIRE_THROWS_AS(sum.get(), std::runtime_error);
+}
+}
+
+TEST_CASE("Stream collect") {
+SUBCASE("values") {
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  auto all = fut.collect();
+
+  for (int i = 0; i < 1000; ++i) {
+    prom.push(i);
+  }
+  REQUIRE_FALSE(all.is_ready());
+  prom.complete();
+
+  auto result = all.get();
+  REQUIRE_EQ(1000, result.size());
+  for (int i = 0; i < 1000; ++i) {
+    REQUIRE_EQ(i, result[i]);
+  }
+}
+
+SUBCASE("multiple fields") {
+  Stream_promise<int, std::string> prom;
+  auto fut = prom.get_future();
+
+  prom.push(1, "a");
+  prom.push(2, "b");
+
+  Future<std::vector<std::tuple<int, std::string>>> all = fut.collect();
+  prom.complete();
+
+  auto result = all.get();
+  REQUIRE_EQ(2, result.size());
+  REQUIRE_EQ(std::make_tuple(2, std::string("b")), result[1]);
+}
+
+SUBCASE("after other stages") {
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  auto all = fut.map([](int v) { return v * 2; }).take(3).collect();
+
+  for (int i = 0; i < 10; ++i) {
+    prom.push(i);
+  }
+
+  REQUIRE_EQ(std::vector<int>{0, 2, 4}, all.get());
+}
+
+SUBCASE("move only") {
+  Stream_promise<std::unique_ptr<int>> prom;
+  auto fut = prom.get_future();
+
+  auto all = fut.collect();
+  prom.push(std::make_unique<int>(3));
+  prom.complete();
+
+  auto result = all.get();
+  REQUIRE_EQ(1, result.size());
+  REQUIRE_EQ(3, *result[0]);
+}
+
+SUBCASE("failure") {
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  auto all = fut.collect();
+  prom.push(1);
+  prom.set_exception(std::make_exception_ptr(std::runtime_error("nope")));
+
+  REQUIRE_THROWS_AS(all.get(), std::runtime_error);
+}
+}
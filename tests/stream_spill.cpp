@@ -0,0 +1,248 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "var_future/stream_future.h"
+
+#include "doctest.h"
+
+#include <csignal>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
+
+using namespace aom;
+
+namespace {
+struct Reading {
+  int sensor;
+  double value;
+};
+
+#ifdef __unix__
+// Makes writing past max bytes to a file fail, instead of raising SIGXFSZ.
+class File_size_limit {
+ public:
+  explicit File_size_limit(rlim_t max) {
+    getrlimit(RLIMIT_FSIZE, &prev_);
+    rlimit limit = prev_;
+    limit.rlim_cur = max;
+    setrlimit(RLIMIT_FSIZE, &limit);
+    prev_handler_ = std::signal(SIGXFSZ, SIG_IGN);
+  }
+
+  ~File_size_limit() {
+    setrlimit(RLIMIT_FSIZE, &prev_);
+    std::signal(SIGXFSZ, prev_handler_);
+  }
+
+ private:
+  rlimit prev_;
+  void (*prev_handler_)(int);
+};
+#endif
+}  // namespace
+
+TEST_CASE("Stream spilled before consumption") {
+  constexpr int count = 10000;
+
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+  prom.spill_to_disk(64);
+
+  for (int i = 0; i < count; ++i) {
+    prom.push(i);
+  }
+
+  std::vector<int> result;
+  auto done = fut.for_each([&](int v) { result.push_back(v); });
+  REQUIRE_EQ(count, result.size());
+
+  // Values pushed once consumed go straight through.
+  prom.push(count);
+  prom.complete();
+  REQUIRE_NOTHROW(done.get());
+
+  REQUIRE_EQ(count + 1, result.size());
+  for (int i = 0; i <= count; ++i) {
+    REQUIRE_EQ(i, result[i]);
+  }
+}
+
+TEST_CASE("Stream spill of multiple fields") {
+  Stream_promise<int, Reading> prom;
+  auto fut = prom.get_future();
+  prom.spill_to_disk(4);
+
+  for (int i = 0; i < 10; ++i) {
+    prom.push(i, Reading{i * 2, i * 0.5});
+  }
+  prom.complete();
+
+  std::vector<std::tuple<int, int, double>> result;
+  auto done = fut.for_each([&](int i, Reading r) {
+    result.emplace_back(i, r.sensor, r.value);
+  });
+  REQUIRE_NOTHROW(done.get());
+
+  REQUIRE_EQ(10, result.size());
+  for (int i = 0; i < 10; ++i) {
+    REQUIRE_EQ(std::make_tuple(i, i * 2, i * 0.5), result[i]);
+  }
+}
+
+TEST_CASE("Stream spill enabled late") {
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  for (int i = 0; i < 10; ++i) {
+    prom.push(i);
+  }
+
+  // What is already buffered gets spilled along with the rest.
+  prom.spill_to_disk(4);
+  for (int i = 10; i < 20; ++i) {
+    prom.push(i);
+  }
+
+  std::vector<int> result;
+  auto done = fut.for_each([&](int v) { result.push_back(v); });
+
+  prom.complete();
+  REQUIRE_NOTHROW(done.get());
+
+  REQUIRE_EQ(20, result.size());
+  for (int i = 0; i < 20; ++i) {
+    REQUIRE_EQ(i, result[i]);
+  }
+}
+
+TEST_CASE("Stream spill of a failed stream") {
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+  prom.spill_to_disk(2);
+
+  for (int i = 0; i < 5; ++i) {
+    prom.push(i);
+  }
+  prom.set_exception(std::make_exception_ptr(std::runtime_error("nope")));
+
+  std::vector<int> result;
+  auto done = fut.for_each([&](int v) { result.push_back(v); });
+
+  REQUIRE_EQ(std::vector<int>{0, 1, 2, 3, 4}, result);
+  REQUIRE_THROWS_AS(done.get(), std::runtime_error);
+}
+
+#ifdef __unix__
+TEST_CASE("Stream spill write failure") {
+  constexpr int count = 10000;
+
+  std::vector<int> result;
+  {
+    File_size_limit limit(0);
+
+    Stream_promise<int> prom;
+    auto fut = prom.get_future();
+
+    // Large enough to bypass the file's buffer, so the write fails right away.
+    prom.spill_to_disk(count);
+    for (int i = 0; i < count + 10; ++i) {
+      prom.push(i);
+    }
+    prom.complete();
+
+    // Values that could not be spilled stay in memory.
+    auto done = fut.for_each([&](int v) { result.push_back(v); });
+    REQUIRE_NOTHROW(done.get());
+  }
+
+  REQUIRE_EQ(count + 10, result.size());
+  for (int i = 0; i < count + 10; ++i) {
+    REQUIRE_EQ(i, result[i]);
+  }
+}
+
+TEST_CASE("Stream spill replay failure") {
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  std::vector<int> result;
+  std::optional<Future<void>> done;
+  {
+    File_size_limit limit(0);
+
+    // Small enough to stay in the file's buffer, which only fails to be
+    // flushed when the values are read back.
+    prom.spill_to_disk(4);
+    for (int i = 0; i < 10; ++i) {
+      prom.push(i);
+    }
+
+    done = fut.for_each([&](int v) { result.push_back(v); });
+  }
+
+  REQUIRE_THROWS_AS(done->get(), std::system_error);
+  REQUIRE(result.empty());
+
+  // The producer is ignored from then on.
+  prom.push(10);
+  prom.complete();
+  REQUIRE(result.empty());
+}
+#endif
+
+TEST_CASE("Stream spill of an abandoned stream") {
+  Stream_promise<int> prom;
+  {
+    auto fut = prom.get_future();
+    prom.spill_to_disk(2);
+    for (int i = 0; i < 5; ++i) {
+      prom.push(i);
+    }
+  }
+  prom.complete();
+}
+
+TEST_CASE("Stream spill with a concurrent consumer") {
+  constexpr int count = 100000;
+
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+  prom.spill_to_disk(128);
+
+  std::thread producer([&] {
+    for (int i = 0; i < count; ++i) {
+      prom.push(i);
+    }
+    prom.complete();
+  });
+
+  std::vector<int> result;
+  std::this_thread::yield();
+  auto done = fut.for_each([&](int v) { result.push_back(v); });
+  done.get();
+  producer.join();
+
+  REQUIRE_EQ(count, result.size());
+  for (int i = 0; i < count; ++i) {
+    REQUIRE_EQ(i, result[i]);
+  }
+}
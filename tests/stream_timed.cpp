@@ -0,0 +1,213 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "var_future/stream_future.h"
+
+#include "doctest.h"
+#include "test_queues.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+using namespace aom;
+using namespace std::chrono_literals;
+
+TEST_CASE("Stream window") {
+  Manual_timer timer;
+  Stream_promise<int> prom;
+
+  std::vector<std::vector<int>> batches;
+  auto done = prom.get_future().window(timer, 10ms).for_each(
+      [&](std::vector<int> b) { batches.push_back(std::move(b)); });
+
+  REQUIRE_EQ(1, timer.pending());
+  REQUIRE_EQ(timer.delays[0], 10ms);
+
+  prom.push(1);
+  prom.push(2);
+  prom.push(3);
+  REQUIRE(batches.empty());
+
+  timer.fire();
+  REQUIRE_EQ(std::vector<std::vector<int>>{{1, 2, 3}}, batches);
+
+  // Empty windows produce nothing.
+  timer.fire();
+  REQUIRE_EQ(1, batches.size());
+
+  // What is left is delivered as soon as the source ends.
+  prom.push(4);
+  prom.complete();
+  REQUIRE_EQ(std::vector<std::vector<int>>{{1, 2, 3}, {4}}, batches);
+  REQUIRE_NOTHROW(done.get());
+
+  // Ticking stops once the stream is over.
+  timer.fire();
+  REQUIRE_EQ(0, timer.pending());
+  REQUIRE_EQ(2, batches.size());
+}
+
+TEST_CASE("Stream window of multiple fields") {
+  Manual_timer timer;
+  Stream_promise<int, std::string> prom;
+
+  std::vector<std::tuple<int, std::string>> result;
+  auto done = prom.get_future()
+                  .filter([](int i, const std::string&) { return i != 2; })
+                  .window(timer, 10ms)
+                  .for_each([&](std::vector<std::tuple<int, std::string>> b) {
+                    result = std::move(b);
+                  });
+
+  prom.push(1, "a");
+  prom.push(2, "b");
+  prom.push(3, "c");
+  timer.fire();
+
+  REQUIRE_EQ(2, result.size());
+  REQUIRE_EQ(std::make_tuple(1, std::string("a")), result[0]);
+  REQUIRE_EQ(std::make_tuple(3, std::string("c")), result[1]);
+
+  prom.complete();
+  REQUIRE_NOTHROW(done.get());
+}
+
+TEST_CASE("Stream window failure") {
+  Manual_timer timer;
+  Stream_promise<int> prom;
+
+  std::vector<std::vector<int>> batches;
+  auto done = prom.get_future().window(timer, 10ms).for_each(
+      [&](std::vector<int> b) { batches.push_back(std::move(b)); });
+
+  prom.push(1);
+  prom.set_exception(std::make_exception_ptr(std::runtime_error("nope")));
+
+  REQUIRE_EQ(std::vector<std::vector<int>>{{1}}, batches);
+  REQUIRE_THROWS_AS(done.get(), std::runtime_error);
+}
+
+TEST_CASE("Stream window of a finished stream") {
+  Manual_timer timer;
+  Stream_promise<int> prom;
+  auto fut = prom.get_future();
+
+  prom.push(1);
+  prom.push(2);
+  prom.complete();
+
+  std::vector<std::vector<int>> batches;
+  auto done = fut.window(timer, 10ms).for_each(
+      [&](std::vector<int> b) { batches.push_back(std::move(b)); });
+
+  REQUIRE_EQ(std::vector<std::vector<int>>{{1, 2}}, batches);
+  REQUIRE_NOTHROW(done.get());
+}
+
+TEST_CASE("Stream throttle") {
+  Manual_timer timer;
+  Stream_promise<int> prom;
+
+  std::vector<int> result;
+  auto done = prom.get_future()
+                  .map([](int i) { return i * 10; })
+                  .throttle(timer, 5ms)
+                  .for_each([&](int v) { result.push_back(v); });
+
+  // Nothing is scheduled until a value is let through.
+  REQUIRE_EQ(0, timer.pending());
+
+  prom.push(1);
+  prom.push(2);
+  prom.push(3);
+  REQUIRE_EQ(std::vector<int>{10}, result);
+  REQUIRE_EQ(1, timer.pending());
+  REQUIRE_EQ(timer.delays[0], 5ms);
+
+  timer.fire();
+  prom.push(4);
+  prom.push(5);
+  REQUIRE_EQ(std::vector<int>{10, 40}, result);
+
+  prom.complete();
+  REQUIRE_NOTHROW(done.get());
+}
+
+TEST_CASE("Stream sample") {
+  Manual_timer timer;
+  Stream_promise<int, std::string> prom;
+
+  std::vector<std::tuple<int, std::string>> result;
+  auto done = prom.get_future().sample(timer, 10ms).for_each(
+      [&](int i, std::string s) { result.emplace_back(i, std::move(s)); });
+
+  prom.push(1, "a");
+  prom.push(2, "b");
+  prom.push(3, "c");
+  timer.fire();
+  REQUIRE_EQ(1, result.size());
+  REQUIRE_EQ(std::make_tuple(3, std::string("c")), result[0]);
+
+  // Nothing new, nothing sampled.
+  timer.fire();
+  REQUIRE_EQ(1, result.size());
+
+  prom.push(4, "d");
+  prom.complete();
+  REQUIRE_EQ(2, result.size());
+  REQUIRE_EQ(std::make_tuple(4, std::string("d")), result[1]);
+  REQUIRE_NOTHROW(done.get());
+}
+
+TEST_CASE("Stream window from concurrent timer") {
+  constexpr int count = 100000;
+
+  Manual_timer timer;
+  Stream_promise<int> prom;
+
+  long long total = 0;
+  int received = 0;
+  auto done = prom.get_future().window(timer, 1ms).for_each(
+      [&](std::vector<int> b) {
+        received += static_cast<int>(b.size());
+        for (int v : b) {
+          total += v;
+        }
+      });
+
+  std::atomic<bool> stop = false;
+  std::thread ticker([&] {
+    while (!stop) {
+      timer.fire();
+      std::this_thread::yield();
+    }
+  });
+
+  for (int i = 0; i < count; ++i) {
+    prom.push(i);
+  }
+  prom.complete();
+  done.get();
+
+  stop = true;
+  ticker.join();
+
+  REQUIRE_EQ(count, received);
+  REQUIRE_EQ(static_cast<long long>(count) * (count - 1) / 2, total);
+}
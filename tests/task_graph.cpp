@@ -0,0 +1,268 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "var_future/task_graph.h"
+
+#include "doctest.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace aom;
+
+namespace {
+// Single-threaded queue that does not allocate once warm.
+struct Vector_queue {
+  Vector_queue() { tasks.reserve(64); }
+
+  void push(std::function<void()> cb) { tasks.push_back(std::move(cb)); }
+
+  void run() {
+    while (!tasks.empty()) {
+      auto task = std::move(tasks.back());
+      tasks.pop_back();
+      task();
+    }
+  }
+
+  std::vector<std::function<void()>> tasks;
+};
+
+// Counts the allocations that reach it. Installed as the default resource
+// while it is alive, so that the pool of the graphs created meanwhile gets its
+// memory from it.
+class Counting_resource : public std::pmr::memory_resource {
+ public:
+  Counting_resource() : prev_(std::pmr::set_default_resource(this)) {}
+  ~Counting_resource() { std::pmr::set_default_resource(prev_); }
+
+  std::atomic<int> allocs = 0;
+
+ private:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+    ++allocs;
+    return prev_->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void* p, std::size_t bytes,
+                     std::size_t alignment) override {
+    prev_->deallocate(p, bytes, alignment);
+  }
+
+  bool do_is_equal(
+      const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+  std::pmr::memory_resource* prev_;
+};
+}  // namespace
+
+TEST_CASE("Task graphs") {
+SUBCASE("dependencies are respected") {
+  Vector_queue queue;
+  Task_graph graph;
+  std::vector<int> order;
+
+  auto a = graph.add([&] { order.push_back(0); });
+  auto b = graph.add([&] { order.push_back(1); }, {a});
+  auto c = graph.add([&] { order.push_back(2); }, {a});
+  graph.add([&] { order.push_back(3); }, {b, c});
+
+  for (int i = 0; i < 3; ++i) {
+    order.clear();
+    auto done = graph.run(queue);
+    REQUIRE_FALSE(done.is_ready());
+
+    queue.run();
+    REQUIRE(done.is_ready());
+    REQUIRE(done.try_get()->has_value());
+
+    REQUIRE_EQ(4, order.size());
+    REQUIRE_EQ(0, order.front());
+    REQUIRE_EQ(3, order.back());
+  }
+}
+
+SUBCASE("empty graph") {
+  Vector_queue queue;
+  Task_graph graph;
+
+  auto done = graph.run(queue);
+  REQUIRE(done.is_ready());
+}
+
+SUBCASE("failures skip the remaining tasks") {
+  Vector_queue queue;
+  Task_graph graph;
+  bool ran_after = false;
+
+  auto a = graph.add([] { throw std::logic_error("nope"); });
+  graph.add([&] { ran_after = true; }, {a});
+
+  auto done = graph.run(queue);
+  queue.run();
+
+  REQUIRE_FALSE(ran_after);
+  REQUIRE_THROWS_AS(std::rethrow_exception(done.try_get()->error()),
+                    std::logic_error);
+
+  // The graph remains usable.
+  REQUIRE_FALSE(graph.run(queue).is_ready());
+  queue.run();
+}
+
+SUBCASE("throwing queue fails the run") {
+  struct Flaky_queue {
+    void push(std::function<void()> cb) {
+      if (fail) {
+        throw std::length_error("full");
+      }
+      tasks.push(std::move(cb));
+    }
+
+    bool fail = false;
+    Vector_queue tasks;
+  } queue;
+  Task_graph graph;
+  int count = 0;
+
+  auto a = graph.add([&] { ++count; });
+  auto b = graph.add([&] { ++count; }, {a});
+  graph.add([&] { ++count; }, {b});
+
+  queue.fail = true;
+  auto done = graph.run(queue);
+  REQUIRE_THROWS_AS(std::rethrow_exception(done.try_get()->error()),
+                    std::length_error);
+  REQUIRE_EQ(0, count);
+
+  // The root is queued, but its successor cannot be.
+  queue.fail = false;
+  done = graph.run(queue);
+  queue.fail = true;
+  queue.tasks.run();
+  REQUIRE_EQ(1, count);
+  REQUIRE_THROWS_AS(std::rethrow_exception(done.try_get()->error()),
+                    std::length_error);
+
+  // The graph remains usable.
+  queue.fail = false;
+  done = graph.run(queue);
+  queue.tasks.run();
+  REQUIRE_EQ(4, count);
+  REQUIRE(done.try_get()->has_value());
+}
+
+SUBCASE("run again from the continuation") {
+  Vector_queue queue;
+  Task_graph graph;
+  int total = 0;
+  int runs = 0;
+
+  graph.add([&] { ++total; });
+
+  std::function<void()> next = [&] {
+    graph.run(queue).finally([&](expected<void>) {
+      if (++runs < 3) {
+        next();
+      }
+    });
+  };
+  next();
+  queue.run();
+
+  REQUIRE_EQ(3, runs);
+  REQUIRE_EQ(3, total);
+}
+
+SUBCASE("destroyed from the continuation") {
+  Vector_queue queue;
+  auto graph = std::make_unique<Task_graph>();
+  graph->add([] {});
+
+  graph->run(queue).finally([&](expected<void>) { graph.reset(); });
+  queue.run();
+
+  REQUIRE_FALSE(graph);
+}
+
+SUBCASE("future outlives the graph") {
+  Vector_queue queue;
+  std::optional<pmr::Future<void>> done;
+  {
+    Task_graph graph;
+    graph.add([] {});
+    done = graph.run(queue);
+    queue.run();
+  }
+
+  REQUIRE(done->is_ready());
+}
+
+SUBCASE("steady state does not allocate") {
+  Counting_resource counter;
+  Vector_queue queue;
+  Task_graph graph;
+  int total = 0;
+
+  auto a = graph.add([&] { total += 1; });
+  auto b = graph.add([&] { total += 2; });
+  auto c = graph.add([&] { total += 3; }, {a, b});
+  graph.add([&] { total += 4; }, {c});
+
+  // Warm up.
+  graph.run(queue).finally([](expected<void>) {});
+  queue.run();
+
+  counter.allocs = 0;
+  for (int i = 0; i < 10; ++i) {
+    graph.run(queue).finally([](expected<void>) {});
+    queue.run();
+  }
+
+  REQUIRE_EQ(0, counter.allocs);
+  REQUIRE_EQ(110, total);
+}
+
+SUBCASE("threaded") {
+  struct Pool {
+    void push(std::function<void()> cb) {
+      std::thread(std::move(cb)).detach();
+    }
+  } pool;
+
+  Task_graph graph;
+  std::atomic<int> total = 0;
+  std::vector<Task_graph::node_id> layer;
+  for (int i = 0; i < 8; ++i) {
+    layer.push_back(graph.add([&] { ++total; }));
+  }
+  auto join_node = graph.add([&] { total += 100; },
+                             {layer[0], layer[1], layer[2], layer[3], layer[4],
+                              layer[5], layer[6], layer[7]});
+  (void)join_node;
+
+  for (int i = 0; i < 5; ++i) {
+    graph.run(pool).get();
+  }
+  REQUIRE_EQ(5 * 108, total);
+}
+}
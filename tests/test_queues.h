@@ -0,0 +1,155 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AOM_VARIADIC_TESTS_TEST_QUEUES_INCLUDED_H
+#define AOM_VARIADIC_TESTS_TEST_QUEUES_INCLUDED_H
+
+// Queues, and a timer, shared by the tests.
+
+#include "var_future/impl/utils.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Runs tasks when, and in whatever order, the test asks for.
+struct Manual_queue {
+  void push(std::function<void()> cb) { tasks.push_back(std::move(cb)); }
+
+  void run(std::size_t i) {
+    auto task = std::move(tasks[i]);
+    tasks.erase(tasks.begin() + i);
+    task();
+  }
+
+  // Also runs the tasks pushed along the way.
+  void run_all() {
+    while (!tasks.empty()) {
+      run(0);
+    }
+  }
+
+  std::vector<std::function<void()>> tasks;
+};
+
+// Like Manual_queue, but also accepts move-only tasks.
+struct Move_only_queue {
+  template <typename F>
+  void push(F&& f) {
+    tasks.emplace_back(std::forward<F>(f));
+  }
+
+  void run_all() {
+    while (!tasks.empty()) {
+      auto task = std::move(tasks.front());
+      tasks.erase(tasks.begin());
+      task();
+    }
+  }
+
+  std::vector<aom::detail::Unique_function<void()>> tasks;
+};
+
+struct Thread_pool {
+  explicit Thread_pool(std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+      threads.emplace_back([this] {
+        while (true) {
+          std::function<void()> task;
+          {
+            std::unique_lock l(mtx);
+            cv.wait(l, [&] { return stopped || !tasks.empty(); });
+            if (tasks.empty()) {
+              return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop();
+          }
+          task();
+        }
+      });
+    }
+  }
+
+  ~Thread_pool() {
+    {
+      std::lock_guard l(mtx);
+      stopped = true;
+    }
+    cv.notify_all();
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+
+  void push(std::function<void()> cb) {
+    {
+      std::lock_guard l(mtx);
+      tasks.push(std::move(cb));
+    }
+    cv.notify_one();
+  }
+
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::queue<std::function<void()>> tasks;
+  bool stopped = false;
+  std::vector<std::thread> threads;
+};
+
+// Runs scheduled tasks when the test asks for it, regardless of their delay.
+struct Manual_timer {
+  void schedule(std::chrono::steady_clock::duration delay,
+                std::function<void()> task) {
+    std::lock_guard l(mtx);
+    delays.push_back(delay);
+    tasks.push_back(std::move(task));
+  }
+
+  // Fires the timers that are pending, but not the ones they schedule.
+  void fire() {
+    std::vector<std::function<void()>> due;
+    {
+      std::lock_guard l(mtx);
+      due.swap(tasks);
+    }
+    for (auto& task : due) {
+      task();
+    }
+  }
+
+  // Fires the timers that are pending, including the ones they schedule.
+  void run() {
+    while (pending() != 0) {
+      fire();
+    }
+  }
+
+  std::size_t pending() {
+    std::lock_guard l(mtx);
+    return tasks.size();
+  }
+
+  std::mutex mtx;
+  std::vector<std::chrono::steady_clock::duration> delays;
+  std::vector<std::function<void()>> tasks;
+};
+
+#endif
@@ -0,0 +1,119 @@
+// Copyright 2019 Age of Minds inc.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include "var_future/future.h"
+
+#include "doctest.h"
+
+#include <stdexcept>
+#include <vector>
+
+using namespace aom;
+
+namespace {
+// Deep enough to overflow the stack if every link ran nested.
+constexpr int chain_length = 200000;
+}  // namespace
+
+TEST_CASE("Long synchronous chains") {
+SUBCASE("then") {
+  Promise<int> p;
+  Future<int> f = p.get_future();
+
+  for (int i = 0; i < chain_length; ++i) {
+    f = f.then([](int v) { return v + 1; });
+  }
+
+  bool done = false;
+  f.finally([&](expected<int> v) {
+    REQUIRE_EQ(chain_length, *v);
+    done = true;
+  });
+
+  p.set_value(0);
+
+  // Deferred links are still all executed before set_value() returns.
+  REQUIRE(done);
+}
+
+SUBCASE("then_expect") {
+  Promise<int> p;
+  Future<int> f = p.get_future();
+
+  for (int i = 0; i < chain_length; ++i) {
+    f = f.then_expect([](expected<int> v) { return *v + 1; });
+  }
+
+  p.set_value(0);
+  REQUIRE_EQ(chain_length, f.get());
+}
+
+SUBCASE("failure propagation") {
+  Promise<int> p;
+  Future<int> f = p.get_future();
+
+  for (int i = 0; i < chain_length; ++i) {
+    f = f.then([](int v) { return v + 1; });
+  }
+
+  p.set_exception(std::make_exception_ptr(std::logic_error("nope")));
+  REQUIRE_THROWS_AS(f.get(), std::logic_error);
+}
+
+SUBCASE("shallow chains stay in order") {
+  Promise<int> p;
+  std::vector<int> order;
+
+  auto f = p.get_future()
+               .then([&](int v) {
+                 order.push_back(1);
+                 return v;
+               })
+               .then([&](int v) {
+                 order.push_back(2);
+                 return v;
+               });
+  f.finally([&](expected<int>) { order.push_back(3); });
+
+  p.set_value(1);
+  REQUIRE_EQ(std::vector<int>{1, 2, 3}, order);
+}
+
+SUBCASE("throwing deferred task") {
+  Promise<int> a;
+  Promise<int> b;
+  Future<int> fa = a.get_future();
+  Future<int> fb = b.get_future();
+
+  for (int i = 0; i < AOM_VARFUT_MAX_INLINE_DEPTH * 2; ++i) {
+    fa = fa.then([](int v) { return v + 1; });
+    fb = fb.then([](int v) { return v + 1; });
+  }
+
+  // Both callbacks run too deep, so they are deferred to the outermost frame.
+  fa.finally([](expected<int>) { throw std::runtime_error("nope"); });
+
+  bool b_done = false;
+  fb.finally([&](expected<int>) { b_done = true; });
+
+  auto run = [&] {
+    a.set_value(0);
+    b.set_value(0);
+  };
+  REQUIRE_THROWS_AS(detail::Trampoline::try_run_inline(run),
+                    std::runtime_error);
+  REQUIRE(b_done);
+}
+}